@@ -0,0 +1,151 @@
+/**
+@file BatchSim.c
+@author Rob Thomas
+@brief Flies a large batch of landers at once for Monte Carlo analysis.
+@details This file contains the main function of LunarLanderBatch. It loads a
+level, scatters a LanderBatch over it with pseudo-random positions and drifts,
+and steps the whole batch until every lander has landed or crashed (or the tick
+limit is reached). It then reports the outcomes and the lander-ticks per second.
+
+Usage: LunarLanderBatch [terrainFile] [numLanders]
+*/
+
+#include <SDL2/SDL.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "GameInitialization.h"
+#include "TerrainBuilding.h"
+#include "Simulation.h"
+#include "LanderBatch.h"
+#include "GameObjects.h"
+
+
+/**
+@def DEFAULT_LANDERS
+@brief The number of landers to fly if none is given on the command line.
+*/
+#define DEFAULT_LANDERS 1000000
+
+/**
+@def MAX_BATCH_TICKS
+@brief The number of ticks (ten minutes of game time) after which landers still
+flying are abandoned.
+*/
+#define MAX_BATCH_TICKS (PHYSICS_TICK_RATE * 600)
+
+/**
+@fn nextRandom
+@brief Advances a xorshift32 generator and returns its next value.
+@param seed Pointer to the generator's state. Must not be 0.
+@return The next pseudo-random number.
+*/
+static Uint32 nextRandom (Uint32 *seed)
+{
+	*seed ^= *seed << 13;
+	*seed ^= *seed >> 17;
+	*seed ^= *seed << 5;
+
+	return *seed;
+}
+
+/**
+@fn main
+@brief The main function for LunarLanderBatch.
+*/
+int main(int argc, char *argv[])
+{
+	GameState state;
+	Lander lander;
+	Terrain terrain;
+	LanderBatch batch;
+	char *fileName = "terrain.txt";
+	long numLanders = DEFAULT_LANDERS;
+	Uint32 seed = 2463534242u;
+
+	/*** Read the command line. ***/
+	if (argc >= 2)
+	{
+		fileName = argv[1];
+	}
+	if (argc >= 3)
+	{
+		numLanders = strtol(argv[2], NULL, 10);
+	}
+
+	/*** Build the terrain. ***/
+	terrain.vertices = NULL;
+	terrain.numVertices = 0;
+	terrain.heightMap = NULL;
+
+	initializeSimulation(&state, &lander, &terrain, fileName);
+
+	/*** Scatter the landers over the level. ***/
+	if (!createLanderBatch(&batch, (Uint32)(numLanders), &terrain,
+						   state.levelWidth))
+	{
+		fprintf(stderr, "Couldn't allocate a batch of %ld landers.\n",
+				numLanders);
+		return EXIT_MAP_FAIL;
+	}
+
+	for (Uint32 i = 0; i < batch.count; i++)
+	{
+		lander.realX = TO_REAL(nextRandom(&seed) % state.levelWidth);
+		lander.realY = TO_REAL(LANDER_Y_START);
+		lander.horVelocity = REAL_RATIO((int)(nextRandom(&seed) % 201) - 100,
+										100);
+		lander.vertVelocity = REAL_RATIO((int)(nextRandom(&seed) % 101) - 50,
+										 100);
+
+		setBatchLander(&batch, i, lander);
+	}
+
+	/*** Step the batch until every lander has touched down. ***/
+	clock_t start = clock();
+	Uint32 flying = batch.count;
+	Uint64 landerTicks = 0;
+	Uint32 tick;
+
+	for (tick = 0; tick < MAX_BATCH_TICKS && flying > 0; tick++)
+	{
+		landerTicks += flying;
+		flying -= stepLanderBatch(&batch, &terrain, state.levelWidth);
+	}
+
+	double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+	/*** Report the results. ***/
+	Uint32 landings = 0, crashes = 0;
+	for (Uint32 i = 0; i < batch.count; i++)
+	{
+		if (batch.landingType[i] == LANDING_PROPER)
+		{
+			landings++;
+		}
+		else if (batch.landingType[i] == LANDING_CRASH)
+		{
+			crashes++;
+		}
+	}
+
+	printf("landers:        %u\n", batch.count);
+	printf("landings:       %u\n", landings);
+	printf("crashes:        %u\n", crashes);
+	printf("still flying:   %u\n", flying);
+	printf("ticks:          %u\n", tick);
+	printf("lander-ticks:   %llu\n", (unsigned long long)(landerTicks));
+	if (seconds > 0)
+	{
+		printf("lander-ticks/s: %.0f\n", landerTicks / seconds);
+	}
+
+	/*** Clean up. ***/
+	freeLanderBatch(&batch);
+	freeTerrain(&terrain);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,292 @@
+/**
+@file Export.c
+@author Rob Thomas
+@brief Renders a replay log to video without a window.
+@details This file contains the main function of LunarLanderExport. It plays a
+replay log back tick by tick, the way the game would have played it, and draws
+the same scene as the game does (the terrain, lander, score modifiers and HUD)
+with SDL's software renderer into memory instead of a window. A frame is drawn
+for every 1/framesPerSecond of game time and handed to a writer thread (see
+FrameWriter.h), so a flight is rendered as fast as the CPU allows, with no
+display or GPU needed.
+
+The output is a YUV4MPEG2 stream if its name ends in ".y4m", or a sequence of
+PNG files named after it otherwise. For example:
+
+    LunarLanderExport flight.llr flight.y4m terrain.txt 60
+    ffmpeg -i flight.y4m flight.mp4
+
+The replay is drawn on the terrain named in its log unless a terrain file is
+given.
+
+Usage: LunarLanderExport replayFile outputFile [terrainFile] [framesPerSecond]
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <SDL2/SDL.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "GameInitialization.h"
+#include "GameFunctions.h"
+#include "TerrainBuilding.h"
+#include "Simulation.h"
+#include "Replay.h"
+#include "TerrainCache.h"
+#include "TextCache.h"
+#include "FrameWriter.h"
+#include "GameObjects.h"
+
+
+/**
+@def DEFAULT_EXPORT_FPS
+@brief The frame rate of the video if none is given on the command line.
+*/
+#define DEFAULT_EXPORT_FPS 30
+
+/**
+@fn playTick
+@brief Applies one tick of game time the way the game's loop does, minus the
+collision message: the lander is moved, the focus scrolled after it, and any
+collision resolved before the lander is respawned.
+@param state Pointer to the current GameState struct.
+@param now The game time (in ms) since the replay started, standing in for the
+clock the game's timer is read from.
+*/
+static void playTick (GameState *state, Uint32 now)
+{
+	int landingType;
+
+	/*** Start the timer if it has just been reset. ***/
+	if (state->timeStart == (Uint32)(-1))
+	{
+		state->timeStart = now;
+	}
+
+	simulateTick(state);
+	scrollFocusPoint(state);
+	state->timeElapsed = now - state->timeStart;
+
+	if (collisionDetected(*state, &landingType))
+	{
+		resolveCollision(state, landingType);
+
+		if (gameOver(*state))
+		{
+			hardReset(state);
+		}
+		else
+		{
+			softReset(state);
+		}
+	}
+}
+
+/**
+@fn exportFrame
+@brief Draws a snapshot of the scene and queues it to be written.
+@param state Pointer to the current GameState struct.
+@param snapshot Pointer to the RenderSnapshot to take the scene into.
+@param writer Pointer to the FrameWriter.
+@return True if the frame was queued, false if it couldn't be read back from
+the renderer.
+*/
+static bool exportFrame (GameState *state, RenderSnapshot *snapshot,
+						 FrameWriter *writer)
+{
+	takeRenderSnapshot(state, snapshot);
+	drawScene(snapshot);
+
+	if (SDL_RenderReadPixels(snapshot->renderer, NULL, SDL_PIXELFORMAT_RGBA32,
+							 reserveFrame(writer), WINDOW_WIDTH * 4) != 0)
+	{
+		return false;
+	}
+
+	queueFrame(writer);
+
+	return true;
+}
+
+/**
+@fn exportReplay
+@brief Plays a replay back, drawing a frame whenever the game time reaches the
+next one, and reports how it went.
+@param state Pointer to the GameState the replay is played back into.
+@param playback Pointer to the ReplayPlayback, which is closed.
+@param writer Pointer to the FrameWriter, which is closed.
+@param outputFile The name of the video, for reporting.
+@param framesPerSecond The frame rate of the video.
+@return EXIT_SUCCESS if the video was written and the replay's final state
+matched the recorded one, or the code to exit with otherwise.
+*/
+static int exportReplay (GameState *state, ReplayPlayback *playback,
+						 FrameWriter *writer, char *outputFile,
+						 long framesPerSecond)
+{
+	RenderSnapshot snapshot;
+	Uint32 frames = 0, ticks = 0;
+	bool drawn = true;
+	struct timespec start, end;
+
+	initializeRenderSnapshot(&snapshot);
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	while (true)
+	{
+		while (drawn && (Uint64)(frames) * PHYSICS_TICK_RATE <=
+						(Uint64)(ticks) * framesPerSecond)
+		{
+			if (( drawn = exportFrame(state, &snapshot, writer) ))
+			{
+				frames++;
+			}
+		}
+
+		if (!drawn || !advanceReplayPlayback(playback, state))
+		{
+			break;
+		}
+
+		ticks++;
+		playTick(state, (Uint32)((Uint64)(ticks) * 1000 / PHYSICS_TICK_RATE));
+	}
+
+	bool matched = closeReplayPlayback(playback, state);
+	bool written = closeFrameWriter(writer) && drawn;
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	double seconds = (end.tv_sec - start.tv_sec) +
+					 (end.tv_nsec - start.tv_nsec) / 1e9;
+
+	freeRenderSnapshot(&snapshot);
+
+	/*** Report the results. ***/
+	if (!written)
+	{
+		fprintf(stderr, "Problem encountered writing video.\nfileName: %s\n",
+				outputFile);
+	}
+
+	printf("frames:    %u (%.1f s of game time)\n", frames,
+		   (double)(ticks) / PHYSICS_TICK_RATE);
+	if (seconds > 0)
+	{
+		printf("frames/s:  %.0f (%.1fx real time)\n", frames / seconds,
+			   (double)(ticks) / PHYSICS_TICK_RATE / seconds);
+	}
+
+	if (!written)
+	{
+		return EXIT_FOPEN_FAIL;
+	}
+
+	return matched ? EXIT_SUCCESS : EXIT_BADFILE_FAIL;
+}
+
+/**
+@fn main
+@brief The main function for LunarLanderExport.
+*/
+int main(int argc, char *argv[])
+{
+	GameState state;
+	Lander lander;
+	Terrain terrain;
+	char *fileName, recordedFileName[REPLAY_NAME_SIZE];
+	long framesPerSecond = DEFAULT_EXPORT_FPS;
+	ReplayPlayback *playback;
+	FrameWriter *writer;
+	SDL_Surface *surface;
+	int exitCode;
+
+	/*** Read the command line. The replay is drawn on the terrain it was
+	     recorded on, unless told otherwise. ***/
+	if (argc < 3)
+	{
+		fprintf(stderr, "Usage: %s replayFile outputFile [terrainFile] "
+				"[framesPerSecond]\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+	if (argc > 3)
+	{
+		fileName = argv[3];
+	}
+	else if (readReplayTerrainName(argv[1], recordedFileName))
+	{
+		fileName = recordedFileName;
+	}
+	else
+	{
+		return EXIT_BADFILE_FAIL;
+	}
+	if (argc > 4)
+	{
+		framesPerSecond = strtol(argv[4], NULL, 10);
+	}
+	if (framesPerSecond < 1 || framesPerSecond > PHYSICS_TICK_RATE)
+	{
+		fprintf(stderr, "The frame rate must be from 1 to %d.\n",
+				PHYSICS_TICK_RATE);
+		return EXIT_FAILURE;
+	}
+
+	/*** Initialize the terrain and the game state. ***/
+	terrain.vertices = NULL;
+	terrain.numVertices = 0;
+	terrain.heightMap = NULL;
+
+	initializeSimulation(&state, &lander, &terrain, fileName);
+
+	/*** Draw into a surface in memory with the software renderer, caching
+	     the terrain and text in textures as the game does. ***/
+	state.window = NULL;
+	state.renderer = NULL;
+	surface = SDL_CreateRGBSurfaceWithFormat(0, WINDOW_WIDTH, WINDOW_HEIGHT,
+											 32, SDL_PIXELFORMAT_RGBA32);
+
+	if (surface == NULL ||
+		!( state.renderer = SDL_CreateSoftwareRenderer(surface) ))
+	{
+		fprintf(stderr, "Problem creating offscreen renderer: %s\n",
+				SDL_GetError());
+		SDL_FreeSurface(surface);
+		freeTerrain(&terrain);
+		return EXIT_SDLINIT_FAIL;
+	}
+
+	state.terrainCache = createTerrainCache(&state);
+	state.textCache = createTextCache(&state);
+
+	/*** Open the replay and the video, then play the replay into it. ***/
+	if (!( playback = openReplayPlayback(argv[1], fileName, &state) ))
+	{
+		exitCode = EXIT_BADFILE_FAIL;
+	}
+	else if (!( writer = openFrameWriter(argv[2], WINDOW_WIDTH, WINDOW_HEIGHT,
+										 (int)(framesPerSecond)) ))
+	{
+		fprintf(stderr, "Problem encountered opening video.\nfileName: %s\n",
+				argv[2]);
+		closeReplayPlayback(playback, &state);
+		exitCode = EXIT_FOPEN_FAIL;
+	}
+	else
+	{
+		exitCode = exportReplay(&state, playback, writer, argv[2],
+								framesPerSecond);
+	}
+
+	/*** Clean up. ***/
+	freeTextCache(state.textCache);
+	freeTerrainCache(state.terrainCache);
+	SDL_DestroyRenderer(state.renderer);
+	SDL_FreeSurface(surface);
+	freeTerrain(&terrain);
+
+	return exitCode;
+}
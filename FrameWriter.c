@@ -0,0 +1,565 @@
+/**
+@file FrameWriter.c
+@author Rob Thomas
+@brief Contains functions for writing rendered frames out as video on a
+separate thread.
+@details See FrameWriter.h. Every frame is encoded whole into the writer's
+scratch buffer and written with a single call, so the writer thread spends its
+time converting pixels rather than in the C library.
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <SDL2/SDL.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "FrameWriter.h"
+
+
+/* The first eight bytes of every PNG file. */
+static const Uint8 pngSignature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A,
+									  '\n'};
+
+/* The largest block of stored (uncompressed) data in a zlib stream. */
+#define MAX_STORED_BLOCK 65535
+
+/* The most bytes added to the Adler-32 checksum of a zlib stream before its
+   sums might overflow 32 bits. */
+#define ADLER_RUN 5552
+
+/* The CRC-32 of every byte value, for the checksums of PNG chunks. */
+static Uint32 crcTable[256];
+
+/**
+@fn buildCrcTable
+@brief Fills in the CRC-32 table, if it hasn't been already.
+*/
+static void buildCrcTable (void)
+{
+	if (crcTable[1] != 0)
+	{
+		return;
+	}
+
+	for (Uint32 n = 0; n < 256; n++)
+	{
+		Uint32 c = n;
+
+		for (int k = 0; k < 8; k++)
+		{
+			c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+		}
+
+		crcTable[n] = c;
+	}
+}
+
+/**
+@fn putUint32
+@brief Stores a 32-bit integer big-endian, as PNG files hold them.
+@param bytes Where to store the integer.
+@param value The integer to store.
+*/
+static void putUint32 (Uint8 *bytes, Uint32 value)
+{
+	bytes[0] = (Uint8)(value >> 24);
+	bytes[1] = (Uint8)(value >> 16);
+	bytes[2] = (Uint8)(value >> 8);
+	bytes[3] = (Uint8)(value);
+}
+
+/**
+@fn beginChunk
+@brief Starts a PNG chunk by storing its length and type.
+@param out Where the chunk starts.
+@param type The chunk's four-letter type.
+@param length The length of the chunk's data.
+@return Where the chunk's data starts.
+*/
+static Uint8 *beginChunk (Uint8 *out, const char *type, Uint32 length)
+{
+	putUint32(out, length);
+	memcpy(out + 4, type, 4);
+
+	return out + 8;
+}
+
+/**
+@fn endChunk
+@brief Ends a PNG chunk begun by beginChunk by storing the CRC-32 of its type
+and data after the data.
+@param data Where the chunk's data starts.
+@param length The length of the chunk's data.
+@return Where the next chunk starts.
+*/
+static Uint8 *endChunk (Uint8 *data, Uint32 length)
+{
+	Uint32 crc = 0xFFFFFFFFu;
+
+	for (const Uint8 *byte = data - 4; byte < data + length; byte++)
+	{
+		crc = crcTable[(crc ^ *byte) & 0xFF] ^ (crc >> 8);
+	}
+	putUint32(data + length, crc ^ 0xFFFFFFFFu);
+
+	return data + length + 4;
+}
+
+/**
+@fn getPngRowSize
+@brief Finds the size of one row of a frame's image data in a PNG file: a
+filter type byte followed by three bytes per pixel.
+@param width The width of the frame (in pixels).
+@return The size of the row (in bytes).
+*/
+static size_t getPngRowSize (int width)
+{
+	return 1 + 3 * (size_t)(width);
+}
+
+/**
+@fn getPngSize
+@brief Finds the size of the PNG file a frame is encoded into.
+@param width The width of the frame (in pixels).
+@param height The height of the frame (in pixels).
+@return The size of the file (in bytes).
+*/
+static size_t getPngSize (int width, int height)
+{
+	size_t imageSize = getPngRowSize(width) * height;
+	size_t numBlocks = (imageSize + MAX_STORED_BLOCK - 1) / MAX_STORED_BLOCK;
+
+	/* The signature, IHDR and IEND, and IDAT holding a zlib stream of stored
+	   blocks: a 2-byte header, 5 bytes before each block and a 4-byte
+	   checksum. */
+	return sizeof(pngSignature) + (12 + 13) + 12 +
+		   12 + 2 + 5 * numBlocks + imageSize + 4;
+}
+
+/**
+@fn getY4mSize
+@brief Finds the size of the planes a frame is encoded into in a YUV4MPEG2
+stream: a full-size luma plane and two chroma planes of half the width and
+height (rounded up).
+@param width The width of the frame (in pixels).
+@param height The height of the frame (in pixels).
+@return The size of the planes (in bytes).
+*/
+static size_t getY4mSize (int width, int height)
+{
+	return (size_t)(width) * height +
+		   2 * (size_t)((width + 1) / 2) * ((height + 1) / 2);
+}
+
+/**
+@fn encodePng
+@brief Encodes a frame as a PNG file (8-bit RGB, with the frame's alpha
+dropped) in the writer's scratch buffer.
+@details The image data is stored in a zlib stream without compression, one
+block of at most MAX_STORED_BLOCK bytes at a time, with every row unfiltered.
+@param writer Pointer to the FrameWriter.
+@param frame The frame's RGBA pixels.
+@return The size of the PNG file.
+*/
+static size_t encodePng (FrameWriter *writer, const Uint8 *frame)
+{
+	Uint8 *out = writer->encoded;
+	size_t rowSize = getPngRowSize(writer->width);
+	size_t imageSize = rowSize * writer->height;
+	Uint8 *data;
+
+	memcpy(out, pngSignature, sizeof(pngSignature));
+	out += sizeof(pngSignature);
+
+	/*** IHDR: the size, 8 bits per sample, RGB, no interlacing. ***/
+	data = beginChunk(out, "IHDR", 13);
+	putUint32(data, (Uint32)(writer->width));
+	putUint32(data + 4, (Uint32)(writer->height));
+	data[8] = 8;
+	data[9] = 2;
+	data[10] = data[11] = data[12] = 0;
+	out = endChunk(data, 13);
+
+	/*** IDAT: the rows, split into stored blocks. ***/
+	Uint32 idatLength = (Uint32)(getPngSize(writer->width, writer->height) -
+								 sizeof(pngSignature) - 25 - 12 - 12);
+	Uint8 *block = NULL;
+	size_t blockLeft = 0, imageLeft = imageSize;
+	Uint32 adlerA = 1, adlerB = 0, adlerRun = 0;
+
+	data = beginChunk(out, "IDAT", idatLength);
+	out = data;
+	*out++ = 0x78;
+	*out++ = 0x01;
+
+	for (int y = 0; y < writer->height; y++)
+	{
+		const Uint8 *pixel = frame + (size_t)(y) * writer->width * 4;
+
+		for (size_t i = 0; i < rowSize; i++)
+		{
+			Uint8 byte;
+
+			/* Each row begins with filter type 0 (none), then the pixels. */
+			if (i == 0)
+			{
+				byte = 0;
+			}
+			else
+			{
+				byte = pixel[0];
+				pixel += ((i % 3) == 0) ? 2 : 1;
+			}
+
+			/* Start a new block whenever the last one is full. */
+			if (blockLeft == 0)
+			{
+				blockLeft = (imageLeft < MAX_STORED_BLOCK) ? imageLeft
+														   : MAX_STORED_BLOCK;
+				imageLeft -= blockLeft;
+
+				block = out;
+				block[0] = (imageLeft == 0) ? 1 : 0;
+				block[1] = (Uint8)(blockLeft);
+				block[2] = (Uint8)(blockLeft >> 8);
+				block[3] = (Uint8)(~blockLeft);
+				block[4] = (Uint8)(~blockLeft >> 8);
+				out += 5;
+			}
+
+			*out++ = byte;
+			blockLeft--;
+
+			/* The Adler-32 sums can take ADLER_RUN bytes before they have
+			   to be reduced. */
+			adlerA += byte;
+			adlerB += adlerA;
+			if (++adlerRun == ADLER_RUN)
+			{
+				adlerA %= 65521;
+				adlerB %= 65521;
+				adlerRun = 0;
+			}
+		}
+	}
+
+	putUint32(out, ((adlerB % 65521) << 16) | (adlerA % 65521));
+	out = endChunk(data, idatLength);
+
+	/*** IEND. ***/
+	out = endChunk(beginChunk(out, "IEND", 0), 0);
+
+	return (size_t)(out - writer->encoded);
+}
+
+/**
+@fn encodeY4m
+@brief Converts a frame to the full-range BT.601 Y, Cb and Cr planes of a
+YUV4MPEG2 frame in the writer's scratch buffer. Each chroma sample is taken
+from the average of a 2x2 block of pixels.
+@param writer Pointer to the FrameWriter.
+@param frame The frame's RGBA pixels.
+@return The size of the planes.
+*/
+static size_t encodeY4m (FrameWriter *writer, const Uint8 *frame)
+{
+	int width = writer->width, height = writer->height;
+	int chromaWidth = (width + 1) / 2, chromaHeight = (height + 1) / 2;
+	Uint8 *luma = writer->encoded;
+	Uint8 *blue = luma + (size_t)(width) * height;
+	Uint8 *red = blue + (size_t)(chromaWidth) * chromaHeight;
+
+	/*** Luma: Y = 0.299 R + 0.587 G + 0.114 B, in 8.8 fixed point. ***/
+	for (size_t i = 0; i < (size_t)(width) * height; i++)
+	{
+		const Uint8 *pixel = frame + 4 * i;
+
+		luma[i] = (Uint8)((77 * pixel[0] + 150 * pixel[1] + 29 * pixel[2] +
+						   128) >> 8);
+	}
+
+	/*** Chroma, from the sums of each 2x2 block (clamped at the edges). ***/
+	for (int y = 0; y < chromaHeight; y++)
+	{
+		for (int x = 0; x < chromaWidth; x++)
+		{
+			int r = 0, g = 0, b = 0;
+
+			for (int dy = 0; dy < 2; dy++)
+			{
+				for (int dx = 0; dx < 2; dx++)
+				{
+					int px = (2 * x + dx < width) ? 2 * x + dx : width - 1;
+					int py = (2 * y + dy < height) ? 2 * y + dy : height - 1;
+					const Uint8 *pixel = frame + ((size_t)(py) * width + px) * 4;
+
+					r += pixel[0];
+					g += pixel[1];
+					b += pixel[2];
+				}
+			}
+
+			/* Cb = 128 - 0.169 R - 0.331 G + 0.5 B and
+			   Cr = 128 + 0.5 R - 0.419 G - 0.081 B, from sums of four (rounded
+			   just under a half, so pure blue or red stays within 255). */
+			size_t i = (size_t)(y) * chromaWidth + x;
+
+			blue[i] = (Uint8)(((-43 * r - 85 * g + 128 * b) +
+							   (128 << 10) + 511) >> 10);
+			red[i] = (Uint8)(((128 * r - 107 * g - 21 * b) +
+							  (128 << 10) + 511) >> 10);
+		}
+	}
+
+	return getY4mSize(width, height);
+}
+
+/**
+@fn writeFrame
+@brief Encodes a frame and writes it out.
+@param writer Pointer to the FrameWriter.
+@param frame The frame's RGBA pixels.
+@param number The frame's number, counting from 0.
+@return True if the frame was written, false otherwise.
+*/
+static bool writeFrame (FrameWriter *writer, const Uint8 *frame, Uint32 number)
+{
+	if (writer->format == FRAME_FORMAT_Y4M)
+	{
+		size_t size = encodeY4m(writer, frame);
+
+		return fputs("FRAME\n", writer->file) >= 0 &&
+			   fwrite(writer->encoded, 1, size, writer->file) == size;
+	}
+
+	char fileName[4096];
+	FILE *file;
+	size_t size = encodePng(writer, frame);
+
+	snprintf(fileName, sizeof(fileName), "%s%06u.png", writer->fileName,
+			 number);
+	if (!( file = fopen(fileName, "wb") ))
+	{
+		return false;
+	}
+
+	bool written = (fwrite(writer->encoded, 1, size, file) == size);
+
+	return (fclose(file) == 0) && written;
+}
+
+/**
+@fn writeFrames
+@brief Thread entry point that writes each queued frame in turn until the
+writer is closed and every frame has been written. Once a frame can't be
+written, the rest are dropped.
+@param data Pointer to the FrameWriter.
+@return NULL.
+*/
+static void *writeFrames (void *data)
+{
+	FrameWriter *writer = (FrameWriter*)(data);
+
+	while (true)
+	{
+		pthread_mutex_lock(&writer->lock);
+		while (writer->written == writer->queued && !writer->closing)
+		{
+			pthread_cond_wait(&writer->frameQueued, &writer->lock);
+		}
+
+		if (writer->written == writer->queued)
+		{
+			pthread_mutex_unlock(&writer->lock);
+			break;
+		}
+
+		Uint32 number = writer->written;
+		bool failed = writer->failed;
+		pthread_mutex_unlock(&writer->lock);
+
+		/* The frame's buffer isn't touched by anyone else until it has been
+		   counted as written. */
+		if (!failed)
+		{
+			failed = !writeFrame(writer,
+								 writer->frames[number % FRAME_QUEUE_LENGTH],
+								 number);
+		}
+
+		pthread_mutex_lock(&writer->lock);
+		writer->failed = writer->failed || failed;
+		writer->written++;
+		pthread_cond_signal(&writer->frameWritten);
+		pthread_mutex_unlock(&writer->lock);
+	}
+
+	return NULL;
+}
+
+/**
+@fn freeFrameWriter
+@brief Closes a FrameWriter's stream and frees its buffers and itself.
+@param writer Pointer to the FrameWriter. Its thread must not be running.
+@return True if the stream was closed (or there was none), false otherwise.
+*/
+static bool freeFrameWriter (FrameWriter *writer)
+{
+	bool closed = (writer->file == NULL || fclose(writer->file) == 0);
+
+	for (int i = 0; i < FRAME_QUEUE_LENGTH; i++)
+	{
+		free(writer->frames[i]);
+	}
+	free(writer->encoded);
+	free(writer);
+
+	return closed;
+}
+
+/**
+@fn openFrameWriter
+@brief Starts writing a video, in the format its file name asks for.
+@details Writes the YUV4MPEG2 stream's header (with XCOLORRANGE=FULL, since
+C420jpeg only gives the chroma siting and readers would otherwise take the
+samples to be limited range), then starts the writer thread.
+@param fileName The name of the ".y4m" file, or the prefix of the PNG files.
+@param width The width of each frame (in pixels).
+@param height The height of each frame (in pixels).
+@param framesPerSecond The frame rate written into a YUV4MPEG2 stream.
+@return Pointer to the new FrameWriter, or NULL if the video can't be started.
+*/
+FrameWriter *openFrameWriter (char *fileName, int width, int height,
+							  int framesPerSecond)
+{
+	FrameWriter *writer;
+	size_t nameLength = strlen(fileName);
+	size_t frameSize = (size_t)(width) * height * 4;
+	bool allocated = true;
+
+	if (width <= 0 || height <= 0 ||
+		!( writer = (FrameWriter*)calloc(1, sizeof(FrameWriter)) ))
+	{
+		return NULL;
+	}
+
+	writer->format = (nameLength >= 4 &&
+					  strcmp(fileName + nameLength - 4, ".y4m") == 0) ?
+					 FRAME_FORMAT_Y4M : FRAME_FORMAT_PNG;
+	writer->fileName = fileName;
+	writer->width = width;
+	writer->height = height;
+
+	/*** Allocate the ring of frames and the scratch buffer. ***/
+	for (int i = 0; i < FRAME_QUEUE_LENGTH; i++)
+	{
+		allocated = (writer->frames[i] = (Uint8*)malloc(frameSize)) &&
+					allocated;
+	}
+	writer->encoded = (Uint8*)malloc((writer->format == FRAME_FORMAT_Y4M) ?
+									 getY4mSize(width, height) :
+									 getPngSize(width, height));
+
+	if (!allocated || writer->encoded == NULL)
+	{
+		freeFrameWriter(writer);
+		return NULL;
+	}
+
+	/*** Open the stream, or get ready to checksum PNG chunks. ***/
+	if (writer->format == FRAME_FORMAT_Y4M)
+	{
+		if (!( writer->file = fopen(fileName, "wb") ) ||
+			fprintf(writer->file, "YUV4MPEG2 W%d H%d F%d:1 Ip A1:1 C420jpeg "
+					"XCOLORRANGE=FULL\n", width, height, framesPerSecond) < 0)
+		{
+			freeFrameWriter(writer);
+			return NULL;
+		}
+	}
+	else
+	{
+		buildCrcTable();
+	}
+
+	/*** Start the writer thread. ***/
+	pthread_mutex_init(&writer->lock, NULL);
+	pthread_cond_init(&writer->frameQueued, NULL);
+	pthread_cond_init(&writer->frameWritten, NULL);
+
+	if (pthread_create(&writer->writer, NULL, writeFrames, writer) != 0)
+	{
+		pthread_cond_destroy(&writer->frameWritten);
+		pthread_cond_destroy(&writer->frameQueued);
+		pthread_mutex_destroy(&writer->lock);
+		freeFrameWriter(writer);
+		return NULL;
+	}
+
+	return writer;
+}
+
+/**
+@fn reserveFrame
+@brief Finds the buffer to draw the next frame into, waiting for the writer
+thread to finish with it first if every buffer is full.
+@param writer Pointer to the FrameWriter.
+@return Pointer to the buffer, which is the writer's again once the frame is
+queued by queueFrame.
+*/
+Uint8 *reserveFrame (FrameWriter *writer)
+{
+	pthread_mutex_lock(&writer->lock);
+	while (writer->queued - writer->written == FRAME_QUEUE_LENGTH)
+	{
+		pthread_cond_wait(&writer->frameWritten, &writer->lock);
+	}
+	Uint32 number = writer->queued;
+	pthread_mutex_unlock(&writer->lock);
+
+	return writer->frames[number % FRAME_QUEUE_LENGTH];
+}
+
+/**
+@fn queueFrame
+@brief Hands the frame drawn into the buffer found by reserveFrame to the
+writer thread.
+@param writer Pointer to the FrameWriter.
+*/
+void queueFrame (FrameWriter *writer)
+{
+	pthread_mutex_lock(&writer->lock);
+	writer->queued++;
+	pthread_cond_signal(&writer->frameQueued);
+	pthread_mutex_unlock(&writer->lock);
+}
+
+/**
+@fn closeFrameWriter
+@brief Waits for every queued frame to be written, then stops the writer
+thread and frees the FrameWriter.
+@param writer Pointer to the FrameWriter to close.
+@return True if every frame was written, false otherwise.
+*/
+bool closeFrameWriter (FrameWriter *writer)
+{
+	pthread_mutex_lock(&writer->lock);
+	writer->closing = true;
+	pthread_cond_signal(&writer->frameQueued);
+	pthread_mutex_unlock(&writer->lock);
+
+	pthread_join(writer->writer, NULL);
+
+	bool written = !writer->failed;
+
+	pthread_cond_destroy(&writer->frameWritten);
+	pthread_cond_destroy(&writer->frameQueued);
+	pthread_mutex_destroy(&writer->lock);
+
+	return freeFrameWriter(writer) && written;
+}
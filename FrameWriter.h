@@ -0,0 +1,126 @@
+/**
+@file FrameWriter.h
+@author Rob Thomas
+@brief Contains functions for writing rendered frames out as video on a
+separate thread.
+@details Frames are RGBA images (four bytes per pixel, in that order, with no
+padding between rows). They are queued in a ring of FRAME_QUEUE_LENGTH
+buffers, and a writer thread encodes and writes them in order while the next
+ones are simulated and drawn. Drawing only waits on the writer when every
+buffer is full.
+
+A file name ending in ".y4m" is written as a single YUV4MPEG2 stream (4:2:0,
+full range), which video encoders such as ffmpeg read directly. Any other name
+is used as the prefix of a numbered sequence of PNG files (prefix000000.png,
+prefix000001.png and so on). The PNGs are stored without compression, so no
+compression library is needed.
+*/
+
+#ifndef LUNAR_LANDER_FRAMEWRITER_H
+#define LUNAR_LANDER_FRAMEWRITER_H
+
+#include <SDL2/SDL.h>
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+/**
+@def FRAME_QUEUE_LENGTH
+@brief The number of frames that can be waiting to be written at once.
+*/
+#define FRAME_QUEUE_LENGTH 8
+
+/**
+@def FRAME_FORMAT_Y4M
+@brief A FrameWriter's format when it writes a YUV4MPEG2 stream.
+*/
+#define FRAME_FORMAT_Y4M 0
+
+/**
+@def FRAME_FORMAT_PNG
+@brief A FrameWriter's format when it writes a sequence of PNG files.
+*/
+#define FRAME_FORMAT_PNG 1
+
+/**
+@typedef FrameWriter
+@brief A video being written by a writer thread.
+*/
+typedef struct FrameWriter
+{
+	/* FRAME_FORMAT_Y4M or FRAME_FORMAT_PNG, and the file name (the prefix of
+	   the PNG files). */
+	int format;
+	char *fileName;
+
+	/* The YUV4MPEG2 stream being written (NULL for PNG files). */
+	FILE *file;
+
+	/* The size of each frame (in pixels). */
+	int width;
+	int height;
+
+	/* The ring of frame buffers, each width * height * 4 bytes. */
+	Uint8 *frames[FRAME_QUEUE_LENGTH];
+
+	/* Scratch space the writer thread encodes a frame into. */
+	Uint8 *encoded;
+
+	/* The number of frames queued and written so far. Frame n is held in
+	   frames[n % FRAME_QUEUE_LENGTH] from when it is queued until it has been
+	   written. Both, closing and failed are guarded by lock. */
+	Uint32 queued;
+	Uint32 written;
+	bool closing;
+	bool failed;
+
+	/* The writer thread, and the conditions it waits on (a frame has been
+	   queued, or the writer is closing) and signals (a frame has been
+	   written). */
+	pthread_t writer;
+	pthread_mutex_t lock;
+	pthread_cond_t frameQueued;
+	pthread_cond_t frameWritten;
+} FrameWriter;
+
+/**
+@fn openFrameWriter
+@brief Starts writing a video, in the format its file name asks for.
+@param fileName The name of the ".y4m" file, or the prefix of the PNG files.
+@param width The width of each frame (in pixels).
+@param height The height of each frame (in pixels).
+@param framesPerSecond The frame rate written into a YUV4MPEG2 stream.
+@return Pointer to the new FrameWriter, or NULL if the video can't be started.
+*/
+FrameWriter *openFrameWriter (char *fileName, int width, int height,
+							  int framesPerSecond);
+
+/**
+@fn reserveFrame
+@brief Finds the buffer to draw the next frame into, waiting for the writer
+thread to finish with it first if every buffer is full.
+@param writer Pointer to the FrameWriter.
+@return Pointer to the buffer, which is the writer's again once the frame is
+queued by queueFrame.
+*/
+Uint8 *reserveFrame (FrameWriter *writer);
+
+/**
+@fn queueFrame
+@brief Hands the frame drawn into the buffer found by reserveFrame to the
+writer thread.
+@param writer Pointer to the FrameWriter.
+*/
+void queueFrame (FrameWriter *writer);
+
+/**
+@fn closeFrameWriter
+@brief Waits for every queued frame to be written, then stops the writer
+thread and frees the FrameWriter.
+@param writer Pointer to the FrameWriter to close.
+@return True if every frame was written, false otherwise.
+*/
+bool closeFrameWriter (FrameWriter *writer);
+
+#endif /* LUNAR_LANDER_FRAMEWRITER_H */
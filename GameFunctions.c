@@ -8,14 +8,18 @@ lunar lander game.
 
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_mixer.h>
-#include <SDL2/SDL2_gfxPrimitives.h>
 
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 #include <math.h>
 
 #include "GameObjects.h"
 #include "GameInitialization.h"
+#include "Simulation.h"
+#include "Replay.h"
+#include "TerrainCache.h"
+#include "TextCache.h"
 
 #include "GameFunctions.h"
 
@@ -27,52 +31,314 @@ lunar lander game.
          to the beginning of the level seemlessly. */
 
 
+/**
+@fn initializeRenderSnapshot
+@brief Empties a RenderSnapshot, so it can be taken by takeRenderSnapshot.
+@param snapshot Pointer to the RenderSnapshot.
+*/
+void initializeRenderSnapshot (RenderSnapshot *snapshot)
+{
+	memset(snapshot, 0, sizeof(RenderSnapshot));
+}
+
+/**
+@fn freeRenderSnapshot
+@brief Frees the arrays a RenderSnapshot's copies are kept in, leaving it
+empty.
+@param snapshot Pointer to the RenderSnapshot.
+*/
+void freeRenderSnapshot (RenderSnapshot *snapshot)
+{
+	free(snapshot->terrain.vertices);
+	free(snapshot->wrapped.vertices);
+	free(snapshot->heights);
+	free(snapshot->labels);
+	free(snapshot->points);
+
+	initializeRenderSnapshot(snapshot);
+}
+
+/**
+@fn copyVertexRun
+@brief Copies the Vertexes whose lines cross a run of columns into a
+VertexRun, growing its array if it is too small.
+@param terrain Pointer to the Terrain to copy from.
+@param first The first column of the run.
+@param last The last column of the run.
+@param run Pointer to the VertexRun to copy into. Left without Vertexes if the
+columns are past all of the terrain, or its array can't be grown.
+*/
+static void copyVertexRun (const Terrain *terrain, int first, int last,
+						   VertexRun *run)
+{
+	Uint32 start, end;
+
+	run->first = first;
+	run->last = last;
+	run->numVertices = 0;
+
+	if (!findColumnVertices(terrain->vertices, terrain->numVertices, first,
+							last, &start, &end))
+	{
+		return;
+	}
+
+	Uint32 count = end - start + 1;
+
+	if (count > run->capacity)
+	{
+		Uint32 capacity = max(count, 2 * run->capacity);
+		Vertex *vertices = (Vertex*)realloc(run->vertices,
+											capacity * sizeof(Vertex));
+
+		if (vertices == NULL)
+		{
+			return;
+		}
+
+		run->vertices = vertices;
+		run->capacity = capacity;
+	}
+
+	memcpy(run->vertices, &terrain->vertices[start], count * sizeof(Vertex));
+	run->numVertices = count;
+}
+
+/**
+@fn addScoreLabel
+@brief Adds a label to a RenderSnapshot's score modifiers, growing its array
+if it is full.
+@param snapshot Pointer to the RenderSnapshot.
+@return Pointer to the new ScoreLabel, or NULL if the array couldn't be grown.
+*/
+static ScoreLabel *addScoreLabel (RenderSnapshot *snapshot)
+{
+	if (snapshot->numLabels == snapshot->labelCapacity)
+	{
+		Uint32 capacity = max(16, 2 * snapshot->labelCapacity);
+		ScoreLabel *labels = (ScoreLabel*)realloc(snapshot->labels,
+											capacity * sizeof(ScoreLabel));
+
+		if (labels == NULL)
+		{
+			return NULL;
+		}
+
+		snapshot->labels = labels;
+		snapshot->labelCapacity = capacity;
+	}
+
+	return &snapshot->labels[snapshot->numLabels++];
+}
+
+/**
+@fn copyScoreLabels
+@brief Finds where to draw the score modifier of each strip of flat landing
+terrain in the window.
+@details Only the strips from the first one that doesn't end left of the
+window (found in the terrain's Flat table) to the last one starting in it are
+visited, wrapping around to the start of the level if the window does.
+@param terrain Pointer to the Terrain to find the strips in.
+@param snapshot Pointer to the RenderSnapshot, whose focus point and level
+width have been copied.
+*/
+static void copyScoreLabels (const Terrain *terrain, RenderSnapshot *snapshot)
+{
+	Uint32 index = terrain->flatTable[snapshot->focusPointX];
+	Sint64 rightEdge = (Sint64)(snapshot->focusPointX) + WINDOW_WIDTH + 8;
+
+	snapshot->numLabels = 0;
+
+	for (Uint32 visited = 0; visited < terrain->numFlats; visited++, index++)
+	{
+		/* Past the last strip, carry on from the first. */
+		if (index >= terrain->numFlats)
+		{
+			index = 0;
+			rightEdge -= snapshot->levelWidth;
+		}
+
+		Flat *current = &terrain->flats[index];
+
+		if (current->X > rightEdge)
+		{
+			break;
+		}
+
+		/* For the current Flat, find the midpoint of its length, and put the
+		   label under that point. */
+		if (current->scoreModifier > 0)
+		{
+			ScoreLabel *label;
+
+			if (!( label = addScoreLabel(snapshot) ))
+			{
+				return;
+			}
+
+			label->X = current->X + (current->length / 2) - 8 -
+					   snapshot->focusPointX;
+			if (label->X < 0)
+			{
+				label->X += snapshot->levelWidth;
+			}
+
+			label->Y = snapshot->focusPointY - (current->Y - TEXT_Y_DELTA);
+			label->scoreModifier = current->scoreModifier;
+		}
+	}
+}
+
+/**
+@fn takeRenderSnapshot
+@brief Copies what the next frame draws out of the game state.
+@details Everything drawn is copied, so the game state can change as soon as
+this returns. The terrain's Vertexes are copied for the columns in the window,
+or for those of the tiles it crosses if the terrain is cached (see
+findCachedColumns). The columns the terrain has changed in are handed over to
+the snapshot, so the terrain's record of them starts again empty. One snapshot
+should therefore be taken, and drawn, for each frame.
+@param state Pointer to the current GameState struct.
+@param snapshot Pointer to the RenderSnapshot to take, which has been
+initialized by initializeRenderSnapshot.
+*/
+void takeRenderSnapshot (GameState *state, RenderSnapshot *snapshot)
+{
+	Terrain *terrain = state->terrain;
+	Uint32 levelWidth = state->levelWidth;
+	Sint32 focusPointX = state->focusPointX;
+
+	snapshot->renderer = state->renderer;
+	snapshot->terrainCache = state->terrainCache;
+	snapshot->textCache = state->textCache;
+	snapshot->levelWidth = levelWidth;
+
+	/*** Take the terrain's changed columns. ***/
+	snapshot->changedFirst = terrain->changedFirst;
+	snapshot->changedLast = terrain->changedLast;
+	terrain->changedFirst = 1;
+	terrain->changedLast = 0;
+
+	/*** Copy the lander, focus point and HUD. ***/
+	snapshot->lander = *state->lander;
+	snapshot->focusPointX = focusPointX;
+	snapshot->focusPointY = state->focusPointY;
+	snapshot->realFocusPointX = state->realFocusPointX;
+	snapshot->realFocusPointY = state->realFocusPointY;
+	snapshot->score = state->score;
+	snapshot->fuel = state->fuel;
+	snapshot->minutes = getMinutes(*state);
+	snapshot->seconds = getSeconds(*state);
+	snapshot->altitude = getAltitude(*state);
+	snapshot->timeElapsed = state->timeElapsed;
+
+	/*** Copy the Vertexes of the columns drawn. If the right edge of the
+	     window has wrapped around the end of the level, the lines from the
+	     Vertex with the lowest X up to it are drawn too. ***/
+	int first, last, wrappedLast;
+	bool wraps;
+
+	if (state->terrainCache != NULL)
+	{
+		wraps = findCachedColumns(levelWidth, focusPointX, &first, &last,
+								  &wrappedLast);
+	}
+	else
+	{
+		int rightEdge = (focusPointX + WINDOW_WIDTH) % levelWidth;
+
+		first = focusPointX;
+		last = focusPointX + WINDOW_WIDTH;
+		wrappedLast = rightEdge - 1;
+		wraps = ( rightEdge <= focusPointX );
+	}
+
+	copyVertexRun(terrain, first, last, &snapshot->terrain);
+
+	if (wraps)
+	{
+		copyVertexRun(terrain, -1, wrappedLast, &snapshot->wrapped);
+	}
+	else
+	{
+		snapshot->wrapped.first = 0;
+		snapshot->wrapped.last = -1;
+		snapshot->wrapped.numVertices = 0;
+	}
+
+	/*** Copy the heights of the window's columns. ***/
+	if (snapshot->heights != NULL ||
+		( snapshot->heights = (Uint16*)malloc(WINDOW_WIDTH * sizeof(Uint16)) ))
+	{
+		for (int i = 0; i < WINDOW_WIDTH; i++)
+		{
+			snapshot->heights[i] =
+				terrain->heightMap[(i + focusPointX) % levelWidth];
+		}
+	}
+
+	/*** Find the score modifiers in the window. ***/
+	copyScoreLabels(terrain, snapshot);
+}
+
 /**
 @fn draw
 @brief Draws the game to the window.
-@param state The GameState representing the state of the game at this instant.
+@param snapshot Pointer to the RenderSnapshot of the game at this instant.
+*/
+void draw (RenderSnapshot *snapshot)
+{
+	/*** Draw the scene. ***/
+	drawScene(snapshot);
+
+	/*** Present the drawn renderer. ***/
+	SDL_RenderPresent(snapshot->renderer);
+}
+
+/**
+@fn drawScene
+@brief Draws the game onto the renderer's target without presenting it, so the
+same scene can be drawn into a window or into memory.
+@param snapshot Pointer to the RenderSnapshot of the game at this instant.
 */
-void draw (GameState state)
+void drawScene (RenderSnapshot *snapshot)
 {
 	/*** Clear screen to black. ***/
-	SDL_SetRenderDrawColor(state.renderer, 0, 0, 0, 255);
-	SDL_RenderClear(state.renderer);
+	SDL_SetRenderDrawColor(snapshot->renderer, 0, 0, 0, 255);
+	SDL_RenderClear(snapshot->renderer);
 
 	/*** @TODO: If the lander is close to the ground, zoom in 2x. ***/
 
 	/*** Draw the lander. ***/
-	drawLander(state);
+	drawLander(snapshot);
 
 	/*** Draw terrain. ***/
-	drawTerrain(state);
+	drawTerrain(snapshot);
 
 	/* @DEBUG: Optionally, draw the height map in red as well. */
-	/* drawHeightMap(state); */
+	/* drawHeightMap(snapshot); */
 
 	/*** Draw score modifiers. ***/
-	drawScoreModifiers(state);
+	drawScoreModifiers(snapshot);
 
 	/*** Draw text. ***/
-	drawStandardInfo(state);
+	drawStandardInfo(snapshot);
 
 	/*** @DEBUG: Optionally, draw debug text. ***/
-	/* drawDebugInfo(state); */
+	/* drawDebugInfo(snapshot); */
 	
 	/*** @TODO: Draw background. ***/
-
-	/*** Present the drawn renderer. ***/
-	SDL_RenderPresent(state.renderer);
 }
 
 /**
 @fn drawLander
 @brief Draws the lander to the window.
-@param state The current GameState struct.
+@param snapshot Pointer to the RenderSnapshot being drawn.
 */
-void drawLander (GameState state)
+void drawLander (RenderSnapshot *snapshot)
 {
 	/* Lander is drawn in white. */
-	SDL_SetRenderDrawColor(state.renderer, 255, 255, 255, 255);
+	SDL_SetRenderDrawColor(snapshot->renderer, 255, 255, 255, 255);
 		/* In current version, lander is represented by the line denoting
 		   its bottom. 
 		   Recall that the point at (0, 0) is at the TOP-left of the screen,
@@ -82,165 +348,283 @@ void drawLander (GameState state)
 	/* Account for the lander being left of the focus point (wrapping around the
 	   level border without the focus point doing so). In this case, shift the
 	   lander's coordinates right by the length of the level. */
-	if (state.lander->X < state.focusPointX)
+	if (snapshot->lander.X < snapshot->focusPointX)
 	{
-		SDL_RenderDrawLine(state.renderer, 
-			(int)( state.lander->X + state.levelWidth - state.focusPointX), 
-			(int)( state.focusPointY - state.lander->Y ),
-			(int)( state.lander->X + state.lander->length + state.levelWidth - state.focusPointX ), 
-			(int)( state.focusPointY - state.lander->Y ));
+		SDL_RenderDrawLine(snapshot->renderer, 
+			(int)( snapshot->lander.X + snapshot->levelWidth - snapshot->focusPointX), 
+			(int)( snapshot->focusPointY - snapshot->lander.Y ),
+			(int)( snapshot->lander.X + snapshot->lander.length + snapshot->levelWidth - snapshot->focusPointX ), 
+			(int)( snapshot->focusPointY - snapshot->lander.Y ));
 	}
 
 	else
 	{
-		SDL_RenderDrawLine(state.renderer, 
-		    (int)( state.lander->X - state.focusPointX), 
-		    (int)( state.focusPointY - state.lander->Y ),
-		    (int)( state.lander->X + state.lander->length - state.focusPointX ), 
-		    (int)( state.focusPointY - state.lander->Y ));
+		SDL_RenderDrawLine(snapshot->renderer, 
+		    (int)( snapshot->lander.X - snapshot->focusPointX), 
+		    (int)( snapshot->focusPointY - snapshot->lander.Y ),
+		    (int)( snapshot->lander.X + snapshot->lander.length - snapshot->focusPointX ), 
+		    (int)( snapshot->focusPointY - snapshot->lander.Y ));
 	}
 }
 
 /**
-@fn drawTerrain
-@brief Draws the terrain of the level using the list of vertices.
-@param state The current GameState struct.
+@fn findFirstVisibleVertex
+@brief Finds where to begin drawing the terrain for a given left edge.
+@details Binary searches the (sorted) Vertex array for the first Vertex whose X
+is greater than leftEdge. Drawing begins at the Vertex BEFORE this one, since
+the line from it to the next crosses the left edge.
+@param vertices The Vertex array to search.
+@param numVertices The number of Vertexes in the array.
+@param leftEdge The X of the left edge of the window.
+@return The index of the Vertex to begin drawing at.
 */
-void drawTerrain (GameState state)
+static Uint32 findFirstVisibleVertex (const Vertex *vertices,
+									  Uint32 numVertices, int leftEdge)
 {
-	/* Begin at the first Vertex. */
-	Vertex *prev = NULL;
-	Vertex *current = state.terrain->firstVertex;
-
-	/* Scroll along the Vertex list until you find a Vertex whose X is greater 
-	   than that of the focus point. Begin drawing at the Vertex BEFORE this 
-	   one. */
-	while (current != NULL && current->X <= state.focusPointX)
+	Uint32 low = 0, high = numVertices;
+
+	while (low < high)
 	{
-		prev = current;
+		Uint32 middle = low + (high - low) / 2;
 
-		current = current->next;
+		if (vertices[middle].X <= leftEdge)
+		{
+			low = middle + 1;
+		}
+		else
+		{
+			high = middle;
+		}
 	}
-	/* If there is no Vertex meeting this criterion, then the focus point is 
-	   past all of the terrain - draw nothing and return. */
-	if (current == NULL)
+
+	return (low > 0) ? low - 1 : 0;
+}
+
+/**
+@fn reserveDrawPoints
+@brief Makes a snapshot's buffer of points handed to the renderer hold at least
+a given number of points.
+@details The buffer is kept from frame to frame, so it is only reallocated
+when more points are in view than ever before.
+@param snapshot Pointer to the RenderSnapshot being drawn.
+@param count The number of points needed.
+@return Pointer to the buffer, or NULL if it couldn't be grown.
+*/
+static SDL_Point *reserveDrawPoints (RenderSnapshot *snapshot, Uint32 count)
+{
+	if (count > snapshot->pointCapacity)
 	{
-		return;
+		Uint32 capacity = max(count, 2 * snapshot->pointCapacity);
+		SDL_Point *points = (SDL_Point*)realloc(snapshot->points,
+												capacity * sizeof(SDL_Point));
+
+		if (points == NULL)
+		{
+			return NULL;
+		}
+
+		snapshot->points = points;
+		snapshot->pointCapacity = capacity;
 	}
-	/* If the first Vertex in the list meets this criterion, begin drawing
-	   with it instead. */
-	if (prev == NULL)
+
+	return snapshot->points;
+}
+
+/**
+@fn drawTerrainLines
+@brief Draws the lines between a run of Vertexes in a single call to the
+renderer.
+@param snapshot Pointer to the RenderSnapshot being drawn.
+@param vertices The first Vertex of the run.
+@param count The number of Vertexes in the run.
+@param originX The column drawn at the left edge of the renderer's target.
+@param originY The height drawn at the top edge of the renderer's target.
+*/
+static void drawTerrainLines (RenderSnapshot *snapshot, const Vertex *vertices,
+							  Uint32 count, int originX, int originY)
+{
+	SDL_Point *points;
+
+	if (count < 2 || !( points = reserveDrawPoints(snapshot, count) ))
 	{
-		prev = state.terrain->firstVertex;
+		return;
 	}
 
-	/* Set draw color to white. */
-	SDL_SetRenderDrawColor(state.renderer, 255, 255, 255, 255);
+	for (Uint32 i = 0; i < count; i++)
+	{
+		points[i].x = vertices[i].X - originX;
+		points[i].y = originY - vertices[i].Y;
+	}
 
-	/* For each Vertex up to but not including the first Vertex whose X is 
-	   greater than focusPointX + WINDOW_WIDTH (the window with focus), 
-	   draw a line to the next Vertex. */
-	int rightEdge = max(state.focusPointX + WINDOW_WIDTH, state.levelWidth);
+	SDL_RenderDrawLines(snapshot->renderer, points, (int)(count));
+}
 
-	while (current != NULL && prev->X <= rightEdge)
+/**
+@fn findColumnVertices
+@brief Finds the run of Vertexes whose lines cross a run of columns.
+@param vertices The Vertex array to search.
+@param numVertices The number of Vertexes in the array.
+@param first The first column of the run.
+@param last The last column of the run.
+@param start Buffer for the index of the first Vertex of the lines.
+@param end Buffer for the index of the last Vertex of the lines.
+@return True if any line crosses the columns, false if they are past all of the
+terrain.
+*/
+bool findColumnVertices (const Vertex *vertices, Uint32 numVertices, int first,
+						 int last, Uint32 *start, Uint32 *end)
+{
+	/* Find the first line that crosses into the run. If there is none, then
+	   the run is past all of the terrain. */
+	if (numVertices < 2 || vertices[numVertices - 1].X <= first)
 	{
-		SDL_RenderDrawLine( state.renderer, (int)(prev->X - state.focusPointX), 
-			                (int)(state.focusPointY - prev->Y),
-			                (int)(current->X - state.focusPointX),
-			                (int)(state.focusPointY - current->Y) );
+		return false;
+	}
+	*start = findFirstVisibleVertex(vertices, numVertices, first);
+
+	/* The lines run from each Vertex up to but not including the first Vertex
+	   whose X is greater than last to the next Vertex. */
+	for (*end = *start; *end + 1 < numVertices && vertices[*end].X <= last;
+		 (*end)++);
 
-		prev = current;
-		current = current->next;
+	return true;
+}
+
+/**
+@fn findVertexRun
+@brief Finds the run of Vertexes copied into a snapshot that covers a run of
+columns.
+@param snapshot Pointer to the RenderSnapshot being drawn.
+@param first The first column of the run.
+@param last The last column of the run.
+@return Pointer to the VertexRun, or NULL if neither of the snapshot's runs
+covers the columns.
+*/
+const VertexRun *findVertexRun (const RenderSnapshot *snapshot, int first,
+								int last)
+{
+	if (snapshot->terrain.first <= first && last <= snapshot->terrain.last)
+	{
+		return &snapshot->terrain;
+	}
+	if (snapshot->wrapped.first <= first && last <= snapshot->wrapped.last)
+	{
+		return &snapshot->wrapped;
 	}
 
-	/* Now, draw a line between each Vertex and the next so long as their Xs are
-	   less than the right boundary of the focus window AND the right boundary
-	   has wrapped around the level boundary. */
-	rightEdge = (state.focusPointX + WINDOW_WIDTH) % state.levelWidth;
+	return NULL;
+}
 
-	if ( rightEdge <= state.focusPointX )
+/**
+@fn drawTerrainColumns
+@brief Draws the lines of the terrain that cross a run of columns, in a single
+call to the renderer.
+@param snapshot Pointer to the RenderSnapshot being drawn. One of its runs of
+Vertexes must cover the columns, or nothing is drawn.
+@param first The first column of the run.
+@param last The last column of the run.
+@param originX The column drawn at the left edge of the renderer's target.
+@param originY The height drawn at the top edge of the renderer's target.
+*/
+void drawTerrainColumns (RenderSnapshot *snapshot, int first, int last,
+						 int originX, int originY)
+{
+	const VertexRun *run = findVertexRun(snapshot, first, last);
+	Uint32 start, end;
+
+	if (run != NULL && findColumnVertices(run->vertices, run->numVertices,
+										  first, last, &start, &end))
 	{
-		/* The Vertex with the lowest X will be Vertex first, so begin there. */
-		prev = state.terrain->firstVertex;
-		current = prev->next;
+		drawTerrainLines(snapshot, &run->vertices[start], end - start + 1,
+						 originX, originY);
+	}
+}
 
-		while ( prev->X < rightEdge && current != NULL )
-		{
-			SDL_RenderDrawLine( state.renderer, 
-								prev->X - state.focusPointX + state.levelWidth,
-								state.focusPointY - prev->Y,
-								current->X - state.focusPointX + state.levelWidth,
-								state.focusPointY - current->Y );
-
-			prev = prev->next;
-			current = current->next;
-		}
+/**
+@fn drawTerrain
+@brief Draws the terrain of the level using the array of vertices.
+@details If the terrain is cached in textures, the visible part of it is copied
+from them (see TerrainCache.h). Otherwise only the lines that are in the window
+with focus are drawn, so the cost of drawing depends on how much of the terrain
+is visible rather than on how many vertices the level has. The visible lines
+are handed to the renderer as one polyline (two, if the window wraps around the
+end of the level), so the number of draw calls stays the same however detailed
+the terrain is. Their Vertexes were copied when the snapshot was taken.
+@param snapshot Pointer to the RenderSnapshot being drawn.
+*/
+void drawTerrain (RenderSnapshot *snapshot)
+{
+	/* Set draw color to white. */
+	SDL_SetRenderDrawColor(snapshot->renderer, 255, 255, 255, 255);
+
+	if (snapshot->terrainCache != NULL)
+	{
+		drawCachedTerrain(snapshot);
+		return;
 	}
+
+	/* Draw the lines that cross the window with focus, then those past the
+	   end of the level if the window wraps around it. */
+	drawTerrainLines(snapshot, snapshot->terrain.vertices,
+					 snapshot->terrain.numVertices, snapshot->focusPointX,
+					 snapshot->focusPointY);
+	drawTerrainLines(snapshot, snapshot->wrapped.vertices,
+					 snapshot->wrapped.numVertices,
+					 snapshot->focusPointX - (int)(snapshot->levelWidth),
+					 snapshot->focusPointY);
 }
 
 /**
 @fn drawHeightMap
 @brief Draws a pixel representation of the height map of the terrain. Used for
 debug purposes only.
-@param state The current GameState struct.
+@details Every column's point is handed to the renderer in a single call.
+@param snapshot Pointer to the RenderSnapshot being drawn.
 */
-void drawHeightMap (GameState state)
+void drawHeightMap (RenderSnapshot *snapshot)
 {
-	/* Establish the bounds of what to draw. */
-	/*int iLow = max(state.focusPointX, 0);
-	int iHigh = min(state.focusPointX + WINDOW_WIDTH, state.levelWidth);*/
+	SDL_Point *points;
+
+	if (snapshot->heights == NULL ||
+		!( points = reserveDrawPoints(snapshot, WINDOW_WIDTH) ))
+	{
+		return;
+	}
 
 	/* Set draw color to red. */
-	SDL_SetRenderDrawColor(state.renderer, 255, 0, 0, 255);
+	SDL_SetRenderDrawColor(snapshot->renderer, 255, 0, 0, 255);
 
 	for (int i = 0; i < WINDOW_WIDTH; i++)
 	{
-		int X = (i + state.focusPointX) % state.levelWidth;
-		SDL_RenderDrawPoint(state.renderer, 
-							i, 
-							state.focusPointY - state.terrain->heightMap[X]);
+		points[i].x = i;
+		points[i].y = snapshot->focusPointY - snapshot->heights[i];
 	}
 
-	/*for (int i = iLow; i < iHigh; i++)
-	{
-		SDL_RenderDrawPoint(state.renderer, i - state.focusPointX, 
-			 				(int)( state.focusPointY - state.terrain->heightMap[i] ));
-	}*/
+	SDL_RenderDrawPoints(snapshot->renderer, points, WINDOW_WIDTH);
 }
 
 /**
 @fn drawScoreModifiers
 @brief Draws flashing score modifiers below each strip of flat landing terrain.
-@param state The current GameState struct.
+@details The strips in the window were found when the snapshot was taken (see
+copyScoreLabels).
+@param snapshot Pointer to the RenderSnapshot being drawn.
 */
-void drawScoreModifiers (GameState state)
+void drawScoreModifiers (RenderSnapshot *snapshot)
 {
-	int drawX, drawY;
 	char text[8];
-	Flat *current = state.terrain->firstFlat;
 
 	/* Only show the score modifiers if this is in the first half of a second.*/
-	if (state.timeElapsed % (SCORE_MOD_FLASH_TIME * 2) < SCORE_MOD_FLASH_TIME)
+	if (snapshot->timeElapsed % (SCORE_MOD_FLASH_TIME * 2) <
+		SCORE_MOD_FLASH_TIME)
 	{
-		while (current != NULL)
+		for (Uint32 i = 0; i < snapshot->numLabels; i++)
 		{
-			/* For the current Flat, find the midpoint of its length, and draw under 
-		   	   that point "xD", where D is the score modifier of the current Flat.*/
-			if (current->scoreModifier > 0)
-			{
-				drawX = current->X + (current->length / 2) - 8 - state.focusPointX;
-				if (drawX < 0)
-				{
-					drawX += state.levelWidth;
-				}
+			const ScoreLabel *label = &snapshot->labels[i];
 
-				drawY = state.focusPointY - (current->Y - TEXT_Y_DELTA);
-			
-				sprintf(text, "x%1d", current->scoreModifier);
-				stringRGBA(state.renderer, drawX, drawY, text, 255, 255, 255, 255);
-			}
-
-			current = current->next;
+			/* Draw "xD", where D is the score modifier. */
+			sprintf(text, "x%1d", label->scoreModifier);
+			drawText(snapshot, label->X, label->Y, text, 255, 255, 255);
 		}
 	}
 }
@@ -251,87 +635,95 @@ void drawScoreModifiers (GameState state)
 @brief Writes to the window information about the game and lander.
 @details In particular, writes text in white showing the user their score, the
 amount of time they have played, the remaining fuel, the lander's altitude, and
-the lander's horizontal and vertical velocities.
-@param state The current GameState struct.
+the lander's horizontal and vertical velocities. Each line is written through
+its own HUD field (see TextCache.h), so it is only drawn again when its text
+changes.
+@param snapshot Pointer to the RenderSnapshot being drawn.
 */
-void drawStandardInfo (GameState state)
+void drawStandardInfo (RenderSnapshot *snapshot)
 {
 	char text[64];
+	int field = STANDARD_INFO_FIELD;
 		/* Left side: Score, time, and fuel. */
 	int writeX = WINDOW_WIDTH / 20;
 	int writeY = WINDOW_HEIGHT / 20;
 
-	sprintf(text, "SCORE: %04d", (int)(state.score));
-	stringRGBA(state.renderer, writeX, writeY, text, 255, 255, 255, 255);
+	sprintf(text, "SCORE: %04d", (int)(snapshot->score));
+	drawHudField(snapshot, field++, writeX, writeY, text, 255, 255, 255);
 
 	writeY += TEXT_Y_DELTA;
-	sprintf(text, "TIME:  %02d:%02d", getMinutes(state), getSeconds(state));
-	stringRGBA(state.renderer, writeX, writeY, text, 255, 255, 255, 255);
+	sprintf(text, "TIME:  %02d:%02d", snapshot->minutes,
+			snapshot->seconds);
+	drawHudField(snapshot, field++, writeX, writeY, text, 255, 255, 255);
 
 	writeY += TEXT_Y_DELTA;
-	sprintf(text, "FUEL:  %04d", (int)(state.fuel));
-	stringRGBA(state.renderer, writeX, writeY, text, 255, 255, 255, 255);
+	sprintf(text, "FUEL:  %04d", (int)(snapshot->fuel));
+	drawHudField(snapshot, field++, writeX, writeY, text, 255, 255, 255);
 
 		/* Right side: Altitude, horizontal speed, and vertical speed. */
 	writeX = ((WINDOW_WIDTH * 19) / 20) - 188;
 	writeY = WINDOW_HEIGHT / 20;
 
-	sprintf(text, "ALTITUDE:          %04d", getAltitude(state));
-	stringRGBA(state.renderer, writeX, writeY, text, 255, 255, 255, 255);
+	sprintf(text, "ALTITUDE:          %04d", snapshot->altitude);
+	drawHudField(snapshot, field++, writeX, writeY, text, 255, 255, 255);
 
 	writeY += TEXT_Y_DELTA;
-	sprintf(text, "HORIZONTAL SPEED:  %03d", (int)(state.lander->horVelocity * 10));
-	stringRGBA(state.renderer, writeX, writeY, text, 255, 255, 255, 255);
+	sprintf(text, "HORIZONTAL SPEED:  %03d", (int)(FROM_REAL(snapshot->lander.horVelocity) * 10));
+	drawHudField(snapshot, field++, writeX, writeY, text, 255, 255, 255);
 
 	writeY += TEXT_Y_DELTA;
-	sprintf(text, "VERTICAL SPEED:    %03d", (int)(state.lander->vertVelocity * 25));
-	stringRGBA(state.renderer, writeX, writeY, text, 255, 255, 255, 255);
+	sprintf(text, "VERTICAL SPEED:    %03d", (int)(FROM_REAL(snapshot->lander.vertVelocity) * 25));
+	drawHudField(snapshot, field++, writeX, writeY, text, 255, 255, 255);
 }
 
 /**
 @fn drawDebugInfo
 @brief Draws text to the screen (in red) displaying debug info.
-@param state The current GameState struct.
+@param snapshot Pointer to the RenderSnapshot being drawn.
 */
-void drawDebugInfo (GameState state)
+void drawDebugInfo (RenderSnapshot *snapshot)
 {
 	char text[64];
+	int field = DEBUG_INFO_FIELD;
 
 	/*** Draw text in the top-middle of the screen. ***/
 	int writeX = (WINDOW_WIDTH / 2) - 128;
 	int writeY = WINDOW_HEIGHT / 20;
 
 		/* Draw X and realX. */
-	sprintf(text, "X: %04d  realX: %.2f", state.lander->X, state.lander->realX);
-	stringRGBA(state.renderer, writeX, writeY, text, 255, 0, 0, 255);
+	sprintf(text, "X: %04d  realX: %.2f", snapshot->lander.X,
+			FROM_REAL(snapshot->lander.realX));
+	drawHudField(snapshot, field++, writeX, writeY, text, 255, 0, 0);
 
 		/* Draw Y and realY. */
 	writeY += TEXT_Y_DELTA;
-	sprintf(text, "Y: %04d  realY: %.2f", state.lander->Y, state.lander->realY);
-	stringRGBA(state.renderer, writeX, writeY, text, 255, 0, 0, 255);
+	sprintf(text, "Y: %04d  realY: %.2f", snapshot->lander.Y,
+			FROM_REAL(snapshot->lander.realY));
+	drawHudField(snapshot, field++, writeX, writeY, text, 255, 0, 0);
 
 		/* Draw the focus point coordinates. */
 	writeY += TEXT_Y_DELTA;
-	sprintf(text, "FPoint X: %4d  Real FPoint X: %.2f", state.focusPointX, 
-		    state.realFocusPointX);
-	stringRGBA(state.renderer, writeX, writeY, text, 255, 0, 0, 255);
+	sprintf(text, "FPoint X: %4d  Real FPoint X: %.2f", snapshot->focusPointX, 
+		    snapshot->realFocusPointX);
+	drawHudField(snapshot, field++, writeX, writeY, text, 255, 0, 0);
 
 	writeY += TEXT_Y_DELTA;
-	sprintf(text, "FPoint Y: %4d  Real FPoint Y: %.2f", state.focusPointY, 
-		    state.realFocusPointY);
-	stringRGBA(state.renderer, writeX, writeY, text, 255, 0, 0, 255);
+	sprintf(text, "FPoint Y: %4d  Real FPoint Y: %.2f", snapshot->focusPointY, 
+		    snapshot->realFocusPointY);
+	drawHudField(snapshot, field++, writeX, writeY, text, 255, 0, 0);
 
 	/* Draw the X coordinate of the focus window's right edge. */
 	writeY += TEXT_Y_DELTA;
 	sprintf(text, "Right edge of focus: %4d", 
-		    (state.focusPointX + WINDOW_WIDTH) % state.levelWidth );
-	stringRGBA(state.renderer, writeX, writeY, text, 255, 0, 0, 255);
+		    (snapshot->focusPointX + WINDOW_WIDTH) % snapshot->levelWidth );
+	drawHudField(snapshot, field++, writeX, writeY, text, 255, 0, 0);
 
 		/* Draw the real velocities. */
 	writeY += TEXT_Y_DELTA;
 	sprintf(text, "horVelocity: %.2f  vertVelocity: %.2f", 
-		    state.lander->horVelocity, state.lander->vertVelocity);
-	stringRGBA(state.renderer, writeX, writeY, text, 255, 0, 0, 255);
+		    FROM_REAL(snapshot->lander.horVelocity),
+		    FROM_REAL(snapshot->lander.vertVelocity));
+	drawHudField(snapshot, field++, writeX, writeY, text, 255, 0, 0);
 }
 
 /**
@@ -359,6 +751,12 @@ bool handleEvents (GameState *state)
 			//case SDL_KEYUP:
 				handleKey(state, &event);
 				break;
+			/*** Check if the renderer lost the contents of its textures. ***/
+			case SDL_RENDER_TARGETS_RESET:
+			case SDL_RENDER_DEVICE_RESET:
+				clearTerrainCache(state->terrainCache);
+				clearTextCache(state->textCache);
+				break;
 			default:
 				break;
 		}
@@ -375,59 +773,49 @@ bool handleEvents (GameState *state)
 */
 void handleKey (GameState *state, SDL_Event *event)
 {
+	int direction;
+
 	switch(event->key.keysym.sym)
 	{
 		/*** If the user pressed the UP arrow, increase the lander's vertical
-		     velocity and consume some fuel. ***/
+		     velocity. ***/
 		case SDLK_UP:
-			if (state->fuel >= THRUST_FUEL_COST)
-			{	
-				state->lander->vertVelocity += UP_THRUST_POWER;
-				state->fuel -= THRUST_FUEL_COST;
-
-				/* Also play the thrust sound. */
-				if ( Mix_PlayChannel(-1, state->thrust, 0) == -1 )
-				{
-					/*fprintf(stderr, "Problem playing thrust sound.\n");*/
-				}
-			}
+			direction = THRUST_UP;
 			break;
 
 		/*** If the user pressed the RIGHT arrow, decrease the lander's horizontal
-		     velocity and consume some fuel. ***/
+		     velocity. ***/
 		case SDLK_RIGHT:
-			if (state->fuel >= THRUST_FUEL_COST)
-			{	
-				state->lander->horVelocity -= RIGHT_THRUST_POWER;
-				state->fuel -= THRUST_FUEL_COST;
-
-				/* Also play the thrust sound. */
-				if ( Mix_PlayChannel(-1, state->thrust, 0) == -1 )
-				{
-					/*fprintf(stderr, "Problem playing thrust sound.\n");*/
-				}
-			}
+			direction = THRUST_RIGHT;
 			break;
 
 		/*** If the user pressed the LEFT arrow, increase the lander's horizontal
-		     velocity and consume some fuel. ***/
+		     velocity. ***/
 		case SDLK_LEFT:
-			if (state->fuel >= THRUST_FUEL_COST)
-			{	
-				state->lander->horVelocity += LEFT_THRUST_POWER;
-				state->fuel -= THRUST_FUEL_COST;
-
-				/* Also play the thrust sound. */
-				if ( Mix_PlayChannel(-1, state->thrust, 0) == -1 )
-				{
-					/*fprintf(stderr, "Problem playing thrust sound.\n");*/
-				}
-			}
+			direction = THRUST_LEFT;
 			break;
 
 		/*** For any other keystroke, do nothing. ***/
 		default:
-			break;
+			return;
+	}
+
+	/*** If the game is being recorded, record the key before the tick it 
+	     applies to. ***/
+	if (state->replay != NULL)
+	{
+		recordReplayInput(state->replay, state->ticks, direction);
+	}
+
+	/*** Fire the thruster (consuming some fuel) and, if it fired, also play 
+	     the thrust sound. ***/
+	if (applyThrust(state, direction))
+	{
+		if ( Mix_PlayChannel(-1, loadSound(state, &state->thrust, THRUST_SOUND),
+							 0) == -1 )
+		{
+			/*fprintf(stderr, "Problem playing thrust sound.\n");*/
+		}
 	}
 }
 
@@ -445,46 +833,8 @@ void applyTick (GameState *state)
 		state->timeStart = SDL_GetTicks();
 	}
 
-	/*** Decrease the lander's vertical velocity by GRAVITY constant. ***/
-	state->lander->vertVelocity -= GRAVITY;
-
-	/*** Change the lander's x and y positions by the corresponding 
-	     velocities. ***/
-	state->lander->realX += state->lander->horVelocity;
-		/* If the lander's position surpasses any of the boundaries, 
-		   wrap it around that boundary. */
-	while ( state->lander->realX < 0.0 )
-	{
-		state->lander->realX += (float)(state->levelWidth);
-	}
-	while ( state->lander->realX >= (float)(state->levelWidth) )
-	{
-		state->lander->realX -= (float)(state->levelWidth);
-	}
-
-	state->lander->realY += state->lander->vertVelocity;
-
-	state->lander->X = (int)(state->lander->realX);
-	state->lander->Y = (int)(state->lander->realY);
-
-		/* Prevent the lander from going beyond the bounds of the level
-		   (this causes out-of-bounds errors). */
-	/*if (state->lander->realX < 0)
-	{
-		state->lander->realX = 0;
-		state->lander->X = 0;
-	}
-	else if (state->lander->realX >= state->levelWidth)
-	{
-		state->lander->realX = state->levelWidth - state->lander->length;
-		state->lander->X = state->levelWidth - state->lander->length;
-	}
-	if (state->lander->realY < 1)
-	{
-		state->lander->realY = 10;
-		state->lander->Y = 10;
-	}*/
-
+	/*** Apply gravity and move the lander by its velocities. ***/
+	simulateTick(state);
 
 	/*** Scroll the focus as necessary. ***/
 	scrollFocusPoint(state);
@@ -513,10 +863,11 @@ void scrollFocusPoint (GameState *state)
 		   Wrap the focus point around the width of the level if necessary. */
 		if (state->lander->horVelocity > 0)
 		{
-			state->realFocusPointX += state->lander->horVelocity;
-			while ( state->realFocusPointX >= (float)(state->levelWidth) )
+			state->realFocusPointX += FROM_REAL(state->lander->horVelocity)
+									  * TICK_SCALE;
+			while ( state->realFocusPointX >= (double)(state->levelWidth) )
 			{
-				state->realFocusPointX -= (float)(state->levelWidth);
+				state->realFocusPointX -= (double)(state->levelWidth);
 			}
 			state->focusPointX = (int)(state->realFocusPointX);
 
@@ -534,10 +885,11 @@ void scrollFocusPoint (GameState *state)
 		/* Shift the focus point left by the lander's x velocity. */
 		if ( state->lander->horVelocity < 0 )
 		{
-			state->realFocusPointX += state->lander->horVelocity;
+			state->realFocusPointX += FROM_REAL(state->lander->horVelocity)
+									  * TICK_SCALE;
 			while ( state->realFocusPointX < 0.0 )
 			{
-				state->realFocusPointX += (float)(state->levelWidth);
+				state->realFocusPointX += (double)(state->levelWidth);
 			}
 			state->focusPointX = (int)(state->realFocusPointX);
 
@@ -559,7 +911,8 @@ void scrollFocusPoint (GameState *state)
 		/* Shift the focus point up by the lander's y velocity. */
 		if (state->lander->vertVelocity > 0)
 		{
-			state->realFocusPointY += state->lander->vertVelocity;
+			state->realFocusPointY += FROM_REAL(state->lander->vertVelocity)
+									  * TICK_SCALE;
 			state->focusPointY = (int)(state->realFocusPointY);
 			/* The lander may scroll as far up as it wants,
 			   no bounding check necessary. */
@@ -572,7 +925,8 @@ void scrollFocusPoint (GameState *state)
 		/* Shift the focus point down by the lander's y velocity. */
 		if (state->lander->vertVelocity < 0)
 		{
-			state->realFocusPointY += state->lander->vertVelocity;
+			state->realFocusPointY += FROM_REAL(state->lander->vertVelocity)
+									  * TICK_SCALE;
 			state->focusPointY = (int)(state->realFocusPointY);
 
 			/* DO NOT scroll past the bottom of the level. */
@@ -594,151 +948,9 @@ occurred or 2 if a crash occurred. 0 if no collision detected.
 */
 bool collisionDetected (GameState state, int *landingType)
 {
-	/* A collision happens when one part of the bottom of the lander is at or 
-	   below terrain level. Make sure that the entirety of the lander's bottom
-	   has hit FLAT land. If not, the lander has crashed. Then, check the total 
-	   velocity of the lander. If it's at or below the LANDING_THRESHOLD, 
-	   a successful landing took place. Otherwise, a crash occurred. */
-
-	int leftX, middleX, rightX;
-
-	leftX = (int)(state.lander->X);
-	middleX = (leftX + ( (int)(state.lander->length) / 2 )) % state.levelWidth;
-	rightX = ( leftX + (int)(state.lander->length) ) % state.levelWidth;
-
-
-	/*** Check if the left end of the lander's bottom is at or below the
-	     terrain at its x position. ***/
-	if (leftX >= 0 && leftX < state.levelWidth)
-	{
-		if (state.lander->Y <= state.terrain->heightMap[leftX])
-		{
-			/* Check for a proper landing. The speed of the lander must be at or
-			   under the LANDING_THRESHOLD and the terrain must be flat. */
-			if ( isLandingSpeed(state) && isFlatLand(state, leftX, middleX, rightX) )
-			{
-				*landingType = 1;
-
-				/* Also play the landing sound. */
-				if ( Mix_PlayChannel(-1, state.ding, 0) == -1 )
-				{
-					/*fprintf(stderr, "Problem playing ding sound.\n");*/
-				}
-			}
-			/* Otherwise, a crash occurred. */
-			else
-			{
-				*landingType = 2;
-
-				/* Also play the boom sound. */
-				if ( Mix_PlayChannel(-1, state.boom, 0) == -1 )
-				{
-					/*fprintf(stderr, "Problem playing boom sound.\n");*/
-				}
-			}
-
-			return true;
-		}
-	}
-
-	/*** Check if the middle of the lander's bottom is at or below the
-	     terrain at its x position. ***/
-	if (middleX >= 0 && middleX < state.levelWidth)
-	{
-		if (state.lander->Y <= state.terrain->heightMap[middleX])
-		{
-			/* Check for a proper landing. The speed of the lander must be at or
-			   under the LANDING_THRESHOLD and the terrain must be flat. */
-			if ( isLandingSpeed(state) && isFlatLand(state, leftX, middleX, rightX) )
-			{
-				*landingType = 1;
-
-				/* Also play the landing sound. */
-				if ( Mix_PlayChannel(-1, state.ding, 0) == -1 )
-				{
-					fprintf(stderr, "Problem playing ding sound.\n");
-				}
-			}
-			/* Otherwise, a crash occurred. */
-			else
-			{
-				*landingType = 2;
-
-				/* Also play the boom sound. */
-				if ( Mix_PlayChannel(-1, state.boom, 0) == -1 )
-				{
-					fprintf(stderr, "Problem playing boom sound.\n");
-				}
-			}
-
-			return true;
-		}
-	}
-
-	/*** Check if the right end of the lander's bottom is at or below the
-	     terrain at its x position. ***/
-	if (rightX >= 0 && rightX < state.levelWidth)
-	{
-		if (state.lander->Y <= state.terrain->heightMap[rightX])
-		{
-			/* Check for a proper landing. The speed of the lander must be at or
-			   under the LANDING_THRESHOLD and the terrain must be flat. */
-			if ( isLandingSpeed(state) && isFlatLand(state, leftX, middleX, rightX) )
-			{
-				*landingType = 1;
-			}
-			/* Otherwise, a crash occurred. */
-			else
-			{
-				*landingType = 2;
-			}
-
-			return true;
-		}
-	}
-
-	return false;
-}
-
-/**
-@fn isLandingSpeed
-@brief Reports whether or not the lander is going slow enough for a proper 
-landing.
-@param state The current GameState struct.
-@return True if the lander's speed is at or under LANDING_THRESHOLD.
-False otherwise.
-*/
-bool isLandingSpeed (GameState state)
-{
-	if ( (int)(getVelocity(state)) <= LANDING_THRESHOLD )
-	{
-		return true;
-	}
+	*landingType = detectCollision(state);
 
-	return false;
-}
-
-/**
-@fn isFlatLand
-@brief Approximates if the terrain between x positions x1, x2, and x3 is flat.
-@details This function checks if the height of the terrain at x positions
-x1, x2, and x3 is the same. If so, returns true.
-@param state The current GameState struct.
-@param x1 An x coordinate to measure terrain at.
-@param x2 An x coordinate to measure terrain at.
-@param x3 An x coordinate to measure terrain at.
-@return True if the terrain is at the same height at each of the given 
-positions. False otherwise.
-*/
-bool isFlatLand (GameState state, int x1, int x2, int x3)
-{
-	if (state.terrain->heightMap[x1] == state.terrain->heightMap[x2] &&
-		state.terrain->heightMap[x1] == state.terrain->heightMap[x3])
-	{
-		return true;
-	}
-
-	return false;
+	return (*landingType != LANDING_NONE);
 }
 
 /**
@@ -754,49 +966,38 @@ waits for the user to respond with a mouse click or keystroke before releasing.
 */
 void applyCollision(GameState *state, int landingType)
 {
-	/*** If landingType is 1 (good landing), increment the player's score. 
-	     Then, display the type of landing for the user and how much score was
-	     gained. Wait for the user to respond, and return. ***/
-	if (landingType == 1)
+	/*** If landingType is neither 1 nor 2, then an error has occurred. ***/
+	if (landingType != LANDING_PROPER && landingType != LANDING_CRASH)
 	{
-		Uint16 modifier = 0;
-
-		/* Find the Flat representing the region just landed on. */
-		Flat* currentFlat = state->terrain->firstFlat;
-
-		while (currentFlat != NULL && 
-			   currentFlat->X + currentFlat->length < state->lander->X)
-		{
-			currentFlat = currentFlat->next;
-		}
-
-		if (currentFlat != NULL)
-		{
-			modifier = currentFlat->scoreModifier;
-		}
-
-		/* Increment the player's score with SCORE_FOR_LANDING times the
-		   modifier. */
-		state->score += (SCORE_FOR_LANDING * modifier);
-
-		showCollisionMessage(state, SCORE_FOR_LANDING * modifier);
-
 		return;
 	}
 
-	/*** If landingType is 2 (crash), decrement the lander's fuel.
-	     Then, display the type of landing for the user and how much fuel was
-	     gained. Wait for the user to respond, and return. ***/
-	if (landingType == 2)
-	{
-		state->fuel -= CRASH_FUEL_COST;
+	/*** Update the score or fuel, then display the type of landing for the 
+	     user and how much score was gained or fuel was lost. Wait for the user
+	     to respond, and return. ***/
+	showCollisionMessage(state, resolveCollision(state, landingType));
+}
 
-		showCollisionMessage(state, (CRASH_FUEL_COST * -1));
+/**
+@fn playCollisionSound
+@brief Plays the landing or crash sound. Used as the GameState's onCollision
+callback.
+@param state Pointer to the current GameState struct.
+@param landingType The type of collision that has occurred.
+@param score The score gained (if positive or 0) OR the fuel lost (if negative).
+@param userData Unused.
+*/
+void playCollisionSound (GameState *state, int landingType, int score, 
+						 void *userData)
+{
+	Mix_Chunk *sound = (landingType == LANDING_PROPER) ?
+					   loadSound(state, &state->ding, LANDING_SOUND) :
+					   loadSound(state, &state->boom, CRASH_SOUND);
 
-		return;
+	if ( Mix_PlayChannel(-1, sound, 0) == -1 )
+	{
+		/*fprintf(stderr, "Problem playing collision sound.\n");*/
 	}
-
-	/*** If landingType is neither 1 nor 2, then an error has occurred. ***/
 }
 
 /**
@@ -814,6 +1015,14 @@ void showCollisionMessage (GameState *state, int score)
 	char text[64];
 	int writeX, writeY;
 
+	/*** The message is written over the last frame drawn, so it only needs
+	     the renderer and text cache. A snapshot isn't taken, so the columns
+	     the terrain has changed in are still there for the next frame. ***/
+	RenderSnapshot snapshot = {0};
+
+	snapshot.renderer = state->renderer;
+	snapshot.textCache = state->textCache;
+
 	/*** If it's game over, display GAME OVER above the message and display
 		 the final score on the line below that. ***/
 	if (gameOver(*state))
@@ -822,12 +1031,12 @@ void showCollisionMessage (GameState *state, int score)
 		writeY = (WINDOW_HEIGHT / 2) - (2 * TEXT_Y_DELTA);
 
 		sprintf(text, "GAME  OVER");
-		stringRGBA(state->renderer, writeX, writeY, text, 255, 255, 255, 255);
+		drawText(&snapshot, writeX, writeY, text, 255, 255, 255);
 
 		writeX = (WINDOW_WIDTH / 2) - (8 * 8);
 		writeY += TEXT_Y_DELTA;
 		sprintf(text, "Final Score: %04d", state->score);
-		stringRGBA(state->renderer, writeX, writeY, text, 255, 255, 255, 255);
+		drawText(&snapshot, writeX, writeY, text, 255, 255, 255);
 	}
 
 	/*** If score >= 0, display a successful landing message. ***/
@@ -837,12 +1046,12 @@ void showCollisionMessage (GameState *state, int score)
 		writeX = (WINDOW_WIDTH / 2) - (8 * 12);
 		writeY = (WINDOW_HEIGHT / 2);
 		sprintf(text, "You landed successfully!");
-		stringRGBA(state->renderer, writeX, writeY, text, 255, 255, 255, 255);
+		drawText(&snapshot, writeX, writeY, text, 255, 255, 255);
 
 		writeX = (WINDOW_WIDTH / 2) - (8 * 8);
 		writeY += TEXT_Y_DELTA;
 		sprintf(text, "Score gained: %03d", score);
-		stringRGBA(state->renderer, writeX, writeY, text, 255, 255, 255, 255);
+		drawText(&snapshot, writeX, writeY, text, 255, 255, 255);
 	}
 
 	/*** Otherwise, display a crash message. ***/
@@ -852,12 +1061,12 @@ void showCollisionMessage (GameState *state, int score)
 		writeX = (WINDOW_WIDTH / 2) - (8 * 6);
 		writeY = (WINDOW_HEIGHT / 2);
 		sprintf(text, "You crashed!");
-		stringRGBA(state->renderer, writeX, writeY, text, 255, 255, 255, 255);
+		drawText(&snapshot, writeX, writeY, text, 255, 255, 255);
 
 		writeX = (WINDOW_WIDTH / 2) - (8 * 7);
 		writeY += TEXT_Y_DELTA;
 		sprintf(text, "Fuel lost: %03d", (score * -1));
-		stringRGBA(state->renderer, writeX, writeY, text, 255, 255, 255, 255);
+		drawText(&snapshot, writeX, writeY, text, 255, 255, 255);
 	}
 
 	SDL_RenderPresent(state->renderer);
@@ -940,194 +1149,3 @@ void waitForResponse (GameState *state)
 		}
 	}
 }
-
-/**
-@fn gameOver
-@brief Reports whether or not the game is over now.
-@param state The GameState struct representing the current state of the game.
-@return True if the land has no more fuel. False otherwise.
-*/
-bool gameOver (GameState state)
-{
-	/*** Return true if there is no more fuel. ***/
-		/* Since fuel is an unsigned int, it will overflow to large positive
-		   value when it falls below 0, so check for that. */
-	if (state.fuel <= 0 || state.fuel > FUEL_START)
-	{
-		return true;
-	}
-
-	/*** Otherwise, return false. ***/
-	return false;
-}
-
-/**
-@fn hardReset
-@brief Refreshes the game as if it were just relaunched.
-@details Ends the current game, displaying the user's score and time. Then,
-waits for the user to respond. Once the user responds, resets the GameState as
-if the game were just launched.
-@param state Pointer to the current GameState struct.
-*/
-void hardReset (GameState *state)
-{
-	/*** Draw a message showing the user's score and time. ***/
-
-	/*** Reset the game state to initial state. ***/
-		/* Reset lander's position. */
-	state->lander->realX = LANDER_X_START;
-	state->lander->realY = LANDER_Y_START;
-	state->lander->X = (int)(state->lander->realX);
-	state->lander->Y = (int)(state->lander->realY);
-	state->lander->length = LANDER_LENGTH;
-	state->lander->height = LANDER_HEIGHT;
-
-		/* Reset the lander's horizontal and vertical velocities. */
-	state->lander->horVelocity = LANDER_VX_START;
-	state->lander->vertVelocity = LANDER_VY_START;
-
-		/* Reset the focus point. */
-	state->realFocusPointX = 0;
-	state->realFocusPointY = WINDOW_HEIGHT;
-	state->focusPointX = (int)(state->realFocusPointX);
-	state->focusPointY = (int)(state->realFocusPointY);
-
-		/* Reset score, time, and fuel. */
-	state->score = 0;
-	state->timeStart = -1;
-	state->timeElapsed = 0;
-	state->fuel = FUEL_START;
-
-	/*** Wait for a user event, then release. ***/
-}
-
-/**
-@fn softReset
-@brief Respawns the lander and continues the game.
-@details Moves the lander back to its original spawn position, then waits for
-the user to respond. Once the user responds, releases the game and allows the
-user to continue playing.
-@param state Pointer to the current GameState struct.
-*/
-void softReset (GameState *state)
-{
-	/*** Reset the lander's position and velocities. ***/
-	state->lander->realX = LANDER_X_START;
-	state->lander->realY = LANDER_Y_START;
-	state->lander->X = (int)(state->lander->realX);
-	state->lander->Y = (int)(state->lander->realY);
-	state->lander->length = LANDER_LENGTH;
-	state->lander->height = LANDER_HEIGHT;
-	state->lander->horVelocity = LANDER_VX_START;
-	state->lander->vertVelocity = LANDER_VY_START;
-
-		/* Reset the focus point. */
-	state->realFocusPointX = 0;
-	state->realFocusPointY = WINDOW_HEIGHT;
-	state->focusPointX = (int)(state->realFocusPointX);
-	state->focusPointY = (int)(state->realFocusPointY);
-
-	/*** Wait for a user event, then release. ***/
-}
-
-/**
-@fn getVelocity 
-@brief Calculates the magnitude of the lander's velocity.
-@param state The GameState struct representing the current state of the game.
-@return The magnitude of the lander's velocity as a positive double.
-*/
-double getVelocity (GameState state)
-{
-	return sqrt( (double)
-				((state.lander->vertVelocity * state.lander->vertVelocity)
-			    + (state.lander->horVelocity * state.lander->horVelocity)));
-}
-
-/**
-@fn getMinutes
-@brief Returns the number of elapsed minutes in game time (mod 100).
-@param state The current GameState struct.
-@return The number of minutes elapsed while playing.
-*/
-int getMinutes (GameState state)
-{
-	/* Get the elapsed time (in ms) from the game state. */
-	int t = state.timeElapsed;
-
-	/* Convert to minutes. */
-	t /= 60000;
-
-	/* Mod by 100 (only two decimal places returned). */
-	t = t % 100;
-
-	return t;
-}
-
-/**
-@fn getSeconds 
-@brief Returns the number of elapsed seconds in game time (mod 60).
-@param state The current GameState struct.
-@return The number of seconds elapsed while playing.
-*/
-int getSeconds (GameState state)
-{
-	/* Get the elapsed time (in ms) from the game state. */
-	int t = state.timeElapsed;
-
-	/* Convert to seconds. */
-	t /= 1000;
-
-	/* Mod by 60. */
-	t = t % 60;
-
-	return t;
-}
-
-/**
-@fn getAltitude 
-@brief Returns the distance between the terrain and the lander.
-@param state The current GameState struct.
-@return The distance (in pixels) between the terrain and lander.
-*/
-
-int getAltitude (GameState state)
-{
-	int middleX = (int)(state.lander->X + (state.lander->length / 2)) 
-				  % state.levelWidth;
-
-	return state.lander->Y - state.terrain->heightMap[middleX];
-}
-
-/**
-@fn min
-@brief Returns the smaller of two ints.
-@param first One of two ints to compare.
-@param second One of two ints to compare.
-@return The smaller of the two ints.
-*/
-int min (int first, int second)
-{
-	if (first <= second)
-	{
-		return first;
-	}
-
-	return second;
-}
-
-/**
-@fn max
-@brief Returns the larger of two ints.
-@param first One of two ints to compare.
-@param second One of two ints to compare.
-@return The larger of the two ints.
-*/
-int max (int first, int second)
-{
-	if (first >= second)
-	{
-		return first;
-	}
-
-	return second;
-}
@@ -13,64 +13,27 @@ lunar lander game.
 #include <stdbool.h>
 
 #include "GameObjects.h"
+#include "Simulation.h"
 
 /**
-@def GRAVITY
-@brief A constant for the downward acceleration per tick of the lander.
-*/
-#define GRAVITY 0.005
-
-/**
-@def LANDING_THRESHOLD
-@brief A constant that dictates the max velocity for a landing to take place.
-*/
-#define LANDING_THRESHOLD 1
-
-/**
-@def UP_THRUST_POWER
-@brief A constant that dictates how much the vertical velocity is increased by
-when the UP arrow key is pressed.
-*/
-#define UP_THRUST_POWER 0.04
-
-/**
-@def LEFT_THRUST_POWER
-@brief A constant that dictates how much the horizonal velocity is increased by
-when the LEFT arrow key is pressed.
-*/
-#define LEFT_THRUST_POWER 0.1
-
-/**
-@def RIGHT_THRUST_POWER
-@brief A constant that dictates how much the horizontal velocity is decreased by
-when the RIGHT arrow key is pressed.
-*/
-#define RIGHT_THRUST_POWER 0.1
-
-/**
-@def THRUST_FUEL_COST
-@brief A constant that dictates how much fuel is lost by thrusting for one tick.
+@def TEXT_Y_DELTA
+@brief The default distance (in pixels) between rows of text draw in the game.
 */
-#define THRUST_FUEL_COST 1
+#define TEXT_Y_DELTA 12
 
 /**
-@def SCORE_FOR_LANDING
-@brief The default amount of score to gain from a proper landing,
-later multiplied by the score multiplier for that landing spot.
+@def STANDARD_INFO_FIELD
+@brief The first of the HUD fields (see TextCache.h) the standard info is
+written through, one per line.
 */
-#define SCORE_FOR_LANDING 100
+#define STANDARD_INFO_FIELD 0
 
 /**
-@def CRASH_FUEL_COST
-@brief The default amount of fuel lost when the lander crashes.
+@def DEBUG_INFO_FIELD
+@brief The first of the HUD fields the debug info is written through, one per
+line.
 */
-#define CRASH_FUEL_COST 200
-
-/**
-@def TEXT_Y_DELTA
-@brief The default distance (in pixels) between rows of text draw in the game.
-*/
-#define TEXT_Y_DELTA 12
+#define DEBUG_INFO_FIELD 6
 
 /**
 @def HORIZONTAL_SCROLL_THRESHOLD
@@ -101,55 +64,129 @@ for (and not flashed for).
 #define SCORE_MOD_FLASH_TIME 500
 
 
+/**
+@fn initializeRenderSnapshot
+@brief Empties a RenderSnapshot, so it can be taken by takeRenderSnapshot.
+@param snapshot Pointer to the RenderSnapshot.
+*/
+void initializeRenderSnapshot (RenderSnapshot *snapshot);
+
+/**
+@fn freeRenderSnapshot
+@brief Frees the arrays a RenderSnapshot's copies are kept in, leaving it
+empty.
+@param snapshot Pointer to the RenderSnapshot.
+*/
+void freeRenderSnapshot (RenderSnapshot *snapshot);
+
+/**
+@fn takeRenderSnapshot
+@brief Copies what the next frame draws out of the game state.
+@param state Pointer to the current GameState struct.
+@param snapshot Pointer to the RenderSnapshot to take, which has been
+initialized by initializeRenderSnapshot.
+*/
+void takeRenderSnapshot (GameState *state, RenderSnapshot *snapshot);
+
 /**
 @fn draw
 @brief Draws the game to the window.
-@param state The GameState representing the state of the game at this instant.
+@param snapshot Pointer to the RenderSnapshot of the game at this instant.
 */
-void draw (GameState state);
+void draw (RenderSnapshot *snapshot);
+
+/**
+@fn drawScene
+@brief Draws the game onto the renderer's target without presenting it, so the
+same scene can be drawn into a window or into memory.
+@param snapshot Pointer to the RenderSnapshot of the game at this instant.
+*/
+void drawScene (RenderSnapshot *snapshot);
 
 /**
 @fn drawLander
 @brief Draws the lander to the window.
-@param state The current GameState struct.
+@param snapshot Pointer to the RenderSnapshot being drawn.
+*/
+void drawLander (RenderSnapshot *snapshot);
+
+/**
+@fn findColumnVertices
+@brief Finds the run of Vertexes whose lines cross a run of columns.
+@param vertices The Vertex array to search.
+@param numVertices The number of Vertexes in the array.
+@param first The first column of the run.
+@param last The last column of the run.
+@param start Buffer for the index of the first Vertex of the lines.
+@param end Buffer for the index of the last Vertex of the lines.
+@return True if any line crosses the columns, false if they are past all of the
+terrain.
 */
-void drawLander (GameState state);
+bool findColumnVertices (const Vertex *vertices, Uint32 numVertices, int first,
+						 int last, Uint32 *start, Uint32 *end);
+
+/**
+@fn findVertexRun
+@brief Finds the run of Vertexes copied into a snapshot that covers a run of
+columns.
+@param snapshot Pointer to the RenderSnapshot being drawn.
+@param first The first column of the run.
+@param last The last column of the run.
+@return Pointer to the VertexRun, or NULL if neither of the snapshot's runs
+covers the columns.
+*/
+const VertexRun *findVertexRun (const RenderSnapshot *snapshot, int first,
+								int last);
+
+/**
+@fn drawTerrainColumns
+@brief Draws the lines of the terrain that cross a run of columns, in a single
+call to the renderer.
+@param snapshot Pointer to the RenderSnapshot being drawn. One of its runs of
+Vertexes must cover the columns, or nothing is drawn.
+@param first The first column of the run.
+@param last The last column of the run.
+@param originX The column drawn at the left edge of the renderer's target.
+@param originY The height drawn at the top edge of the renderer's target.
+*/
+void drawTerrainColumns (RenderSnapshot *snapshot, int first, int last,
+						 int originX, int originY);
 
 /**
 @fn drawTerrain
-@brief Draws the terrain of the level using the list of vertices.
-@param state The current GameState struct.
+@brief Draws the terrain of the level using the array of vertices.
+@param snapshot Pointer to the RenderSnapshot being drawn.
 */
-void drawTerrain (GameState state);
+void drawTerrain (RenderSnapshot *snapshot);
 
 /**
 @fn drawHeightMap
 @brief Draws a pixel representation of the height map of the terrain. Used for
 debug purposes only.
-@param state The current GameState struct.
+@param snapshot Pointer to the RenderSnapshot being drawn.
 */
-void drawHeightMap (GameState state);
+void drawHeightMap (RenderSnapshot *snapshot);
 
 /**
 @fn drawScoreModifiers
 @brief Draws flashing score modifiers below each strip of flat landing terrain.
-@param state The current GameState struct.
+@param snapshot Pointer to the RenderSnapshot being drawn.
 */
-void drawScoreModifiers (GameState state);
+void drawScoreModifiers (RenderSnapshot *snapshot);
 
 /**
 @fn drawStandardInfo
 @brief Writes to the window information about the game and lander.
-@param state The current GameState struct.
+@param snapshot Pointer to the RenderSnapshot being drawn.
 */
-void drawStandardInfo (GameState state);
+void drawStandardInfo (RenderSnapshot *snapshot);
 
 /**
 @fn drawDebugInfo
 @brief Draws text to the screen (in red) displaying debug info.
-@param state The current GameState struct.
+@param snapshot Pointer to the RenderSnapshot being drawn.
 */
-void drawDebugInfo (GameState state);
+void drawDebugInfo (RenderSnapshot *snapshot);
 
 /**
 @fn handleEvents
@@ -192,28 +229,6 @@ occurred or 2 if a crash occurred. 0 if no collision detected.
 */
 bool collisionDetected (GameState state, int *landingType);
 
-/**
-@fn isLandingSpeed
-@brief Reports whether or not the lander is going slow enough for a proper 
-landing.
-@param state The current GameState struct.
-@return True if the lander's speed is at or under LANDING_THRESHOLD.
-False otherwise.
-*/
-bool isLandingSpeed (GameState state);
-
-/**
-@fn isFlatLand
-@brief Approximates if the terrain between x positions x1, x2, and x3 is flat.
-@param state The current GameState struct.
-@param x1 An x coordinate to measure terrain at.
-@param x2 An x coordinate to measure terrain at.
-@param x3 An x coordinate to measure terrain at.
-@return True if the terrain is at the same height at each of the given 
-positions. False otherwise.
-*/
-bool isFlatLand (GameState state, int x1, int x2, int x3);
-
 /**
 @fn applyCollision
 @brief Alters the game state following a collision given the type of collision.
@@ -222,6 +237,17 @@ bool isFlatLand (GameState state, int x1, int x2, int x3);
 */
 void applyCollision(GameState *state, int landingType);
 
+/**
+@fn playCollisionSound
+@brief Plays the landing or crash sound. Used as the GameState's onCollision
+callback.
+@param state Pointer to the current GameState struct.
+@param landingType The type of collision that has occurred.
+@param score The score gained (if positive or 0) OR the fuel lost (if negative).
+@param userData Unused.
+*/
+void playCollisionSound (GameState *state, int landingType, int score, 
+						 void *userData);
 
 /**
 @fn showCollisionMessage
@@ -239,77 +265,4 @@ that is NOT one of the arrow keys.
 */
 void waitForResponse (GameState *state);
 
-/**
-@fn gameOver
-@brief Reports whether or not the game is over now.
-@param state The GameState struct representing the current state of the game.
-@return True if the land has no more fuel. False otherwise.
-*/
-bool gameOver (GameState state);
-
-/**
-@fn hardReset
-@brief Refreshes the game as if it were just relaunched.
-@param state Pointer to the current GameState struct.
-*/
-void hardReset (GameState *state);
-
-/**
-@fn softReset
-@brief Respawns the lander and continues the game.
-@param state Pointer to the current GameState struct.
-*/
-void softReset (GameState *state);
-
-/**
-@fn getMinutes
-@brief Returns the number of elapsed minutes in game time (mod 100).
-@param state The current GameState struct.
-@return The number of minutes elapsed while playing.
-*/
-int getMinutes (GameState state);
-
-/**
-@fn getSeconds 
-@brief Returns the number of elapsed seconds in game time (mod 60).
-@param state The current GameState struct.
-@return The number of seconds elapsed while playing.
-*/
-int getSeconds (GameState state);
-
-/**
-@fn getAltitude 
-@brief Returns the distance between the terrain and the lander.
-@param state The current GameState struct.
-@return The distance (in pixels) between the terrain and lander.
-*/
-
-int getAltitude (GameState state);
-
-/**
-@fn getVelocity 
-@brief Calculates the magnitude of the lander's velocity.
-@param state The GameState struct representing the current state of the game.
-@return The magnitude of the lander's velocity as a positive double.
-*/
-double getVelocity (GameState state);
-
-/**
-@fn min
-@brief Returns the smaller of two ints.
-@param first One of two ints to compare.
-@param second One of two ints to compare.
-@return The smaller of the two ints.
-*/
-int min (int first, int second);
-
-/**
-@fn max
-@brief Returns the larger of two ints.
-@param first One of two ints to compare.
-@param second One of two ints to compare.
-@return The larger of the two ints.
-*/
-int max (int first, int second);
-
 #endif /* LUNAR_LANDER_GAMEFUNCTIONS_H */
\ No newline at end of file
@@ -11,6 +11,7 @@
 #include <stdbool.h>
 
 #include "GameObjects.h"
+#include "TerrainBuilding.h"
 
 /* Exit error codes. */
 #define EXIT_SUCCESS 0
@@ -23,6 +24,12 @@
 #define EXIT_NO_VERTICES_FAIL 7
 #define EXIT_SOUND_FAIL 8
 
+/* The sound effects' files, read from the level's pack if it has them and
+   from the working directory otherwise. */
+#define THRUST_SOUND "thrust.wav"
+#define CRASH_SOUND "boom.wav"
+#define LANDING_SOUND "land.wav"
+
 /**
 @def WINDOW_WIDTH
 @brief The default width of the window (in pixels).
@@ -37,7 +44,8 @@
 
 /**
 @def LEVEL_WIDTH
-@brief The default width of the level (in pixels).
+@brief The default width of the level (in pixels). A level whose vertices reach
+further than this is made wide enough to hold them.
 */
 
 #define LEVEL_WIDTH 900
@@ -49,6 +57,13 @@
 
 #define LEVEL_HEIGHT 500
 
+/**
+@def MAX_LEVEL_WIDTH
+@brief The widest level (in pixels) that can be loaded.
+*/
+
+#define MAX_LEVEL_WIDTH (1 << 28)
+
 /**
 @def LANDER_LENGTH
 @brief The default length of the lander (in pixels).
@@ -123,7 +138,9 @@ will have a score tier of TOP_SCORE_TIER - 3.
 @param lander Pointer to an empty Lander struct.
 @param terrain Pointer to a terrain struct whose data members have been 
 initialized.
-@param fileName String containing the name of the file to read vertices from.
+@param fileName String containing the name of the file to read vertices from
+(or "seed:" followed by a seed, to generate an endless level, or a level
+pack's file name, ':' and an entry's name, to load a level from the pack).
 */
 void initializeGameState (GameState *state, Lander *lander, Terrain *terrain,
 						  char *fileName);
@@ -143,6 +160,19 @@ bool initializeSDL (char *title, GameState *state);
 */
 bool initializeSound (GameState *state);
 
+/**
+@fn loadSound
+@brief Returns a sound effect, decoding it from the level's pack the first time
+it is needed.
+@param state Pointer to the current GameState struct.
+@param sound Pointer to the GameState's chunk for the sound (NULL until it has
+been decoded).
+@param name The name of the sound's file (THRUST_SOUND, CRASH_SOUND or
+LANDING_SOUND).
+@return The decoded sound, or NULL if it couldn't be loaded.
+*/
+Mix_Chunk *loadSound (GameState *state, Mix_Chunk **sound, char *name);
+
 /**
 @fn cleanAndExit
 @brief Cleans up SDL's subsystems and exits the program.
@@ -151,86 +181,4 @@ bool initializeSound (GameState *state);
 */
 void cleanAndExit(GameState *state, int errorCode);
 
-/**
-@fn getFlatLevel
-@brief Fills in an empty height map with a flat level at Y = heightOfTerrain.
-@param heightMap An empty Uint16 array of size levelWidth.
-@param heightOfTerrain The height (in pixels) to create flat terrain at.
-0 = bottommost pixel of screen.
-*/
-void getFlatLevel(Uint16 *heightMap, Uint16 heightOfTerrain);
-
-/**
-@fn buildHeightMap
-@brief Builds the terrain height map from an input file of vertices. 
-@param fileName The file of vertices to build the height map from.
-@param heightMap The array of Uint16s that will contain the height map.
-@param levelWidth The width (in pixels) of the level whose height map is
-being built.
-@param first Pointer to an initialized Vertex struct to be used as the first
-Vertex in the vertex list.
-*/
-void buildHeightMap (char *fileName, Uint16 *heightMap, Uint16 levelWidth,
-					 Vertex *first);
-
-/**
-@fn buildSlopeMap
-@brief Fills in the slope map with the slope of the terrain at each column.
-@param slopeMap The map of the terrain's slope to be filled. An array of size 
-levelWidth.
-@param fHeightMap An array of size levelWidth. fHeightMap will only be altered 
-wherever an undefined slope is found.
-@param first Pointer to the first Vertex in the linked Vertex list.
-@param levelWidth The width of the level (in pixels).
-*/
-void buildSlopeMap (float *slopeMap, float *fHeightMap, Vertex *first, 
-	                Uint16 levelWidth);
-
-/**
-@fn buildFHeightMap
-@brief Fills in the fractional height map with the fractional height of the 
-terrain at each column.
-@param fHeightMap The fractional height map to be built. An array of size 
-levelWidth.
-@param fHeightMap The map of the terrain's slope. An array of size levelWidth.
-@param first Pointer to the first Vertex in the linked Vertex list.
-@param levelWidth The width of the level (in pixels).
-*/
-void buildFHeightMap (float *fHeightMap, float *slopeMap, Vertex *first, 
-	                  Uint16 levelWidth);
-
-/**
-@fn readVertexList
-@brief Reads in the list of vertices describing the terrain from an input file
-and converts it into a linked list of Vertexes.
-@param fileName The name of the file to read from.
-@param first Pointer to the first Vertex in the list (statically allocated).
-@param levelWidth The width of the level (in pixels).
-*/
-void readVertexList(char* fileName, Vertex *first, Uint16 levelWidth);
-
-/**
-@fn findLandingStrips
-@brief Finds vertices that define flat strips of terrain at which the lander can
-safely land. 
-@param state The already initialized GameState struct.
-*/
-void findLandingStrips (GameState *state);
-
-/**
-@fn freeVertexList
-@brief Frees the linked list of Vertexes used for drawing terrain. Doesn't free
-the first Vertex because it is statically allocated.
-@param first Pointer to the first Vertex in the list.
-*/
-void freeVertexList(Vertex *first);
-
-/**
-@fn freeFlatList
-@brief Frees the linked list of Flat structs.
-@param first Pointer to the first Flat in the list.
-*/
-void freeFlatList (Flat* first);
-
-
 #endif /* LUNAR_LANDER_GAMEINITIALIZATION_H */
\ No newline at end of file
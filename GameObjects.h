@@ -17,22 +17,17 @@ state of the game.
 @typedef Vertex
 @brief A struct representing a vertex along the terrain.
 @details Indicates a point where the slope of the terrain changes. These 
-		 Vertexes are strung together to create an outline of the terrain, which
-		 is transformed into the height map. The pointer to the next Vertex is
-		 included in each struct. It is assumed that:
+		 Vertexes are stored in order in one array to create an outline of the
+		 terrain, which is transformed into the height map. It is assumed that:
 		 -no Vertex has X < 0.
 		 -no Vertex has Y < 0.
 		 -the next Vertex has X >= the current Vertex's X.
-		 -the last Vertex has a NULL pointer to the next Vertex.
 */
 typedef struct Vertex
 {
 	/* The X and Y coordinates of the Vertex. */
 	int X;
 	int Y;
-
-	/* The next Vertex to look at. */
-	struct Vertex *next;
 } Vertex;
 
 /**
@@ -51,11 +46,60 @@ typedef struct Flat
 
 	/* The score multiplier for landing at this strip (not lower than 0). */
 	Uint16 scoreModifier;
-
-	/* Pointer to the next Flat in the list. */
-	struct Flat *next;
 } Flat;
 
+/**
+@def MAX_MIP_LEVELS
+@brief The most rows a HeightIndex's min/max pyramid can have (enough for any
+level up to 2^31 columns wide).
+*/
+#define MAX_MIP_LEVELS 32
+
+/**
+@typedef HeightIndex
+@brief Precomputed highest and lowest terrain over ranges of columns.
+@details The columns are split into blocks of HEIGHT_BLOCK_SIZE columns. For
+each column the index holds the highest and lowest terrain from the start of
+its block up to it (prefix) and from it to the end of its block (suffix). For
+each block it holds the highest and lowest terrain over every run of 1, 2, 4...
+blocks starting there (a sparse table). A range of columns that crosses a
+block boundary is then covered by a suffix, two overlapping runs of whole
+blocks and a prefix, so its highest or lowest point is found in constant time.
+
+The index also holds a min/max pyramid: row k holds the highest and lowest
+terrain over each run of 2^k columns starting at a multiple of 2^k (the last
+run of a row is cut short by the end of the level). Row 0 is the height map
+itself. Whole runs of columns below a height can be skipped by climbing it.
+*/
+typedef struct HeightIndex
+{
+	/* The number of columns indexed and of blocks they are split into. */
+	Uint32 levelWidth;
+	Uint32 numBlocks;
+
+	/* Prefix and suffix extremes of each column within its block. */
+	Uint16 *prefixMax;
+	Uint16 *prefixMin;
+	Uint16 *suffixMax;
+	Uint16 *suffixMin;
+
+	/* Entry (k * numBlocks + b) covers blocks b to b + 2^k - 1. */
+	Uint16 *blockMax;
+	Uint16 *blockMin;
+
+	/* floorLog2[n] is the largest k with 2^k <= n. */
+	Uint8 *floorLog2;
+
+	/* The rows of the pyramid, from 1 to numMipLevels - 1 (row 0 is left
+	   NULL). Row k has ((levelWidth - 1) >> k) + 1 entries. */
+	Uint32 numMipLevels;
+	Uint16 *mipMax[MAX_MIP_LEVELS];
+	Uint16 *mipMin[MAX_MIP_LEVELS];
+} HeightIndex;
+
+struct TerrainStream;
+struct LevelPack;
+
 /**
 @typedef Terrain
 @brief Contains data about a single column of terrain to be drawn.
@@ -65,17 +109,89 @@ typedef struct Flat
 */
 typedef struct Terrain
 {
-	/* The first Vertex in the Vertex list. */
-	Vertex *firstVertex;
+	/* The array of Vertexes, sorted by X, and its length. */
+	Vertex *vertices;
+	Uint32 numVertices;
 
-	/* The first Flat in the Flat list. */
-	Flat *firstFlat;
+	/* The array of Flats, sorted by X, and its length. */
+	Flat *flats;
+	Uint32 numFlats;
+
+	/* An array of size levelWidth that holds, for each X position, the index
+	   in flats of the first Flat that doesn't end left of it (numFlats if
+	   there is none). Built by buildFlatTable. */
+	Uint32 *flatTable;
 
 	/* An array of size levelWidth that holds the height of terrain at each
-	   X position. */
+	   X position. Allocated by buildHeightMap. */
 	Uint16 *heightMap;
+
+	/* Range queries over the height map (built by buildHeightIndex). */
+	HeightIndex heightIndex;
+
+	/* The run of columns changed since the terrain was last drawn
+	   (changedFirst > changedLast if there is none). Widened by
+	   markTerrainChanged, and cleared by takeRenderSnapshot. */
+	Uint32 changedFirst;
+	Uint32 changedLast;
+
+	/* The level file the Vertexes, height map, index and Flats are read from
+	   in place (see LevelFile.h), or NULL if they were built from a text file.
+	   mappingSize is 0 if the level file is inside a level pack. */
+	void *mapping;
+	size_t mappingSize;
+
+	/* The level pack the level was loaded from (see LevelPack.h), kept open
+	   for its sounds, or NULL if it was loaded from a loose file. */
+	struct LevelPack *pack;
+
+	/* The chunks of a generated level held in the arrays above (see
+	   TerrainGenerator.h), or NULL if the level was loaded from a file. */
+	struct TerrainStream *stream;
 } Terrain;
 
+/**
+@typedef Real
+@brief The type of the lander's position and velocities.
+@details Normally a float. When built with FIXED_POINT_PHYSICS, it is instead a
+signed 32.32 fixed-point number (the lander's position in pixels times 2^32),
+so the physics is done in integer arithmetic only and gives bit-for-bit the same
+results whatever the compiler, optimization level or floating point unit, and
+has the same precision everywhere in the level. TO_REAL converts a number to a
+Real and FROM_REAL converts a Real to a double. In the floating point build
+TO_REAL leaves its argument as it is, so constants keep their double precision.
+REAL_RATIO converts the fraction numerator / denominator (both integers) to a
+Real without going through floating point in the fixed-point build.
+*/
+#ifdef FIXED_POINT_PHYSICS
+typedef Sint64 Real;
+#define REAL_ONE 4294967296.0
+#define TO_REAL(value) ((Real)((value) * REAL_ONE))
+#define FROM_REAL(real) ((double)(real) / REAL_ONE)
+#define REAL_RATIO(numerator, denominator) \
+	((Real)(numerator) * 4294967296LL / (denominator))
+#else
+typedef float Real;
+#define TO_REAL(value) (value)
+#define FROM_REAL(real) ((double)(real))
+#define REAL_RATIO(numerator, denominator) \
+	((numerator) / (double)(denominator))
+#endif
+
+/**
+@typedef Position
+@brief The type of the lander's position.
+@details In the floating point build this is a double rather than a float, so
+the lander moves as smoothly millions of pixels into a level as it does near
+its start. In the fixed-point build it is a Real, whose 32 integer bits
+already reach across any level. TO_REAL and FROM_REAL work on both.
+*/
+#ifdef FIXED_POINT_PHYSICS
+typedef Real Position;
+#else
+typedef double Position;
+#endif
+
 /**
 @typedef Lander
 @brief A struct representing the player's lunar lander.
@@ -85,11 +201,11 @@ and velocity.
 typedef struct Lander
 {
 	/* The absolute (real) positions of the lander's bottom-left corner. */
-	float realX;
-	float realY;
+	Position realX;
+	Position realY;
 
 	/* The rounded X and Y positions of the lander's bottom-left corner. */
-	Uint16 X;
+	Uint32 X;
 	Uint16 Y;
 
 	/* The length (left to right) and height (bottom to top) of the lander. */
@@ -100,10 +216,66 @@ typedef struct Lander
 	   Vertical velocity:   + is up, - is down.
 	   Horizontal velocity: + is right, - is left. 
 	*/
-	float vertVelocity;
-	float horVelocity;
+	Real vertVelocity;
+	Real horVelocity;
+
+	/* How far the lander moved during the last tick (before wrapping around
+	   the level), so collisions can be found anywhere along the path. */
+	Real deltaX;
+	Real deltaY;
 } Lander;
 
+/**
+@typedef GameSnapshot
+@brief A copy of everything in a GameState that changes during play.
+@details The snapshot holds no pointers. The level (its dimensions and terrain)
+stays in the GameState and is shared by every snapshot taken of it; only a
+generated level's position in its stream of chunks is noted. A snapshot can
+therefore be saved or restored by copying a few dozen bytes, stored in flat
+arrays, or written to a file and read back by another run of the game. The
+level can be reloaded (and narrowed) while it is played, so a snapshot taken
+before then is wrapped into the new width when it is restored.
+*/
+typedef struct GameSnapshot
+{
+	/* The lander, by value. */
+	Lander lander;
+
+	/* The game's clock, as in the GameState. */
+	Uint32 timeStart;
+	Uint32 timeElapsed;
+	Uint32 ticks;
+
+	/* The player's score and the fuel left in the lander. */
+	Uint16 score;
+	Uint16 fuel;
+
+	/* The focus point, as in the GameState. */
+	Sint32 focusPointX;
+	Uint16 focusPointY;
+	double realFocusPointX;
+	double realFocusPointY;
+
+	/* The chunk of a generated level the lander was in (0 for other levels). */
+	Sint32 terrainChunk;
+} GameSnapshot;
+
+/**
+@typedef CollisionCallback
+@brief A function called by the simulation whenever the lander lands or crashes.
+@details The callback receives the GameState the collision happened in, the 
+type of collision (1 for a proper landing, 2 for a crash), the score gained (if
+positive or 0) OR the fuel lost (if negative), and the user data pointer that
+was stored alongside the callback.
+*/
+struct GameState;
+struct ReplayLog;
+struct TerrainWatch;
+struct TerrainCache;
+struct TextCache;
+typedef void (*CollisionCallback)(struct GameState *state, int landingType, 
+								  int score, void *userData);
+
 /**
 @typedef GameState
 @brief A struct to track and alter the state of the game consistently.
@@ -117,7 +289,7 @@ typedef struct GameState
 	Lander *lander;
 
 	/* The dimensions of the level (in pixels). */
-	Uint16 levelWidth;
+	Uint32 levelWidth;
 	Uint16 levelHeight;
 
 	/* @TODO: implement the Terrain struct... */
@@ -130,6 +302,9 @@ typedef struct GameState
 	/* The game's elapsed time. */
 	Uint32 timeElapsed;
 
+	/* The number of ticks of physics simulated so far. */
+	Uint32 ticks;
+
 	/* The player's score. */
 	Uint16 score;
 
@@ -141,12 +316,12 @@ typedef struct GameState
 	SDL_Renderer *renderer;
 
 	/* The top-left corner of the slice of level being displayed on-screen. */
-	Sint16 focusPointX;
+	Sint32 focusPointX;
 	Uint16 focusPointY;
 
 	/* The real (fractional) dimensions of the focus point. */
-	float realFocusPointX;
-	float realFocusPointY;
+	double realFocusPointX;
+	double realFocusPointY;
 
 	/* The audio device to play sound files. */
 	SDL_AudioDeviceID audioDevice;
@@ -156,8 +331,133 @@ typedef struct GameState
 	Mix_Chunk *boom;
 	Mix_Chunk *ding;
 
+	/* Function called when a landing or crash is resolved (may be NULL), and 
+	   the data passed along to it. */
+	CollisionCallback onCollision;
+	void *collisionData;
+
+	/* The replay log the player's input is being recorded to (may be NULL). */
+	struct ReplayLog *replay;
+
+	/* The watch on the level's file, reloading it when it changes (may be
+	   NULL). */
+	struct TerrainWatch *terrainWatch;
+
+	/* The terrain drawn into textures, so it isn't drawn line by line every
+	   frame (may be NULL). */
+	struct TerrainCache *terrainCache;
+
+	/* The text and HUD fields drawn into textures, so they aren't drawn pixel
+	   by pixel every frame (may be NULL). */
+	struct TextCache *textCache;
+
 	/* Textures and sprites. */
 
 } GameState;
 
+/**
+@typedef VertexRun
+@brief A run of the terrain's Vertexes, copied out of it for drawing.
+*/
+typedef struct VertexRun
+{
+	/* The columns the run covers: every line of the terrain that crosses one
+	   of them runs between two of its Vertexes. */
+	int first;
+	int last;
+
+	/* The Vertexes (none if the columns are past all of the terrain), and
+	   the number the array has room for. */
+	Vertex *vertices;
+	Uint32 numVertices;
+	Uint32 capacity;
+} VertexRun;
+
+/**
+@typedef ScoreLabel
+@brief A score modifier to be drawn below a strip of flat landing terrain.
+*/
+typedef struct ScoreLabel
+{
+	/* The top-left corner of the label in the window. */
+	int X;
+	int Y;
+
+	/* The score modifier written in the label. */
+	Uint16 scoreModifier;
+} ScoreLabel;
+
+/**
+@typedef RenderSnapshot
+@brief Everything drawn in one frame, copied out of the GameState by
+takeRenderSnapshot, along with what is needed to draw it.
+@details A snapshot holds copies of everything it draws, including the
+terrain's Vertexes around the window, rather than pointers into the game's
+state, so it can be drawn while the game carries on (on another thread, say)
+changing or even reallocating its terrain. Its arrays are kept from one
+snapshot to the next, and only grown when more is in view than ever before.
+
+Drawing a snapshot writes to it (its buffer of points) and to the caches it
+carries (whose textures are filled and evicted as the view moves), so the
+drawing code takes it as a non-const render context. A snapshot belongs to
+the one thread drawing with its renderer, as do that renderer's caches.
+Snapshots of different renderers, such as the game's window and an
+exporter's surface, share nothing, so they can be drawn at the same time.
+*/
+typedef struct RenderSnapshot
+{
+	/* The renderer to draw with, and the terrain and text drawn into textures
+	   for it (either may be NULL). */
+	SDL_Renderer *renderer;
+	struct TerrainCache *terrainCache;
+	struct TextCache *textCache;
+
+	/* The width of the level. */
+	Uint32 levelWidth;
+
+	/* The columns of the terrain changed since the last snapshot was taken
+	   (none if changedFirst > changedLast). */
+	Uint32 changedFirst;
+	Uint32 changedLast;
+
+	/* The Vertexes of the columns drawn, from the left edge of the window
+	   (or of the first tile it crosses, if the terrain is cached) onwards,
+	   then from the start of the level if the window wraps around its end
+	   (no columns otherwise). */
+	VertexRun terrain;
+	VertexRun wrapped;
+
+	/* The height of the terrain in each column of the window (NULL if the
+	   array couldn't be allocated). */
+	Uint16 *heights;
+
+	/* The score modifiers of the strips in the window. */
+	ScoreLabel *labels;
+	Uint32 numLabels;
+	Uint32 labelCapacity;
+
+	/* The points handed to the renderer by drawTerrain and drawHeightMap,
+	   and the number the array has room for. */
+	SDL_Point *points;
+	Uint32 pointCapacity;
+
+	/* The lander, by value. */
+	Lander lander;
+
+	/* The focus point, as in the GameState. */
+	Sint32 focusPointX;
+	Uint16 focusPointY;
+	double realFocusPointX;
+	double realFocusPointY;
+
+	/* The values shown on the HUD, and the game's elapsed time (which the
+	   score modifiers flash by). */
+	Uint16 score;
+	Uint16 fuel;
+	int minutes;
+	int seconds;
+	int altitude;
+	Uint32 timeElapsed;
+} RenderSnapshot;
+
 #endif /* LUNAR_LANDER_GAMEOBJECTS_H */
\ No newline at end of file
@@ -0,0 +1,222 @@
+/**
+@file Headless.c
+@author Rob Thomas
+@brief Runs simulated Lunar Lander flights without a window or audio device.
+@details This file contains the main function of LunarLanderHeadless. It loads
+a level, flies the lander from a series of pseudo-random starting positions
+with a simple autopilot, and reports how many flights landed or crashed and how
+quickly they were simulated. Only the simulation and terrain building code is
+linked in, so it runs on machines without a display or sound card.
+Given a replay log instead, it re-runs the recorded game at full speed and
+checks that it ends in the recorded state, on the terrain the log was recorded
+on unless another is given.
+
+Usage: LunarLanderHeadless [terrainFile] [numFlights]
+       LunarLanderHeadless --replay replayFile [terrainFile]
+*/
+
+#include <SDL2/SDL.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+#include "GameInitialization.h"
+#include "TerrainBuilding.h"
+#include "Simulation.h"
+#include "Replay.h"
+#include "GameObjects.h"
+
+
+/**
+@def DEFAULT_FLIGHTS
+@brief The number of flights to simulate if none is given on the command line.
+*/
+#define DEFAULT_FLIGHTS 10000
+
+/**
+@def MAX_FLIGHT_TICKS
+@brief The number of ticks (ten minutes of game time) after which a flight that
+hasn't touched down is abandoned.
+*/
+#define MAX_FLIGHT_TICKS (PHYSICS_TICK_RATE * 600)
+
+/**
+@typedef FlightTally
+@brief Counts the outcomes of the simulated flights.
+*/
+typedef struct FlightTally
+{
+	Uint32 landings;
+	Uint32 crashes;
+	Uint32 timeouts;
+	Uint64 ticks;
+	long totalScore;
+} FlightTally;
+
+/**
+@fn countCollision
+@brief Tallies a landing or crash. Used as the GameState's onCollision callback.
+@param state Pointer to the current GameState struct.
+@param landingType The type of collision that has occurred.
+@param score The score gained (if positive or 0) OR the fuel lost (if negative).
+@param userData Pointer to the FlightTally to update.
+*/
+static void countCollision (GameState *state, int landingType, int score,
+							void *userData)
+{
+	FlightTally *tally = (FlightTally*)userData;
+
+	if (landingType == LANDING_PROPER)
+	{
+		tally->landings++;
+		tally->totalScore += score;
+	}
+	else
+	{
+		tally->crashes++;
+	}
+}
+
+/**
+@fn nextRandom
+@brief Advances a xorshift32 generator and returns its next value.
+@param seed Pointer to the generator's state. Must not be 0.
+@return The next pseudo-random number.
+*/
+static Uint32 nextRandom (Uint32 *seed)
+{
+	*seed ^= *seed << 13;
+	*seed ^= *seed >> 17;
+	*seed ^= *seed << 5;
+
+	return *seed;
+}
+
+/**
+@fn main
+@brief The main function for LunarLanderHeadless.
+*/
+int main(int argc, char *argv[])
+{
+	GameState state;
+	Lander lander;
+	Terrain terrain;
+	char *fileName = "terrain.txt";
+	char *replayFileName = NULL;
+	char recordedFileName[REPLAY_NAME_SIZE];
+	long numFlights = DEFAULT_FLIGHTS;
+	FlightTally tally = {0, 0, 0, 0, 0};
+	Uint32 seed = 2463534242u;
+
+	/*** Read the command line. ***/
+	int position = 0;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+		{
+			replayFileName = argv[++i];
+		}
+		else if (position++ == 0)
+		{
+			fileName = argv[i];
+		}
+		else
+		{
+			numFlights = strtol(argv[i], NULL, 10);
+		}
+	}
+
+	/* A replay is played on the terrain it was recorded on, unless told
+	   otherwise. */
+	if (replayFileName != NULL && position == 0)
+	{
+		if (!readReplayTerrainName(replayFileName, recordedFileName))
+		{
+			return EXIT_BADFILE_FAIL;
+		}
+		fileName = recordedFileName;
+	}
+
+	/*** Initialize the terrain and the simulated game state. ***/
+	terrain.vertices = NULL;
+	terrain.numVertices = 0;
+	terrain.heightMap = NULL;
+
+	initializeSimulation(&state, &lander, &terrain, fileName);
+
+	/*** If given a replay log, just run it. ***/
+	if (replayFileName != NULL)
+	{
+		bool matched = runReplay(replayFileName, fileName, &state);
+
+		freeTerrain(&terrain);
+
+		return matched ? EXIT_SUCCESS : EXIT_BADFILE_FAIL;
+	}
+
+	state.onCollision = countCollision;
+	state.collisionData = &tally;
+
+	/*** Fly each flight until it touches down or runs out of time. ***/
+	clock_t start = clock();
+
+	for (long flight = 0; flight < numFlights; flight++)
+	{
+		int landingType = LANDING_NONE;
+		Uint32 tick;
+
+		/* Respawn the lander somewhere along the level with a small drift. */
+		softReset(&state);
+		state.fuel = FUEL_START;
+		lander.realX = TO_REAL(nextRandom(&seed) % state.levelWidth);
+		lander.X = REAL_TO_INT(lander.realX);
+		lander.horVelocity = REAL_RATIO((int)(nextRandom(&seed) % 201) - 100,
+										100);
+
+		for (tick = 0; tick < MAX_FLIGHT_TICKS; tick++)
+		{
+			/* The autopilot reacts as often as a player's key repeat would. */
+			if (tick % (PHYSICS_TICK_RATE / BASE_TICK_RATE) == 0)
+			{
+				flyAutopilot(&state, 0.6, 0.3);
+			}
+			simulateTick(&state);
+
+			landingType = detectCollision(state);
+			if (landingType != LANDING_NONE)
+			{
+				resolveCollision(&state, landingType);
+				break;
+			}
+		}
+
+		if (landingType == LANDING_NONE)
+		{
+			tally.timeouts++;
+		}
+		tally.ticks += tick;
+	}
+
+	double seconds = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+	/*** Report the results. ***/
+	printf("flights:   %ld\n", numFlights);
+	printf("landings:  %u\n", tally.landings);
+	printf("crashes:   %u\n", tally.crashes);
+	printf("timeouts:  %u\n", tally.timeouts);
+	printf("score:     %ld\n", tally.totalScore);
+	printf("ticks:     %llu\n", (unsigned long long)(tally.ticks));
+	if (seconds > 0)
+	{
+		printf("flights/s: %.0f\n", numFlights / seconds);
+		printf("ticks/s:   %.0f\n", tally.ticks / seconds);
+	}
+
+	/*** Clean up. ***/
+	freeTerrain(&terrain);
+
+	return EXIT_SUCCESS;
+}
@@ -0,0 +1,555 @@
+/**
+@file LanderBatch.c
+@author Rob Thomas
+@brief Contains functions for stepping many landers at once.
+@details The movement of a batch is computed BATCH_LANES (AVX2) or 4 (SSE2)
+landers at a time. The terrain test first rejects, in the same vectors, every
+lander that stayed above the highest column of terrain for the whole tick; only
+the landers that are left have their paths swept over the height map, one at a
+time.
+Note that the floating point batch works in single precision throughout, so
+its landers can drift from a Lander stepped by simulateTick (which subtracts
+GRAVITY in double precision) by a rounding error per tick. The fixed-point
+batch moves its landers exactly as simulateTick does.
+*/
+
+#include <SDL2/SDL.h>
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <math.h>
+
+#if defined(__AVX2__) || (defined(__SSE2__) && !defined(FIXED_POINT_PHYSICS))
+#include <immintrin.h>
+#endif
+
+#include "GameObjects.h"
+#include "GameInitialization.h"
+#include "TerrainBuilding.h"
+#include "Simulation.h"
+
+#include "LanderBatch.h"
+
+
+#if defined(FIXED_POINT_PHYSICS) && defined(__AVX2__)
+/**
+@fn scaleVectorByTick
+@brief Multiplies four fixed-point Reals by TICK_SCALE in the same way as
+SCALE_BY_TICK. AVX2 has no 64-bit arithmetic shift, so negative lanes are
+complemented, shifted logically and complemented back.
+@param values The Reals to scale.
+@return The scaled Reals.
+*/
+static __m256i scaleVectorByTick (__m256i values)
+{
+	__m256i negative = _mm256_cmpgt_epi64(_mm256_setzero_si256(), values);
+
+	return _mm256_xor_si256(_mm256_srli_epi64(
+							_mm256_xor_si256(values, negative),
+							TICK_SCALE_SHIFT), negative);
+}
+
+/**
+@fn findFlyingLanes
+@brief Finds which of four landers are still flying.
+@param batch Pointer to the LanderBatch.
+@param i The index of the first of the four landers.
+@return A mask with every bit of lane n set if lander i + n is still flying.
+*/
+static __m256i findFlyingLanes (LanderBatch *batch, Uint32 i)
+{
+	__m256i types = _mm256_cvtepi32_epi64(
+						_mm_loadu_si128((__m128i*)(batch->landingType + i)));
+
+	return _mm256_cmpeq_epi64(types, _mm256_setzero_si256());
+}
+
+/**
+@fn moveLandersVector
+@brief Applies gravity and movement to landers [first, last) of a batch, four
+at a time, using AVX2 64-bit integer instructions.
+@param batch Pointer to the LanderBatch to step.
+@param first The index of the first lander to move (a multiple of 4).
+@param last The index after the last lander to move (a multiple of 4).
+@param levelWidth The width of the level (in pixels).
+*/
+static void moveLandersVector (LanderBatch *batch, Uint32 first, Uint32 last,
+							   Uint32 levelWidth)
+{
+	const __m256i gravity = _mm256_set1_epi64x(TO_REAL(GRAVITY * TICK_SCALE));
+	const __m256i width = _mm256_set1_epi64x(TO_REAL(levelWidth));
+	const __m256i lastX = _mm256_set1_epi64x(TO_REAL(levelWidth) - 1);
+	const __m256i zero = _mm256_setzero_si256();
+
+	for (Uint32 i = first; i < last; i += 4)
+	{
+		/* Only landers that are still flying are moved. */
+		__m256i flying = findFlyingLanes(batch, i);
+
+		__m256i vy = _mm256_loadu_si256((__m256i*)(batch->vertVelocity + i));
+		__m256i vx = _mm256_loadu_si256((__m256i*)(batch->horVelocity + i));
+		__m256i x = _mm256_loadu_si256((__m256i*)(batch->realX + i));
+		__m256i y = _mm256_loadu_si256((__m256i*)(batch->realY + i));
+
+		__m256i newVy = _mm256_sub_epi64(vy, gravity);
+
+		/* Move horizontally, wrapping around either edge of the level. */
+		__m256i newX = _mm256_add_epi64(x, scaleVectorByTick(vx));
+		newX = _mm256_add_epi64(newX, _mm256_and_si256(
+								_mm256_cmpgt_epi64(zero, newX), width));
+		newX = _mm256_sub_epi64(newX, _mm256_and_si256(
+								_mm256_cmpgt_epi64(newX, lastX), width));
+
+		__m256i newY = _mm256_add_epi64(y, scaleVectorByTick(newVy));
+
+		_mm256_storeu_si256((__m256i*)(batch->vertVelocity + i),
+							_mm256_blendv_epi8(vy, newVy, flying));
+		_mm256_storeu_si256((__m256i*)(batch->realX + i),
+							_mm256_blendv_epi8(x, newX, flying));
+		_mm256_storeu_si256((__m256i*)(batch->realY + i),
+							_mm256_blendv_epi8(y, newY, flying));
+	}
+}
+
+/**
+@fn findLowLanders
+@brief Finds which of four landers are still flying and low enough that they
+might be touching the terrain.
+@param batch Pointer to the LanderBatch.
+@param i The index of the first of the four landers.
+@return A bit mask with bit n set if lander i + n must be tested.
+*/
+static int findLowLanders (LanderBatch *batch, Uint32 i)
+{
+	__m256i top = _mm256_set1_epi64x(TO_REAL(batch->terrainTop + 1));
+	__m256i y = _mm256_loadu_si256((__m256i*)(batch->realY + i));
+	__m256i vy = _mm256_loadu_si256((__m256i*)(batch->vertVelocity + i));
+
+	/* A rising lander was lowest at the start of the tick. */
+	__m256i startY = _mm256_sub_epi64(y, scaleVectorByTick(vy));
+	__m256i low = _mm256_or_si256(_mm256_cmpgt_epi64(top, y),
+								  _mm256_cmpgt_epi64(top, startY));
+
+	return _mm256_movemask_pd(_mm256_castsi256_pd(
+							  _mm256_and_si256(low, findFlyingLanes(batch, i))));
+}
+
+#define VECTOR_LANES 4
+
+#elif defined(__AVX2__) && !defined(FIXED_POINT_PHYSICS)
+/**
+@fn moveLandersVector
+@brief Applies gravity and movement to landers [first, last) of a batch, eight
+at a time, using AVX2.
+@param batch Pointer to the LanderBatch to step.
+@param first The index of the first lander to move (a multiple of 8).
+@param last The index after the last lander to move (a multiple of 8).
+@param levelWidth The width of the level (in pixels).
+*/
+static void moveLandersVector (LanderBatch *batch, Uint32 first, Uint32 last,
+							   Uint32 levelWidth)
+{
+	const __m256 gravity = _mm256_set1_ps((float)(GRAVITY * TICK_SCALE));
+	const __m256 scale = _mm256_set1_ps((float)(TICK_SCALE));
+	const __m256 width = _mm256_set1_ps((float)(levelWidth));
+	const __m256 zero = _mm256_setzero_ps();
+
+	for (Uint32 i = first; i < last; i += 8)
+	{
+		/* Only landers that are still flying are moved. */
+		__m256i types = _mm256_loadu_si256((__m256i*)(batch->landingType + i));
+		__m256 flying = _mm256_castsi256_ps(
+							_mm256_cmpeq_epi32(types, _mm256_setzero_si256()));
+
+		__m256 vy = _mm256_loadu_ps(batch->vertVelocity + i);
+		__m256 vx = _mm256_loadu_ps(batch->horVelocity + i);
+		__m256 x = _mm256_loadu_ps(batch->realX + i);
+		__m256 y = _mm256_loadu_ps(batch->realY + i);
+
+		__m256 newVy = _mm256_sub_ps(vy, gravity);
+
+		/* Move horizontally, wrapping around either edge of the level. */
+		__m256 newX = _mm256_add_ps(x, _mm256_mul_ps(vx, scale));
+		newX = _mm256_add_ps(newX, _mm256_and_ps(
+							 _mm256_cmp_ps(newX, zero, _CMP_LT_OQ), width));
+		newX = _mm256_sub_ps(newX, _mm256_and_ps(
+							 _mm256_cmp_ps(newX, width, _CMP_GE_OQ), width));
+
+		__m256 newY = _mm256_add_ps(y, _mm256_mul_ps(newVy, scale));
+
+		_mm256_storeu_ps(batch->vertVelocity + i,
+						 _mm256_blendv_ps(vy, newVy, flying));
+		_mm256_storeu_ps(batch->realX + i, _mm256_blendv_ps(x, newX, flying));
+		_mm256_storeu_ps(batch->realY + i, _mm256_blendv_ps(y, newY, flying));
+	}
+}
+
+/**
+@fn findLowLanders
+@brief Finds which of eight landers are still flying and low enough that they
+might be touching the terrain.
+@param batch Pointer to the LanderBatch.
+@param i The index of the first of the eight landers.
+@return A bit mask with bit n set if lander i + n must be tested.
+*/
+static int findLowLanders (LanderBatch *batch, Uint32 i)
+{
+	__m256 top = _mm256_set1_ps((float)(batch->terrainTop) + 1.0f);
+	__m256i types = _mm256_loadu_si256((__m256i*)(batch->landingType + i));
+	__m256 flying = _mm256_castsi256_ps(
+						_mm256_cmpeq_epi32(types, _mm256_setzero_si256()));
+	__m256 y = _mm256_loadu_ps(batch->realY + i);
+	__m256 vy = _mm256_loadu_ps(batch->vertVelocity + i);
+
+	/* A rising lander was lowest at the start of the tick. */
+	__m256 lowest = _mm256_min_ps(y, _mm256_sub_ps(y, _mm256_mul_ps(vy,
+								  _mm256_set1_ps((float)(TICK_SCALE)))));
+	__m256 low = _mm256_cmp_ps(lowest, top, _CMP_LT_OQ);
+
+	return _mm256_movemask_ps(_mm256_and_ps(low, flying));
+}
+
+#define VECTOR_LANES 8
+
+#elif defined(__SSE2__) && !defined(FIXED_POINT_PHYSICS)
+/**
+@fn moveLandersVector
+@brief Applies gravity and movement to landers [first, last) of a batch, four
+at a time, using SSE2.
+@param batch Pointer to the LanderBatch to step.
+@param first The index of the first lander to move (a multiple of 4).
+@param last The index after the last lander to move (a multiple of 4).
+@param levelWidth The width of the level (in pixels).
+*/
+static void moveLandersVector (LanderBatch *batch, Uint32 first, Uint32 last,
+							   Uint32 levelWidth)
+{
+	const __m128 gravity = _mm_set1_ps((float)(GRAVITY * TICK_SCALE));
+	const __m128 scale = _mm_set1_ps((float)(TICK_SCALE));
+	const __m128 width = _mm_set1_ps((float)(levelWidth));
+	const __m128 zero = _mm_setzero_ps();
+
+	for (Uint32 i = first; i < last; i += 4)
+	{
+		/* Only landers that are still flying are moved. */
+		__m128i types = _mm_loadu_si128((__m128i*)(batch->landingType + i));
+		__m128 flying = _mm_castsi128_ps(
+							_mm_cmpeq_epi32(types, _mm_setzero_si128()));
+
+		__m128 vy = _mm_loadu_ps(batch->vertVelocity + i);
+		__m128 vx = _mm_loadu_ps(batch->horVelocity + i);
+		__m128 x = _mm_loadu_ps(batch->realX + i);
+		__m128 y = _mm_loadu_ps(batch->realY + i);
+
+		__m128 newVy = _mm_sub_ps(vy, gravity);
+
+		/* Move horizontally, wrapping around either edge of the level. */
+		__m128 newX = _mm_add_ps(x, _mm_mul_ps(vx, scale));
+		newX = _mm_add_ps(newX, _mm_and_ps(_mm_cmplt_ps(newX, zero), width));
+		newX = _mm_sub_ps(newX, _mm_and_ps(_mm_cmpge_ps(newX, width), width));
+
+		__m128 newY = _mm_add_ps(y, _mm_mul_ps(newVy, scale));
+
+		/* SSE2 has no blend, so select with and/andnot. */
+		_mm_storeu_ps(batch->vertVelocity + i,
+					  _mm_or_ps(_mm_and_ps(flying, newVy),
+								_mm_andnot_ps(flying, vy)));
+		_mm_storeu_ps(batch->realX + i,
+					  _mm_or_ps(_mm_and_ps(flying, newX),
+								_mm_andnot_ps(flying, x)));
+		_mm_storeu_ps(batch->realY + i,
+					  _mm_or_ps(_mm_and_ps(flying, newY),
+								_mm_andnot_ps(flying, y)));
+	}
+}
+
+/**
+@fn findLowLanders
+@brief Finds which of four landers are still flying and low enough that they
+might be touching the terrain.
+@param batch Pointer to the LanderBatch.
+@param i The index of the first of the four landers.
+@return A bit mask with bit n set if lander i + n must be tested.
+*/
+static int findLowLanders (LanderBatch *batch, Uint32 i)
+{
+	__m128 top = _mm_set1_ps((float)(batch->terrainTop) + 1.0f);
+	__m128i types = _mm_loadu_si128((__m128i*)(batch->landingType + i));
+	__m128 flying = _mm_castsi128_ps(
+						_mm_cmpeq_epi32(types, _mm_setzero_si128()));
+	__m128 y = _mm_loadu_ps(batch->realY + i);
+	__m128 vy = _mm_loadu_ps(batch->vertVelocity + i);
+
+	/* A rising lander was lowest at the start of the tick. */
+	__m128 lowest = _mm_min_ps(y, _mm_sub_ps(y, _mm_mul_ps(vy,
+							   _mm_set1_ps((float)(TICK_SCALE)))));
+	__m128 low = _mm_cmplt_ps(lowest, top);
+
+	return _mm_movemask_ps(_mm_and_ps(low, flying));
+}
+
+#define VECTOR_LANES 4
+
+#else
+/**
+@fn moveLandersVector
+@brief Applies gravity and movement to landers [first, last) of a batch one at
+a time (used when neither SSE2 nor AVX2 is available, and for the fixed-point
+batch when AVX2 isn't, since SSE2 has no 64-bit comparisons).
+@param batch Pointer to the LanderBatch to step.
+@param first The index of the first lander to move.
+@param last The index after the last lander to move.
+@param levelWidth The width of the level (in pixels).
+*/
+static void moveLandersVector (LanderBatch *batch, Uint32 first, Uint32 last,
+							   Uint32 levelWidth)
+{
+	Real width = (Real)(TO_REAL(levelWidth));
+	Real gravity = (Real)(TO_REAL(GRAVITY * TICK_SCALE));
+
+	for (Uint32 i = first; i < last; i++)
+	{
+		if (batch->landingType[i] != LANDING_NONE)
+		{
+			continue;
+		}
+
+		batch->vertVelocity[i] -= gravity;
+
+		batch->realX[i] += (Real)(SCALE_BY_TICK(batch->horVelocity[i]));
+		if (batch->realX[i] < 0)
+		{
+			batch->realX[i] += width;
+		}
+		else if (batch->realX[i] >= width)
+		{
+			batch->realX[i] -= width;
+		}
+
+		batch->realY[i] += (Real)(SCALE_BY_TICK(batch->vertVelocity[i]));
+	}
+}
+
+/**
+@fn findLowLanders
+@brief Finds which lander is still flying and low enough that it might be
+touching the terrain.
+@param batch Pointer to the LanderBatch.
+@param i The index of the lander.
+@return 1 if lander i must be tested, 0 otherwise.
+*/
+static int findLowLanders (LanderBatch *batch, Uint32 i)
+{
+	Real top = (Real)(TO_REAL(batch->terrainTop + 1));
+	Real startY = batch->realY[i] -
+				  (Real)(SCALE_BY_TICK(batch->vertVelocity[i]));
+
+	/* A rising lander was lowest at the start of the tick. */
+	return (batch->landingType[i] == LANDING_NONE &&
+			(batch->realY[i] < top || startY < top));
+}
+
+#define VECTOR_LANES 1
+
+#endif
+
+/**
+@fn testBatchLander
+@brief Checks one lander of a batch for a collision with the terrain anywhere
+along its path for the last tick, in the same way sweepCollision does for a
+single Lander.
+@param batch Pointer to the LanderBatch.
+@param index The index of the lander to test.
+@param terrain Pointer to the Terrain, with its height index built.
+@param levelWidth The width of the level (in pixels).
+@return The type of collision that occurred (LANDING_NONE if none).
+*/
+static int testBatchLander (LanderBatch *batch, Uint32 index,
+							Terrain *terrain, Uint32 levelWidth)
+{
+	/* The batch is tested straight after it moves, so the last tick's path
+	   is given by the velocities. */
+	Real deltaX = (Real)(SCALE_BY_TICK(batch->horVelocity[index]));
+	Real deltaY = (Real)(SCALE_BY_TICK(batch->vertVelocity[index]));
+	int leftX;
+
+	if (!findImpact(terrain, levelWidth, batch->length,
+					(Position)(batch->realX[index]) - deltaX,
+					(Position)(batch->realY[index]) - deltaY, deltaX, deltaY,
+					&leftX))
+	{
+		return LANDING_NONE;
+	}
+
+	/* levelWidth is unsigned, so wrap in a signed type for a column left of
+	   the start of the level to land at the end of it. */
+	leftX = (int)((((Sint64)(leftX) % levelWidth) + levelWidth) % levelWidth);
+
+	/* The speed of the lander must be at or under the LANDING_THRESHOLD and
+	   the terrain must be flat. */
+	if ( isLandingVelocity(batch->horVelocity[index],
+						   batch->vertVelocity[index]) &&
+		 getHighestTerrain(terrain, leftX, batch->length + 1) ==
+		 getLowestTerrain(terrain, leftX, batch->length + 1) )
+	{
+		return LANDING_PROPER;
+	}
+
+	return LANDING_CRASH;
+}
+
+
+/**
+@fn createLanderBatch
+@brief Allocates the arrays of a LanderBatch.
+@details Each array is padded to a multiple of BATCH_LANES. Every lander
+(including the padding) starts out as already touched down, so only landers
+placed with setBatchLander are moved.
+@param batch Pointer to the LanderBatch to fill.
+@param count The number of landers in the batch.
+@param terrain The terrain the landers will fly over.
+@param levelWidth The width of the level (in pixels).
+@return True if the arrays were allocated, false otherwise.
+*/
+bool createLanderBatch (LanderBatch *batch, Uint32 count, Terrain *terrain,
+						Uint32 levelWidth)
+{
+	batch->count = count;
+	batch->capacity = ((count + BATCH_LANES - 1) / BATCH_LANES) * BATCH_LANES;
+	batch->length = LANDER_LENGTH;
+
+	batch->realX = (Real*)calloc(batch->capacity, sizeof(Real));
+	batch->realY = (Real*)calloc(batch->capacity, sizeof(Real));
+	batch->horVelocity = (Real*)calloc(batch->capacity, sizeof(Real));
+	batch->vertVelocity = (Real*)calloc(batch->capacity, sizeof(Real));
+	batch->landingType = (Sint32*)malloc(batch->capacity * sizeof(Sint32));
+
+	if (batch->realX == NULL || batch->realY == NULL ||
+		batch->horVelocity == NULL || batch->vertVelocity == NULL ||
+		batch->landingType == NULL)
+	{
+		freeLanderBatch(batch);
+		return false;
+	}
+
+	for (Uint32 i = 0; i < batch->capacity; i++)
+	{
+		batch->landingType[i] = LANDING_CRASH;
+	}
+
+	/* Find the highest column of terrain once, for rejecting high landers. */
+	batch->terrainTop = getHighestTerrain(terrain, 0, levelWidth);
+
+	return true;
+}
+
+/**
+@fn freeLanderBatch
+@brief Frees the arrays of a LanderBatch.
+@param batch Pointer to the LanderBatch to free.
+*/
+void freeLanderBatch (LanderBatch *batch)
+{
+	free(batch->realX);
+	free(batch->realY);
+	free(batch->horVelocity);
+	free(batch->vertVelocity);
+	free(batch->landingType);
+
+	batch->realX = NULL;
+	batch->realY = NULL;
+	batch->horVelocity = NULL;
+	batch->vertVelocity = NULL;
+	batch->landingType = NULL;
+	batch->count = 0;
+	batch->capacity = 0;
+}
+
+/**
+@fn setBatchLander
+@brief Places one lander of a batch and gets it flying.
+@param batch Pointer to the LanderBatch.
+@param index The index of the lander to place.
+@param lander The Lander whose position and velocities are copied.
+*/
+void setBatchLander (LanderBatch *batch, Uint32 index, Lander lander)
+{
+	batch->realX[index] = lander.realX;
+	batch->realY[index] = lander.realY;
+	batch->horVelocity[index] = lander.horVelocity;
+	batch->vertVelocity[index] = lander.vertVelocity;
+	batch->landingType[index] = LANDING_NONE;
+	batch->length = lander.length;
+}
+
+/**
+@fn applyBatchThrust
+@brief Fires one of a batched lander's thrusters for one tick.
+@details Batched landers have no fuel tank, so the thruster always fires.
+@param batch Pointer to the LanderBatch.
+@param index The index of the lander to thrust.
+@param direction The thruster to fire (THRUST_UP, THRUST_LEFT or THRUST_RIGHT).
+*/
+void applyBatchThrust (LanderBatch *batch, Uint32 index, int direction)
+{
+	switch (direction)
+	{
+		case THRUST_UP:
+			batch->vertVelocity[index] += (Real)(TO_REAL(UP_THRUST_POWER));
+			break;
+		case THRUST_LEFT:
+			batch->horVelocity[index] += (Real)(TO_REAL(LEFT_THRUST_POWER));
+			break;
+		case THRUST_RIGHT:
+			batch->horVelocity[index] -= (Real)(TO_REAL(RIGHT_THRUST_POWER));
+			break;
+		default:
+			break;
+	}
+}
+
+/**
+@fn stepLanderBatch
+@brief Applies one tick of game time to every lander still flying in a batch,
+then checks each of them for a collision with the terrain.
+@param batch Pointer to the LanderBatch to step.
+@param terrain The terrain the landers are flying over.
+@param levelWidth The width of the level (in pixels).
+@return The number of landers that touched down during this tick.
+*/
+Uint32 stepLanderBatch (LanderBatch *batch, Terrain *terrain,
+						Uint32 levelWidth)
+{
+	Uint32 touchedDown = 0;
+
+	/*** Apply gravity and move every lander (capacity is a multiple of every
+	     kernel's width). ***/
+	moveLandersVector(batch, 0, batch->capacity, levelWidth);
+
+	/*** Test only the landers that are low enough to be touching terrain. ***/
+	for (Uint32 i = 0; i < batch->capacity; i += VECTOR_LANES)
+	{
+		int low = findLowLanders(batch, i);
+
+		while (low != 0)
+		{
+			/* Take the lowest set bit. */
+			int lane = 0;
+			while (!(low & (1 << lane)))
+			{
+				lane++;
+			}
+			low &= ~(1 << lane);
+
+			int landingType = testBatchLander(batch, i + lane,
+											  terrain, levelWidth);
+			if (landingType != LANDING_NONE)
+			{
+				batch->landingType[i + lane] = landingType;
+				touchedDown++;
+			}
+		}
+	}
+
+	return touchedDown;
+}
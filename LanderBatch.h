@@ -0,0 +1,110 @@
+/**
+@file LanderBatch.h
+@author Rob Thomas
+@brief Contains the LanderBatch struct and functions for stepping many landers
+at once.
+@details A LanderBatch stores many landers as parallel arrays (one array per
+field) so that gravity, movement, wraparound and the terrain collision test can
+be applied to several landers per instruction with SSE2 or AVX2 (or, in the
+fixed-point build, AVX2 integer instructions). A scalar version is used when
+none of these is available.
+*/
+#ifndef LUNAR_LANDER_LANDERBATCH_H
+#define LUNAR_LANDER_LANDERBATCH_H
+
+#include <SDL2/SDL.h>
+
+#include <stdbool.h>
+
+#include "GameObjects.h"
+
+/**
+@def BATCH_LANES
+@brief The number of landers stepped together by the widest kernel. The arrays
+of a LanderBatch are padded to a multiple of this.
+*/
+#define BATCH_LANES 8
+
+/**
+@typedef LanderBatch
+@brief A struct holding a batch of landers as parallel arrays.
+@details Entry i of each array belongs to the i-th lander. All landers in a
+batch share the same length. Landers whose landingType is not LANDING_NONE have
+touched down and are no longer moved.
+*/
+typedef struct LanderBatch
+{
+	/* The number of landers in the batch, and the padded size of each array. */
+	Uint32 count;
+	Uint32 capacity;
+
+	/* The absolute (real) positions of each lander's bottom-left corner. */
+	Real *realX;
+	Real *realY;
+
+	/* The horizontal and vertical velocities of each lander. */
+	Real *horVelocity;
+	Real *vertVelocity;
+
+	/* How each lander touched down (LANDING_NONE while still flying). */
+	Sint32 *landingType;
+
+	/* The length (left to right) of every lander in the batch. */
+	Uint16 length;
+
+	/* The height of the highest column of terrain. Landers above it can't
+	   be colliding with anything. */
+	Uint16 terrainTop;
+} LanderBatch;
+
+
+/**
+@fn createLanderBatch
+@brief Allocates the arrays of a LanderBatch.
+@param batch Pointer to the LanderBatch to fill.
+@param count The number of landers in the batch.
+@param terrain The terrain the landers will fly over.
+@param levelWidth The width of the level (in pixels).
+@return True if the arrays were allocated, false otherwise.
+*/
+bool createLanderBatch (LanderBatch *batch, Uint32 count, Terrain *terrain,
+						Uint32 levelWidth);
+
+/**
+@fn freeLanderBatch
+@brief Frees the arrays of a LanderBatch.
+@param batch Pointer to the LanderBatch to free.
+*/
+void freeLanderBatch (LanderBatch *batch);
+
+/**
+@fn setBatchLander
+@brief Places one lander of a batch and gets it flying.
+@param batch Pointer to the LanderBatch.
+@param index The index of the lander to place.
+@param lander The Lander whose position and velocities are copied.
+*/
+void setBatchLander (LanderBatch *batch, Uint32 index, Lander lander);
+
+/**
+@fn applyBatchThrust
+@brief Fires one of a batched lander's thrusters for one tick.
+@param batch Pointer to the LanderBatch.
+@param index The index of the lander to thrust.
+@param direction The thruster to fire (THRUST_UP, THRUST_LEFT or THRUST_RIGHT).
+*/
+void applyBatchThrust (LanderBatch *batch, Uint32 index, int direction);
+
+/**
+@fn stepLanderBatch
+@brief Applies one tick of game time to every lander still flying in a batch,
+then checks each of them for a collision with the terrain.
+@param batch Pointer to the LanderBatch to step.
+@param terrain The terrain the landers are flying over.
+@param levelWidth The width of the level (in pixels).
+@return The number of landers that touched down during this tick.
+*/
+Uint32 stepLanderBatch (LanderBatch *batch, Terrain *terrain,
+						Uint32 levelWidth);
+
+#endif /* LUNAR_LANDER_LANDERBATCH_H */
@@ -0,0 +1,378 @@
+/**
+@file LanderEnv.c
+@author Rob Thomas
+@brief Contains a C interface for driving many simulated games at once from a
+controller, such as a reinforcement-learning trainer.
+@details A LanderEnv holds K independent games (environments) flying over the
+same level. The caller resets them with a seed, then repeatedly passes one
+action per environment to stepLanderEnv. Observations, rewards and done flags
+are written into contiguous buffers owned by the caller, and nothing is
+allocated after createLanderEnv, so the interface can be called directly from
+other languages through a foreign function interface.
+*/
+
+#include <SDL2/SDL.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <math.h>
+
+#include "GameInitialization.h"
+#include "TerrainBuilding.h"
+#include "LevelFile.h"
+#include "LevelPack.h"
+#include "TerrainGenerator.h"
+#include "Simulation.h"
+#include "LanderEnv.h"
+#include "GameObjects.h"
+
+
+/**
+@fn nextEnvRandom
+@brief Advances an environment's xorshift32 generator and returns its next
+value.
+@param seed Pointer to the generator's state. Must not be 0.
+@return The next pseudo-random number.
+*/
+static Uint32 nextEnvRandom (Uint32 *seed)
+{
+	*seed ^= *seed << 13;
+	*seed ^= *seed >> 17;
+	*seed ^= *seed << 5;
+
+	return *seed;
+}
+
+/**
+@fn spawnLander
+@brief Starts a new episode in one environment, with the lander somewhere along
+the level and drifting slightly.
+@param env Pointer to the LanderEnv.
+@param i The index of the environment.
+*/
+static void spawnLander (LanderEnv *env, Uint32 i)
+{
+	GameState *state = &env->states[i];
+	Lander *lander = &env->landers[i];
+
+	softReset(state);
+	state->fuel = FUEL_START;
+	state->score = 0;
+	state->ticks = 0;
+	env->steps[i] = 0;
+
+	lander->realX = TO_REAL(nextEnvRandom(&env->seeds[i]) % env->levelWidth);
+	lander->X = REAL_TO_INT(lander->realX);
+	lander->horVelocity = REAL_RATIO((int)(nextEnvRandom(&env->seeds[i]) % 201)
+									 - 100, 100);
+}
+
+/**
+@fn observe
+@brief Writes one environment's observation.
+@param env Pointer to the LanderEnv.
+@param i The index of the environment.
+@param observation Buffer of LANDER_ENV_OBSERVATION_SIZE floats to write to.
+*/
+static void observe (LanderEnv *env, Uint32 i, float *observation)
+{
+	GameState *state = &env->states[i];
+	Lander *lander = &env->landers[i];
+	float middleX = FROM_REAL(lander->realX) + lander->length / 2.0f;
+	float toStrip = 0.0f;
+
+	/* Find the nearest scoring strip, measuring around the wrap. */
+	for (Uint32 strip = 0; strip < env->numStrips; strip++)
+	{
+		float offset = env->stripCenters[strip] - middleX;
+
+		if (offset > env->levelWidth / 2.0f)
+		{
+			offset -= env->levelWidth;
+		}
+		else if (offset < env->levelWidth / -2.0f)
+		{
+			offset += env->levelWidth;
+		}
+
+		if (strip == 0 || fabsf(offset) < fabsf(toStrip))
+		{
+			toStrip = offset;
+		}
+	}
+
+	observation[0] = FROM_REAL(lander->realX) / env->levelWidth;
+	observation[1] = FROM_REAL(lander->realY) / env->levelHeight;
+	observation[2] = FROM_REAL(lander->horVelocity);
+	observation[3] = FROM_REAL(lander->vertVelocity);
+	observation[4] = (float)(state->fuel) / FUEL_START;
+	observation[5] = (float)(getAltitude(*state)) / env->levelHeight;
+	observation[6] = toStrip / env->levelWidth;
+}
+
+/**
+@fn createLanderEnv
+@brief Loads a level and creates a set of environments flying over it.
+@param terrainFile The name of the terrain file to load.
+@param count The number of environments to create.
+@return Pointer to the new LanderEnv, or NULL if the terrain file couldn't be
+opened or parsed or memory couldn't be allocated.
+*/
+LanderEnv *createLanderEnv (const char *terrainFile, Uint32 count)
+{
+	LanderEnv *env;
+
+	/*** Check the file can be used, since the terrain builder exits if not. ***/
+	if (isPackedLevel((char*)terrainFile))
+	{
+		if (!checkPackedLevel((char*)terrainFile))
+		{
+			return NULL;
+		}
+	}
+	else if (isLevelFile((char*)terrainFile))
+	{
+		if (!checkLevelFile((char*)terrainFile))
+		{
+			return NULL;
+		}
+	}
+	else if (!isGeneratedLevel((char*)terrainFile))
+	{
+		Terrain scratch;
+		ParseError error;
+		Uint32 levelWidth = LEVEL_WIDTH;
+
+		if (!parseVertexList((char*)terrainFile, &scratch, &levelWidth, &error))
+		{
+			return NULL;
+		}
+		freeVertexArray(&scratch);
+	}
+
+	/*** Allocate the environment and its per-game arrays. ***/
+	if (count == 0 || !( env = (LanderEnv*)calloc(1, sizeof(LanderEnv)) ))
+	{
+		return NULL;
+	}
+
+	env->count = count;
+	env->states = (GameState*)malloc(count * sizeof(GameState));
+	env->landers = (Lander*)malloc(count * sizeof(Lander));
+	env->seeds = (Uint32*)malloc(count * sizeof(Uint32));
+	env->steps = (Uint32*)malloc(count * sizeof(Uint32));
+
+	if (env->states == NULL || env->landers == NULL || env->seeds == NULL ||
+		env->steps == NULL)
+	{
+		free(env->states);
+		free(env->landers);
+		free(env->seeds);
+		free(env->steps);
+		free(env);
+		return NULL;
+	}
+
+	/*** Build the level through the first game, then share it. ***/
+	env->terrain.vertices = NULL;
+	env->terrain.numVertices = 0;
+	env->terrain.heightMap = NULL;
+
+	initializeSimulation(&env->states[0], &env->landers[0], &env->terrain,
+						 (char*)terrainFile);
+	env->levelWidth = env->states[0].levelWidth;
+	env->levelHeight = env->states[0].levelHeight;
+
+	/*** Every game flies over the same chunks, so a generated level is kept
+	     as the loop first generated rather than following one lander. ***/
+	stopTerrainStream(&env->terrain);
+
+	for (Uint32 i = 1; i < count; i++)
+	{
+		env->states[i] = env->states[0];
+		env->landers[i] = env->landers[0];
+		env->states[i].lander = &env->landers[i];
+	}
+
+	/*** Note the middle of every strip worth landing on. ***/
+	Flat *flats = env->terrain.flats;
+
+	for (Uint32 i = 0; i < env->terrain.numFlats; i++)
+	{
+		if (flats[i].scoreModifier > 0)
+		{
+			env->numStrips++;
+		}
+	}
+
+	env->stripCenters = (float*)malloc((env->numStrips + 1) * sizeof(float));
+	if (env->stripCenters == NULL)
+	{
+		freeLanderEnv(env);
+		return NULL;
+	}
+
+	env->numStrips = 0;
+	for (Uint32 i = 0; i < env->terrain.numFlats; i++)
+	{
+		if (flats[i].scoreModifier > 0)
+		{
+			env->stripCenters[env->numStrips++] = flats[i].X +
+												  flats[i].length / 2.0f;
+		}
+	}
+
+	resetLanderEnv(env, 1, NULL);
+
+	return env;
+}
+
+/**
+@fn freeLanderEnv
+@brief Frees a LanderEnv and the level it loaded.
+@param env Pointer to the LanderEnv to free.
+*/
+void freeLanderEnv (LanderEnv *env)
+{
+	if (env == NULL)
+	{
+		return;
+	}
+
+	freeTerrain(&env->terrain);
+
+	free(env->stripCenters);
+	free(env->states);
+	free(env->landers);
+	free(env->seeds);
+	free(env->steps);
+	free(env);
+}
+
+/**
+@fn getLanderEnvCount
+@brief Returns the number of environments in a LanderEnv.
+@param env Pointer to the LanderEnv.
+@return The number of environments.
+*/
+Uint32 getLanderEnvCount (const LanderEnv *env)
+{
+	return env->count;
+}
+
+/**
+@fn resetLanderEnv
+@brief Starts a new episode in every environment. Each environment's random
+generator is seeded from the seed and its index, so the same seed always gives
+the same episodes.
+@param env Pointer to the LanderEnv.
+@param seed The seed for the starting positions and drifts.
+@param observations Buffer of count * LANDER_ENV_OBSERVATION_SIZE floats to
+write the first observations to.
+*/
+void resetLanderEnv (LanderEnv *env, Uint32 seed, float *observations)
+{
+	for (Uint32 i = 0; i < env->count; i++)
+	{
+		/* Mix the index into the seed, and keep xorshift's state nonzero. */
+		env->seeds[i] = (seed ^ (i * 2654435761u)) | 1;
+
+		spawnLander(env, i);
+		if (observations != NULL)
+		{
+			observe(env, i, &observations[i * LANDER_ENV_OBSERVATION_SIZE]);
+		}
+	}
+}
+
+/**
+@fn stepLanderEnv
+@brief Steps every environment by one base tick.
+@param env Pointer to the LanderEnv.
+@param actions Array of count actions (LANDER_ENV_THRUST_* bits).
+@param observations Buffer of count * LANDER_ENV_OBSERVATION_SIZE floats to
+write the new observations to.
+@param rewards Buffer of count floats to write each environment's reward to:
+the score gained by a landing, minus the fuel lost by a crash.
+@param dones Buffer of count bytes, set to 1 for each environment whose episode
+ended this step (and which has been respawned) and 0 for the others.
+*/
+void stepLanderEnv (LanderEnv *env, const Uint8 *actions, float *observations,
+					float *rewards, Uint8 *dones)
+{
+	for (Uint32 i = 0; i < env->count; i++)
+	{
+		GameState *state = &env->states[i];
+		int landingType = LANDING_NONE;
+
+		/*** Fire the chosen thrusters, as a held key would. ***/
+		if (actions[i] & LANDER_ENV_THRUST_UP)
+		{
+			applyThrust(state, THRUST_UP);
+		}
+		if (actions[i] & LANDER_ENV_THRUST_LEFT)
+		{
+			applyThrust(state, THRUST_LEFT);
+		}
+		if (actions[i] & LANDER_ENV_THRUST_RIGHT)
+		{
+			applyThrust(state, THRUST_RIGHT);
+		}
+
+		/*** Run the physics for one base tick, stopping at touchdown. ***/
+		rewards[i] = 0.0f;
+		for (int tick = 0; tick < PHYSICS_TICK_RATE / BASE_TICK_RATE; tick++)
+		{
+			simulateTick(state);
+
+			landingType = detectCollision(*state);
+			if (landingType != LANDING_NONE)
+			{
+				rewards[i] = (float)(resolveCollision(state, landingType));
+				break;
+			}
+		}
+
+		/*** Respawn the lander if its episode is over. ***/
+		env->steps[i]++;
+		dones[i] = (landingType != LANDING_NONE ||
+					env->steps[i] >= LANDER_ENV_MAX_STEPS);
+		if (dones[i])
+		{
+			spawnLander(env, i);
+		}
+
+		observe(env, i, &observations[i * LANDER_ENV_OBSERVATION_SIZE]);
+	}
+}
+
+/**
+@fn saveLanderEnv
+@brief Saves one environment's game, for instance before searching ahead from
+it.
+@param env Pointer to the LanderEnv.
+@param i The index of the environment.
+@param snapshot Pointer to the GameSnapshot to fill.
+*/
+void saveLanderEnv (const LanderEnv *env, Uint32 i, GameSnapshot *snapshot)
+{
+	saveSnapshot(env->states[i], snapshot);
+}
+
+/**
+@fn restoreLanderEnv
+@brief Rolls one environment's game back to a snapshot taken by saveLanderEnv.
+Any environment's snapshot may be restored into any other, since they all share
+the same level.
+@param env Pointer to the LanderEnv.
+@param i The index of the environment.
+@param snapshot Pointer to the GameSnapshot to restore.
+*/
+void restoreLanderEnv (LanderEnv *env, Uint32 i, const GameSnapshot *snapshot)
+{
+	restoreSnapshot(&env->states[i], snapshot);
+
+	/* Episodes are counted in steps, each a whole base tick long. */
+	env->steps[i] = snapshot->ticks / (PHYSICS_TICK_RATE / BASE_TICK_RATE);
+}
@@ -0,0 +1,161 @@
+/**
+@file LanderEnv.h
+@author Rob Thomas
+@brief Contains a C interface for driving many simulated games at once from a
+controller, such as a reinforcement-learning trainer.
+@details A LanderEnv holds K independent games (environments) flying over the
+same level. The caller resets them with a seed, then repeatedly passes one
+action per environment to stepLanderEnv. Observations, rewards and done flags
+are written into contiguous buffers owned by the caller, and nothing is
+allocated after createLanderEnv, so the interface can be called directly from
+other languages through a foreign function interface.
+
+Each step lasts one base tick (1/BASE_TICK_RATE seconds of game time): the
+action's thrusters fire once, as they would for a held key, and then the
+physics runs for PHYSICS_TICK_RATE / BASE_TICK_RATE ticks. An environment whose
+episode ends is respawned straight away, so the observation written for it is
+the first observation of its next episode.
+*/
+#ifndef LUNAR_LANDER_LANDERENV_H
+#define LUNAR_LANDER_LANDERENV_H
+
+#include <SDL2/SDL.h>
+
+#include "Simulation.h"
+#include "GameObjects.h"
+
+/**
+@def LANDER_ENV_API
+@brief Marks a function exported by libLanderEnv.so. The library is built with
+-fvisibility=hidden, so the simulation's own functions (min, max and the rest)
+can't clash with those of the process loading it.
+*/
+#define LANDER_ENV_API __attribute__((visibility("default")))
+
+/**
+@def LANDER_ENV_OBSERVATION_SIZE
+@brief The number of floats in one environment's observation. In order, they
+are: the lander's X position as a fraction of the level width, its Y position
+as a fraction of the level height, its horizontal velocity, its vertical
+velocity, its fuel as a fraction of FUEL_START, its altitude as a fraction of
+the level height, and the signed horizontal distance from the lander to the
+middle of the nearest scoring landing strip as a fraction of the level width.
+*/
+#define LANDER_ENV_OBSERVATION_SIZE 7
+
+/* Action bits. An action is any combination of these ORed together. */
+#define LANDER_ENV_THRUST_UP 0x01
+#define LANDER_ENV_THRUST_LEFT 0x02
+#define LANDER_ENV_THRUST_RIGHT 0x04
+
+/**
+@def LANDER_ENV_MAX_STEPS
+@brief The number of steps (two minutes of game time) after which an episode
+that hasn't touched down is ended.
+*/
+#define LANDER_ENV_MAX_STEPS (BASE_TICK_RATE * 120)
+
+/**
+@typedef LanderEnv
+@brief A set of games flown side by side over one level.
+*/
+typedef struct LanderEnv
+{
+	/* The number of environments. */
+	Uint32 count;
+
+	/* The level shared (read only) by every environment. */
+	Terrain terrain;
+	Uint32 levelWidth;
+	Uint16 levelHeight;
+
+	/* The middles of the landing strips worth any score. */
+	float *stripCenters;
+	Uint32 numStrips;
+
+	/* The game, lander, random generator and step count of each environment. */
+	GameState *states;
+	Lander *landers;
+	Uint32 *seeds;
+	Uint32 *steps;
+} LanderEnv;
+
+/**
+@fn createLanderEnv
+@brief Loads a level and creates a set of environments flying over it.
+@param terrainFile The name of the terrain file to load.
+@param count The number of environments to create.
+@return Pointer to the new LanderEnv, or NULL if the terrain file couldn't be
+opened or parsed or memory couldn't be allocated.
+*/
+LANDER_ENV_API LanderEnv *createLanderEnv (const char *terrainFile,
+										   Uint32 count);
+
+/**
+@fn freeLanderEnv
+@brief Frees a LanderEnv and the level it loaded.
+@param env Pointer to the LanderEnv to free.
+*/
+LANDER_ENV_API void freeLanderEnv (LanderEnv *env);
+
+/**
+@fn getLanderEnvCount
+@brief Returns the number of environments in a LanderEnv.
+@param env Pointer to the LanderEnv.
+@return The number of environments.
+*/
+LANDER_ENV_API Uint32 getLanderEnvCount (const LanderEnv *env);
+
+/**
+@fn resetLanderEnv
+@brief Starts a new episode in every environment. Each environment's random
+generator is seeded from the seed and its index, so the same seed always gives
+the same episodes.
+@param env Pointer to the LanderEnv.
+@param seed The seed for the starting positions and drifts.
+@param observations Buffer of count * LANDER_ENV_OBSERVATION_SIZE floats to
+write the first observations to.
+*/
+LANDER_ENV_API void resetLanderEnv (LanderEnv *env, Uint32 seed,
+									float *observations);
+
+/**
+@fn stepLanderEnv
+@brief Steps every environment by one base tick.
+@param env Pointer to the LanderEnv.
+@param actions Array of count actions (LANDER_ENV_THRUST_* bits).
+@param observations Buffer of count * LANDER_ENV_OBSERVATION_SIZE floats to
+write the new observations to.
+@param rewards Buffer of count floats to write each environment's reward to:
+the score gained by a landing, minus the fuel lost by a crash.
+@param dones Buffer of count bytes, set to 1 for each environment whose episode
+ended this step (and which has been respawned) and 0 for the others.
+*/
+LANDER_ENV_API void stepLanderEnv (LanderEnv *env, const Uint8 *actions,
+								   float *observations, float *rewards,
+								   Uint8 *dones);
+
+/**
+@fn saveLanderEnv
+@brief Saves one environment's game, for instance before searching ahead from
+it.
+@param env Pointer to the LanderEnv.
+@param i The index of the environment.
+@param snapshot Pointer to the GameSnapshot to fill.
+*/
+LANDER_ENV_API void saveLanderEnv (const LanderEnv *env, Uint32 i,
+								   GameSnapshot *snapshot);
+
+/**
+@fn restoreLanderEnv
+@brief Rolls one environment's game back to a snapshot taken by saveLanderEnv.
+Any environment's snapshot may be restored into any other, since they all share
+the same level.
+@param env Pointer to the LanderEnv.
+@param i The index of the environment.
+@param snapshot Pointer to the GameSnapshot to restore.
+*/
+LANDER_ENV_API void restoreLanderEnv (LanderEnv *env, Uint32 i,
+									  const GameSnapshot *snapshot);
+
+#endif /* LUNAR_LANDER_LANDERENV_H */
@@ -0,0 +1,65 @@
+/**
+@file LevelCompiler.c
+@author Rob Thomas
+@brief Compiles a text file of vertices into a binary level file.
+@details This file contains the main function of LunarLanderLevel. It builds a
+level from its text file in the usual way, then writes the Vertex array, height
+map, height index and landing strips to a level file (see LevelFile.h), which
+the game and the other tools load in place of the text file.
+
+Usage: LunarLanderLevel terrainFile levelFile
+*/
+
+#include <SDL2/SDL.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "GameInitialization.h"
+#include "TerrainBuilding.h"
+#include "Simulation.h"
+#include "LevelFile.h"
+#include "GameObjects.h"
+
+
+/**
+@fn main
+@brief The main function for LunarLanderLevel.
+*/
+int main(int argc, char *argv[])
+{
+	GameState state;
+	Lander lander;
+	Terrain terrain;
+
+	/*** Read the command line. ***/
+	if (argc != 3)
+	{
+		fprintf(stderr, "Usage: %s terrainFile levelFile\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	/*** Build the terrain. ***/
+	terrain.vertices = NULL;
+	terrain.numVertices = 0;
+	terrain.heightMap = NULL;
+
+	initializeSimulation(&state, &lander, &terrain, argv[1]);
+
+	/*** Write it out. ***/
+	if (!writeLevelFile(argv[2], &state))
+	{
+		fprintf(stderr, "Problem encountered writing level file.\n"
+				"fileName: %s\n", argv[2]);
+		freeTerrain(&terrain);
+		return EXIT_FOPEN_FAIL;
+	}
+
+	printf("%s: %u columns, %u vertices\n", argv[2], state.levelWidth,
+		   terrain.numVertices);
+
+	freeTerrain(&terrain);
+
+	return EXIT_SUCCESS;
+}
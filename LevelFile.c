@@ -0,0 +1,358 @@
+/**
+@file LevelFile.c
+@author Rob Thomas
+@brief Contains functions for compiling a level into a binary level file and
+loading it back in place.
+@details The level file is mapped read only, so the terrain it holds must not
+be changed while it is loaded.
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <SDL2/SDL.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "GameObjects.h"
+#include "GameInitialization.h"
+#include "TerrainBuilding.h"
+
+#include "LevelFile.h"
+
+
+/* The first four bytes of every level file. */
+static const char levelMagic[4] = {'L', 'L', 'V', 'L'};
+
+/**
+@fn alignSection
+@brief Rounds a section's offset up to the next multiple of 8 bytes.
+@param offset The first free offset in the file.
+@return The offset to start the section at.
+*/
+static Uint64 alignSection (Uint64 offset)
+{
+	return (offset + 7) & ~(Uint64)(7);
+}
+
+/**
+@fn writeSection
+@brief Pads a level file with zeros up to a section's offset, then writes the
+section.
+@param file The level file being written.
+@param position Pointer to the number of bytes written so far.
+@param offset The offset of the section.
+@param data The section's contents.
+@param size The size of the section (in bytes).
+@return True if the section was written, false otherwise.
+*/
+static bool writeSection (FILE *file, Uint64 *position, Uint64 offset,
+						  const void *data, size_t size)
+{
+	static const char zeros[8] = {0};
+
+	if (fwrite(zeros, 1, offset - *position, file) != offset - *position ||
+		fwrite(data, 1, size, file) != size)
+	{
+		return false;
+	}
+
+	*position = offset + size;
+
+	return true;
+}
+
+/**
+@fn isLevelFile
+@brief Reports whether a file is a level file (rather than a text file of
+vertices).
+@param fileName The name of the file to check.
+@return True if the file begins with the level file magic bytes.
+*/
+bool isLevelFile (char *fileName)
+{
+	FILE *file;
+	char magic[4];
+	bool matched;
+
+	if (!( file = fopen(fileName, "rb") ))
+	{
+		return false;
+	}
+
+	matched = isLevelFileData(magic, fread(magic, 1, 4, file));
+	fclose(file);
+
+	return matched;
+}
+
+/**
+@fn isLevelFileData
+@brief Reports whether a file's contents, held in memory, are a level file.
+@param data The contents.
+@param size The size of the contents (in bytes).
+@return True if the contents begin with the level file magic bytes.
+*/
+bool isLevelFileData (const void *data, Uint64 size)
+{
+	return size >= 4 && memcmp(data, levelMagic, 4) == 0;
+}
+
+/**
+@fn writeLevelFile
+@brief Compiles a built level into a level file.
+@param fileName The name of the level file to write.
+@param state The GameState whose terrain has been built.
+@return True if the file was written, false otherwise.
+*/
+bool writeLevelFile (char *fileName, GameState *state)
+{
+	Terrain *terrain = state->terrain;
+	LevelFileHeader header;
+	FILE *file;
+
+	/*** Fill in the header, laying the sections out one after another. ***/
+	size_t verticesSize = terrain->numVertices * sizeof(Vertex);
+	size_t heightMapSize = state->levelWidth * sizeof(Uint16);
+	size_t heightIndexSize = getHeightIndexSize(state->levelWidth);
+	size_t flatsSize = terrain->numFlats * sizeof(Flat);
+	size_t flatTableSize = state->levelWidth * sizeof(Uint32);
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, levelMagic, 4);
+	header.version = LEVEL_FILE_VERSION;
+	header.byteOrder = LEVEL_FILE_BYTE_ORDER;
+	header.heightBlockSize = HEIGHT_BLOCK_SIZE;
+	header.levelWidth = state->levelWidth;
+	header.numVertices = terrain->numVertices;
+	header.numFlats = terrain->numFlats;
+
+	header.verticesOffset = alignSection(sizeof(header));
+	header.heightMapOffset = alignSection(header.verticesOffset + verticesSize);
+	header.heightIndexOffset = alignSection(header.heightMapOffset
+											+ heightMapSize);
+	header.flatsOffset = alignSection(header.heightIndexOffset
+									  + heightIndexSize);
+	header.flatTableOffset = alignSection(header.flatsOffset + flatsSize);
+	header.fileSize = header.flatTableOffset + flatTableSize;
+
+	/*** Write the header and each section. ***/
+	Uint64 position = 0;
+	bool written = false;
+
+	if (( file = fopen(fileName, "wb") ))
+	{
+		written = writeSection(file, &position, 0, &header, sizeof(header)) &&
+				  writeSection(file, &position, header.verticesOffset,
+							   terrain->vertices, verticesSize) &&
+				  writeSection(file, &position, header.heightMapOffset,
+							   terrain->heightMap, heightMapSize) &&
+				  writeSection(file, &position, header.heightIndexOffset,
+							   terrain->heightIndex.prefixMax,
+							   heightIndexSize) &&
+				  writeSection(file, &position, header.flatsOffset,
+							   terrain->flats, flatsSize) &&
+				  writeSection(file, &position, header.flatTableOffset,
+							   terrain->flatTable, flatTableSize);
+
+		if (fclose(file))
+		{
+			written = false;
+		}
+	}
+
+	return written;
+}
+
+/**
+@fn isSectionInFile
+@brief Checks that a section of a level file is aligned and inside the file.
+@param header The level file's header.
+@param offset The offset of the section.
+@param size The size of the section (in bytes).
+@return True if the section is valid, false otherwise.
+*/
+static bool isSectionInFile (LevelFileHeader *header, Uint64 offset,
+							 Uint64 size)
+{
+	return offset % 8 == 0 && offset >= sizeof(LevelFileHeader) &&
+		   offset <= header->fileSize && size <= header->fileSize - offset;
+}
+
+/**
+@fn placeLevelFile
+@brief Checks a level file held in memory and points a Terrain's Vertex array,
+height map, height index, Flat array and Flat table into it.
+@param data The level file's contents (8-byte aligned).
+@param size The size of the level file (in bytes).
+@param terrain Pointer to the Terrain to fill in. Left untouched if the level
+file isn't valid.
+@param levelWidth Buffer for the width of the level (in pixels).
+@return True if the level file is valid, false otherwise.
+*/
+bool placeLevelFile (void *data, Uint64 size, Terrain *terrain,
+					 Uint32 *levelWidth)
+{
+	/*** Check the header, and that every section is inside the file. ***/
+	LevelFileHeader *header = (LevelFileHeader*)(data);
+
+	if (size < sizeof(LevelFileHeader) || (uintptr_t)(data) % 8 != 0)
+	{
+		return false;
+	}
+
+	Uint64 width = header->levelWidth;
+
+	if (memcmp(header->magic, levelMagic, 4) != 0 ||
+		header->version != LEVEL_FILE_VERSION ||
+		header->byteOrder != LEVEL_FILE_BYTE_ORDER ||
+		header->heightBlockSize != HEIGHT_BLOCK_SIZE ||
+		header->fileSize != size ||
+		width == 0 || width > MAX_LEVEL_WIDTH || header->numVertices < 2 ||
+		!isSectionInFile(header, header->verticesOffset,
+						 header->numVertices * (Uint64)(sizeof(Vertex))) ||
+		!isSectionInFile(header, header->heightMapOffset,
+						 width * sizeof(Uint16)) ||
+		!isSectionInFile(header, header->heightIndexOffset,
+						 getHeightIndexSize(header->levelWidth)) ||
+		!isSectionInFile(header, header->flatsOffset,
+						 header->numFlats * (Uint64)(sizeof(Flat))) ||
+		!isSectionInFile(header, header->flatTableOffset,
+						 width * sizeof(Uint32)))
+	{
+		return false;
+	}
+
+	/*** Point the terrain into the file. ***/
+	Uint8 *base = (Uint8*)(data);
+
+	terrain->vertices = (Vertex*)(base + header->verticesOffset);
+	terrain->numVertices = header->numVertices;
+	terrain->heightMap = (Uint16*)(base + header->heightMapOffset);
+	placeHeightIndex(&terrain->heightIndex, base + header->heightIndexOffset,
+					 header->levelWidth);
+	terrain->flats = (Flat*)(base + header->flatsOffset);
+	terrain->numFlats = header->numFlats;
+	terrain->flatTable = (Uint32*)(base + header->flatTableOffset);
+	*levelWidth = header->levelWidth;
+
+	return true;
+}
+
+/**
+@fn mapLevelFile
+@brief Maps a level file into memory and points a Terrain's Vertex array,
+height map, height index, Flat array and Flat table into it. Exits if the file
+can't be opened or isn't a valid level file.
+@param fileName The name of the level file.
+@param terrain Pointer to the Terrain to fill in.
+@param levelWidth Buffer for the width of the level (in pixels).
+*/
+void mapLevelFile (char *fileName, Terrain *terrain, Uint32 *levelWidth)
+{
+	struct stat info;
+	int descriptor;
+	void *mapping;
+
+	/*** Map the whole file. ***/
+	if ((descriptor = open(fileName, O_RDONLY)) < 0)
+	{
+		fprintf(stderr, "Problem encountered opening file.\nfileName: %s\n",
+			    fileName);
+
+		exit(EXIT_FOPEN_FAIL);
+	}
+
+	if (fstat(descriptor, &info) != 0 ||
+		(size_t)(info.st_size) < sizeof(LevelFileHeader) ||
+		(mapping = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE,
+						descriptor, 0)) == MAP_FAILED)
+	{
+		close(descriptor);
+		fprintf(stderr, "Level file couldn't be mapped.\nfileName: %s\n",
+				fileName);
+
+		exit(EXIT_BADFILE_FAIL);
+	}
+	close(descriptor);
+
+	/*** Check the file and point the terrain into it. ***/
+	if (!placeLevelFile(mapping, (Uint64)(info.st_size), terrain, levelWidth))
+	{
+		munmap(mapping, info.st_size);
+		fprintf(stderr, "Not a version %d level file for this machine.\n"
+				"fileName: %s\n", LEVEL_FILE_VERSION, fileName);
+
+		exit(EXIT_BADFILE_FAIL);
+	}
+
+	terrain->mapping = mapping;
+	terrain->mappingSize = info.st_size;
+}
+
+/**
+@fn checkLevelFile
+@brief Reports whether a level file can be loaded by mapLevelFile, without
+exiting if it can't.
+@param fileName The name of the level file.
+@return True if the file can be mapped and is a valid level file.
+*/
+bool checkLevelFile (char *fileName)
+{
+	struct stat info;
+	int descriptor;
+	void *mapping;
+	Terrain scratch;
+	Uint32 levelWidth;
+	bool valid;
+
+	if ((descriptor = open(fileName, O_RDONLY)) < 0)
+	{
+		return false;
+	}
+
+	if (fstat(descriptor, &info) != 0 ||
+		(size_t)(info.st_size) < sizeof(LevelFileHeader) ||
+		(mapping = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE,
+						descriptor, 0)) == MAP_FAILED)
+	{
+		close(descriptor);
+		return false;
+	}
+	close(descriptor);
+
+	valid = placeLevelFile(mapping, (Uint64)(info.st_size), &scratch,
+						   &levelWidth);
+	munmap(mapping, info.st_size);
+
+	return valid;
+}
+
+/**
+@fn unmapLevelFile
+@brief Unmaps a Terrain's level file.
+@param terrain Pointer to the Terrain loaded by mapLevelFile (or read in place
+from a level pack, whose memory is left alone).
+*/
+void unmapLevelFile (Terrain *terrain)
+{
+	/* A level read in place from a level pack is unmapped with the pack. */
+	if (terrain->mappingSize > 0)
+	{
+		munmap(terrain->mapping, terrain->mappingSize);
+	}
+
+	terrain->mapping = NULL;
+	terrain->mappingSize = 0;
+	terrain->vertices = NULL;
+	terrain->numVertices = 0;
+	terrain->heightMap = NULL;
+	terrain->heightIndex.prefixMax = NULL;
+}
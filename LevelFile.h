@@ -0,0 +1,136 @@
+/**
+@file LevelFile.h
+@author Rob Thomas
+@brief Contains functions for compiling a level into a binary level file and
+loading it back in place.
+@details A level file holds everything the terrain builders work out from a
+text file of vertices: the Vertex array, the height map, the height index, the
+Flat array and the Flat table. Each is stored exactly as it is laid out in memory
+(in the byte order of the machine that compiled it), at an 8-byte aligned
+offset given in the header, so the game maps the file into memory and points
+the Terrain straight at it instead of reading or building anything. A large
+level therefore starts as quickly as a small one.
+*/
+#ifndef LUNAR_LANDER_LEVELFILE_H
+#define LUNAR_LANDER_LEVELFILE_H
+
+#include <SDL2/SDL.h>
+
+#include <stdbool.h>
+
+#include "GameObjects.h"
+
+/**
+@def LEVEL_FILE_VERSION
+@brief The version of the level file format written by this build.
+*/
+#define LEVEL_FILE_VERSION 3
+
+/**
+@def LEVEL_FILE_BYTE_ORDER
+@brief Written into every level file so that a file compiled on a machine with
+the other byte order is recognized and rejected.
+*/
+#define LEVEL_FILE_BYTE_ORDER 0x01020304
+
+/**
+@typedef LevelFileHeader
+@brief The header at the start of a level file.
+*/
+typedef struct LevelFileHeader
+{
+	/* "LLVL", the format version and LEVEL_FILE_BYTE_ORDER. */
+	char magic[4];
+	Uint32 version;
+	Uint32 byteOrder;
+
+	/* The HEIGHT_BLOCK_SIZE the height index was built with. */
+	Uint32 heightBlockSize;
+
+	/* The dimensions of the level and the number of Vertexes and Flats. */
+	Uint32 levelWidth;
+	Uint32 numVertices;
+	Uint32 numFlats;
+	Uint32 reserved;
+
+	/* Where each section starts, from the start of the file. */
+	Uint64 verticesOffset;
+	Uint64 heightMapOffset;
+	Uint64 heightIndexOffset;
+	Uint64 flatsOffset;
+	Uint64 flatTableOffset;
+
+	/* The size of the whole file. */
+	Uint64 fileSize;
+} LevelFileHeader;
+
+/**
+@fn isLevelFile
+@brief Reports whether a file is a level file (rather than a text file of
+vertices).
+@param fileName The name of the file to check.
+@return True if the file begins with the level file magic bytes.
+*/
+bool isLevelFile (char *fileName);
+
+/**
+@fn isLevelFileData
+@brief Reports whether a file's contents, held in memory, are a level file.
+@param data The contents.
+@param size The size of the contents (in bytes).
+@return True if the contents begin with the level file magic bytes.
+*/
+bool isLevelFileData (const void *data, Uint64 size);
+
+/**
+@fn writeLevelFile
+@brief Compiles a built level into a level file.
+@param fileName The name of the level file to write.
+@param state The GameState whose terrain has been built.
+@return True if the file was written, false otherwise.
+*/
+bool writeLevelFile (char *fileName, GameState *state);
+
+/**
+@fn placeLevelFile
+@brief Checks a level file held in memory and points a Terrain's Vertex array,
+height map, height index, Flat array and Flat table into it.
+@param data The level file's contents (8-byte aligned).
+@param size The size of the level file (in bytes).
+@param terrain Pointer to the Terrain to fill in. Left untouched if the level
+file isn't valid.
+@param levelWidth Buffer for the width of the level (in pixels).
+@return True if the level file is valid, false otherwise.
+*/
+bool placeLevelFile (void *data, Uint64 size, Terrain *terrain,
+					 Uint32 *levelWidth);
+
+/**
+@fn mapLevelFile
+@brief Maps a level file into memory and points a Terrain's Vertex array,
+height map, height index, Flat array and Flat table into it. Exits if the file
+can't be opened or isn't a valid level file.
+@param fileName The name of the level file.
+@param terrain Pointer to the Terrain to fill in.
+@param levelWidth Buffer for the width of the level (in pixels).
+*/
+void mapLevelFile (char *fileName, Terrain *terrain, Uint32 *levelWidth);
+
+/**
+@fn checkLevelFile
+@brief Reports whether a level file can be loaded by mapLevelFile, without
+exiting if it can't.
+@param fileName The name of the level file.
+@return True if the file can be mapped and is a valid level file.
+*/
+bool checkLevelFile (char *fileName);
+
+/**
+@fn unmapLevelFile
+@brief Unmaps a Terrain's level file.
+@param terrain Pointer to the Terrain loaded by mapLevelFile (or read in place
+from a level pack, whose memory is left alone).
+*/
+void unmapLevelFile (Terrain *terrain);
+
+#endif /* LUNAR_LANDER_LEVELFILE_H */
@@ -0,0 +1,587 @@
+/**
+@file LevelPack.c
+@author Rob Thomas
+@brief Contains functions for reading levels and their sounds from a single
+indexed pack file.
+@details The pack is mapped read only, so nothing read from it may be changed.
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <SDL2/SDL.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "GameObjects.h"
+#include "GameInitialization.h"
+#include "TerrainBuilding.h"
+#include "LevelFile.h"
+
+#include "LevelPack.h"
+
+
+/* The first four bytes of every level pack. */
+static const char packMagic[4] = {'L', 'P', 'A', 'K'};
+
+/**
+@fn alignEntry
+@brief Rounds an entry's offset up to the next multiple of 8 bytes.
+@param offset The first free offset in the pack.
+@return The offset to start the entry at.
+*/
+static Uint64 alignEntry (Uint64 offset)
+{
+	return (offset + 7) & ~(Uint64)(7);
+}
+
+/**
+@fn isLevelPack
+@brief Reports whether a file is a level pack.
+@param fileName The name of the file to check.
+@return True if the file begins with the level pack magic bytes.
+*/
+bool isLevelPack (const char *fileName)
+{
+	FILE *file;
+	char magic[4];
+	bool matched;
+
+	if (!( file = fopen(fileName, "rb") ))
+	{
+		return false;
+	}
+
+	matched = (fread(magic, 1, 4, file) == 4 &&
+			   memcmp(magic, packMagic, 4) == 0);
+	fclose(file);
+
+	return matched;
+}
+
+/**
+@fn splitLevelName
+@brief Splits a packed level's name into the pack's file name and the entry's
+name.
+@param fileName The name of the level.
+@param entryName Buffer for a pointer to the entry's name (inside fileName).
+@return The pack's file name (to be freed by the caller), or NULL if the level
+name has no PACKED_LEVEL_SEPARATOR or nothing either side of it.
+*/
+static char *splitLevelName (char *fileName, char **entryName)
+{
+	char *separator = strrchr(fileName, PACKED_LEVEL_SEPARATOR);
+
+	if (separator == NULL || separator == fileName || separator[1] == '\0')
+	{
+		return NULL;
+	}
+
+	*entryName = separator + 1;
+
+	return strndup(fileName, separator - fileName);
+}
+
+/**
+@fn isPackedLevel
+@brief Reports whether a level name asks for an entry of a level pack.
+@param fileName The name of the level.
+@return True if the name is the file name of a level pack, followed by
+PACKED_LEVEL_SEPARATOR and an entry's name.
+*/
+bool isPackedLevel (char *fileName)
+{
+	char *packName, *entryName;
+	bool packed;
+
+	if (!( packName = splitLevelName(fileName, &entryName) ))
+	{
+		return false;
+	}
+
+	packed = isLevelPack(packName);
+	free(packName);
+
+	return packed;
+}
+
+/**
+@fn isEntryInPack
+@brief Checks that an entry of a level pack is aligned, inside the pack and
+has a name.
+@param header The level pack's header.
+@param entry The entry to check.
+@return True if the entry is valid, false otherwise.
+*/
+static bool isEntryInPack (LevelPackHeader *header, const LevelPackEntry *entry)
+{
+	return entry->offset % 8 == 0 && entry->offset <= header->fileSize &&
+		   entry->size <= header->fileSize - entry->offset &&
+		   entry->name[0] != '\0' &&
+		   memchr(entry->name, '\0', PACK_ENTRY_NAME_LENGTH) != NULL;
+}
+
+/**
+@fn openLevelPack
+@brief Maps a level pack into memory and checks its table of contents.
+@param fileName The name of the level pack.
+@return Pointer to the new LevelPack (to be closed by closeLevelPack), or NULL
+if the file can't be opened or isn't a valid level pack.
+*/
+LevelPack *openLevelPack (const char *fileName)
+{
+	struct stat info;
+	int descriptor;
+	void *mapping;
+	LevelPack *pack;
+
+	/*** Map the whole file. ***/
+	if ((descriptor = open(fileName, O_RDONLY)) < 0)
+	{
+		return NULL;
+	}
+
+	if (fstat(descriptor, &info) != 0 ||
+		(size_t)(info.st_size) < sizeof(LevelPackHeader) ||
+		(mapping = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE,
+						descriptor, 0)) == MAP_FAILED)
+	{
+		close(descriptor);
+		return NULL;
+	}
+	close(descriptor);
+
+	/*** Check the header, and that the table of contents is inside the file
+	     and sorted, and that every entry is inside the file. ***/
+	LevelPackHeader *header = (LevelPackHeader*)(mapping);
+	const LevelPackEntry *entries =
+		(const LevelPackEntry*)((Uint8*)(mapping) + header->entriesOffset);
+	bool valid = memcmp(header->magic, packMagic, 4) == 0 &&
+				 header->version == LEVEL_PACK_VERSION &&
+				 header->byteOrder == LEVEL_PACK_BYTE_ORDER &&
+				 header->fileSize == (Uint64)(info.st_size) &&
+				 header->entriesOffset % 8 == 0 &&
+				 header->entriesOffset >= sizeof(LevelPackHeader) &&
+				 header->entriesOffset <= header->fileSize &&
+				 header->numEntries <= (header->fileSize
+										- header->entriesOffset)
+									   / sizeof(LevelPackEntry);
+
+	for (Uint32 i = 0; valid && i < header->numEntries; i++)
+	{
+		valid = isEntryInPack(header, &entries[i]) &&
+				(i == 0 || strcmp(entries[i - 1].name, entries[i].name) < 0);
+	}
+
+	if (!valid || !( pack = (LevelPack*)malloc(sizeof(LevelPack)) ))
+	{
+		munmap(mapping, info.st_size);
+		return NULL;
+	}
+
+	pack->mapping = mapping;
+	pack->mappingSize = info.st_size;
+	pack->entries = entries;
+	pack->numEntries = header->numEntries;
+
+	return pack;
+}
+
+/**
+@fn findPackEntry
+@brief Finds an entry in a level pack by name.
+@param pack Pointer to the LevelPack to search.
+@param name The name of the entry.
+@return Pointer to the entry, or NULL if the pack has no entry by that name.
+*/
+const LevelPackEntry *findPackEntry (LevelPack *pack, const char *name)
+{
+	Uint32 low = 0, high = pack->numEntries;
+
+	/*** Binary search the table of contents, which is sorted by name. ***/
+	while (low < high)
+	{
+		Uint32 middle = low + (high - low) / 2;
+		int order = strcmp(pack->entries[middle].name, name);
+
+		if (order == 0)
+		{
+			return &pack->entries[middle];
+		}
+		else if (order < 0)
+		{
+			low = middle + 1;
+		}
+		else
+		{
+			high = middle;
+		}
+	}
+
+	return NULL;
+}
+
+/**
+@fn getPackEntryData
+@brief Finds an entry's contents in a level pack.
+@param pack Pointer to the LevelPack holding the entry.
+@param entry Pointer to the entry.
+@return Pointer to the entry's contents (entry->size bytes), which stay valid
+until the pack is closed.
+*/
+void *getPackEntryData (LevelPack *pack, const LevelPackEntry *entry)
+{
+	return (Uint8*)(pack->mapping) + entry->offset;
+}
+
+/**
+@fn openPackedLevel
+@brief Opens the level pack named in a level's name and finds the level's
+entry in it.
+@param fileName The name of the level (see isPackedLevel).
+@param pack Buffer for the opened LevelPack (to be closed by closeLevelPack),
+set to NULL if the entry isn't found.
+@return Pointer to the entry, or NULL if the pack can't be opened or has no
+entry by that name.
+*/
+const LevelPackEntry *openPackedLevel (char *fileName, LevelPack **pack)
+{
+	const LevelPackEntry *entry = NULL;
+	char *packName, *entryName;
+
+	*pack = NULL;
+
+	if (!( packName = splitLevelName(fileName, &entryName) ))
+	{
+		return NULL;
+	}
+
+	if (( *pack = openLevelPack(packName) ) &&
+		!( entry = findPackEntry(*pack, entryName) ))
+	{
+		closeLevelPack(*pack);
+		*pack = NULL;
+	}
+
+	free(packName);
+
+	return entry;
+}
+
+/**
+@fn loadPackedLevel
+@brief Loads a level from an entry of a level pack. A level file entry is used
+in place, and a text entry is parsed and built as a text file would be. Exits
+if the pack, the entry or its level can't be read.
+@details The terrain keeps the pack open (in its pack member) until it is freed
+by freeTerrain, so the pack's sounds can still be loaded from it.
+@param fileName The name of the level (see isPackedLevel).
+@param state The GameState to load the level for. Its lander and terrain must
+be set.
+*/
+void loadPackedLevel (char *fileName, GameState *state)
+{
+	Terrain *terrain = state->terrain;
+	const LevelPackEntry *entry;
+	LevelPack *pack;
+
+	/*** Find the level's entry. ***/
+	if (!( entry = openPackedLevel(fileName, &pack) ))
+	{
+		fprintf(stderr, "Level pack has no such level.\nfileName: %s\n",
+				fileName);
+
+		exit(EXIT_FOPEN_FAIL);
+	}
+
+	void *data = getPackEntryData(pack, entry);
+
+	terrain->pack = pack;
+
+	/*** A level file is used in place. Its memory belongs to the pack, so
+	     the terrain doesn't unmap it. ***/
+	if (isLevelFileData(data, entry->size))
+	{
+		if (!placeLevelFile(data, entry->size, terrain, &state->levelWidth))
+		{
+			fprintf(stderr, "Not a version %d level file for this machine.\n"
+					"fileName: %s\n", LEVEL_FILE_VERSION, fileName);
+
+			exit(EXIT_BADFILE_FAIL);
+		}
+
+		terrain->mapping = data;
+		terrain->mappingSize = 0;
+
+		return;
+	}
+
+	/*** Anything else is a text file of vertices. It is parsed from a copy,
+	     which ends with the 0 byte the parser needs. ***/
+	ParseError error;
+	char *text;
+	bool parsed;
+
+	if (!( text = (char*)malloc(entry->size + 1) ))
+	{
+		fprintf(stderr, "Couldn't allocate the level's text.\n");
+		exit(EXIT_MAP_FAIL);
+	}
+
+	memcpy(text, data, entry->size);
+	text[entry->size] = '\0';
+
+	parsed = parseVertexText(text, entry->size, terrain, &state->levelWidth,
+							 &error);
+	free(text);
+
+	if (!parsed)
+	{
+		printParseError(fileName, &error);
+
+		exit(error.code == PARSE_EMPTY_FILE ? EXIT_EMPTYFILE_FAIL :
+			 error.code == PARSE_MEMORY_FAIL ? EXIT_MAP_FAIL :
+											   EXIT_BADFILE_FAIL);
+	}
+
+	rasterizeTerrain(terrain, state->levelWidth);
+	buildHeightIndex(terrain, state->levelWidth);
+	findLandingStrips(state);
+}
+
+/**
+@fn checkPackedLevel
+@brief Reports whether a level can be loaded from a level pack by
+loadPackedLevel, without exiting if it can't.
+@param fileName The name of the level (see isPackedLevel).
+@return True if the pack has an entry by that name, holding a valid level file
+or a text file of vertices that parses.
+*/
+bool checkPackedLevel (char *fileName)
+{
+	const LevelPackEntry *entry;
+	LevelPack *pack;
+	Terrain scratch;
+	Uint32 levelWidth = LEVEL_WIDTH;
+	bool valid;
+
+	if (!( entry = openPackedLevel(fileName, &pack) ))
+	{
+		return false;
+	}
+
+	void *data = getPackEntryData(pack, entry);
+
+	/*** A level file entry only needs its sections checked. ***/
+	if (isLevelFileData(data, entry->size))
+	{
+		valid = placeLevelFile(data, entry->size, &scratch, &levelWidth);
+		closeLevelPack(pack);
+
+		return valid;
+	}
+
+	/*** Anything else is parsed from a copy, as loadPackedLevel does. The
+	     entry is inside the pack, so its size is kept before the pack is
+	     closed. ***/
+	size_t size = entry->size;
+	ParseError error;
+	char *text;
+
+	if (!( text = (char*)malloc(size + 1) ))
+	{
+		closeLevelPack(pack);
+		return false;
+	}
+
+	memcpy(text, data, size);
+	text[size] = '\0';
+	closeLevelPack(pack);
+
+	scratch.vertices = NULL;
+	scratch.numVertices = 0;
+
+	if (( valid = parseVertexText(text, size, &scratch, &levelWidth,
+								  &error) ))
+	{
+		freeVertexArray(&scratch);
+	}
+	free(text);
+
+	return valid;
+}
+
+/**
+@fn compareEntries
+@brief Orders two level pack entries by name (for qsort).
+@param first Pointer to the first LevelPackEntry.
+@param second Pointer to the second LevelPackEntry.
+@return Less than, equal to or greater than 0 as the first entry's name sorts
+before, with or after the second's.
+*/
+static int compareEntries (const void *first, const void *second)
+{
+	return strcmp(((const LevelPackEntry*)(first))->name,
+				  ((const LevelPackEntry*)(second))->name);
+}
+
+/**
+@fn copyFile
+@brief Pads a level pack with zeros up to an entry's offset, then copies the
+file the entry was packed from into it.
+@param pack The level pack being written.
+@param position Pointer to the number of bytes written so far.
+@param entry The entry to copy.
+@param fileName The name of the file the entry was packed from.
+@return True if the whole file was copied, false otherwise.
+*/
+static bool copyFile (FILE *pack, Uint64 *position,
+					  const LevelPackEntry *entry, const char *fileName)
+{
+	static const char zeros[8] = {0};
+	char buffer[65536];
+	Uint64 copied = 0;
+	size_t read;
+	FILE *file;
+
+	if (fwrite(zeros, 1, entry->offset - *position, pack)
+		!= entry->offset - *position || !( file = fopen(fileName, "rb") ))
+	{
+		return false;
+	}
+
+	while (copied < entry->size &&
+		   (read = fread(buffer, 1, sizeof(buffer), file)) > 0 &&
+		   fwrite(buffer, 1, read, pack) == read)
+	{
+		copied += read;
+	}
+
+	fclose(file);
+	*position = entry->offset + copied;
+
+	return copied == entry->size;
+}
+
+/**
+@fn writeLevelPack
+@brief Packs a list of files into a level pack. Each entry is named after its
+file, without the file's directory.
+@param fileName The name of the level pack to write.
+@param fileNames The names of the files to pack.
+@param numFiles The number of files to pack.
+@return True if the pack was written, false otherwise (including if a file
+can't be read or two files have the same name).
+*/
+bool writeLevelPack (char *fileName, char **fileNames, int numFiles)
+{
+	LevelPackHeader header;
+	LevelPackEntry *entries;
+	struct stat info;
+	FILE *file;
+	bool written = false;
+
+	if (numFiles < 1 ||
+		!( entries = (LevelPackEntry*)calloc(numFiles,
+											 sizeof(LevelPackEntry)) ))
+	{
+		return false;
+	}
+
+	/*** Fill in the header, laying the table of contents and then each file
+	     out one after another. ***/
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, packMagic, 4);
+	header.version = LEVEL_PACK_VERSION;
+	header.byteOrder = LEVEL_PACK_BYTE_ORDER;
+	header.numEntries = numFiles;
+	header.entriesOffset = alignEntry(sizeof(header));
+	header.fileSize = header.entriesOffset
+					  + numFiles * (Uint64)(sizeof(LevelPackEntry));
+
+	for (int i = 0; i < numFiles; i++)
+	{
+		char *name = strrchr(fileNames[i], '/');
+
+		name = (name == NULL) ? fileNames[i] : name + 1;
+
+		/* The name must fit, and can't hold the separator of packed level
+		   names. */
+		if (stat(fileNames[i], &info) != 0 || !S_ISREG(info.st_mode) ||
+			name[0] == '\0' || strlen(name) >= PACK_ENTRY_NAME_LENGTH ||
+			strchr(name, PACKED_LEVEL_SEPARATOR) != NULL)
+		{
+			fprintf(stderr, "Can't pack file.\nfileName: %s\n", fileNames[i]);
+			free(entries);
+			return false;
+		}
+
+		strcpy(entries[i].name, name);
+		entries[i].offset = alignEntry(header.fileSize);
+		entries[i].size = info.st_size;
+		header.fileSize = entries[i].offset + entries[i].size;
+	}
+
+	/*** Copy the files in the order given, then sort the table of contents
+	     so entries can be found by a binary search. ***/
+	if (( file = fopen(fileName, "wb") ))
+	{
+		Uint64 position = header.entriesOffset
+						  + numFiles * (Uint64)(sizeof(LevelPackEntry));
+
+		written = fwrite(&header, sizeof(header), 1, file) == 1 &&
+				  fseek(file, (long)(position), SEEK_SET) == 0;
+
+		for (int i = 0; written && i < numFiles; i++)
+		{
+			written = copyFile(file, &position, &entries[i], fileNames[i]);
+		}
+
+		qsort(entries, numFiles, sizeof(LevelPackEntry), compareEntries);
+
+		for (int i = 1; written && i < numFiles; i++)
+		{
+			if (strcmp(entries[i - 1].name, entries[i].name) == 0)
+			{
+				fprintf(stderr, "Two files are named %s.\n", entries[i].name);
+				written = false;
+			}
+		}
+
+		written = written &&
+				  fseek(file, (long)(header.entriesOffset), SEEK_SET) == 0 &&
+				  fwrite(entries, sizeof(LevelPackEntry), numFiles, file)
+				  == (size_t)(numFiles);
+
+		if (fclose(file))
+		{
+			written = false;
+		}
+	}
+
+	free(entries);
+
+	return written;
+}
+
+/**
+@fn closeLevelPack
+@brief Unmaps a level pack and frees it.
+@param pack Pointer to the LevelPack to close (may be NULL).
+*/
+void closeLevelPack (LevelPack *pack)
+{
+	if (pack == NULL)
+	{
+		return;
+	}
+
+	munmap(pack->mapping, pack->mappingSize);
+	free(pack);
+}
@@ -0,0 +1,204 @@
+/**
+@file LevelPack.h
+@author Rob Thomas
+@brief Contains functions for reading levels and their sounds from a single
+indexed pack file.
+@details A level pack holds any number of entries (text files of vertices,
+level files and sound files), each stored exactly as the loose file it was
+packed from. A table of contents, sorted by name, gives each entry's offset
+and size. The whole pack is mapped into memory when it is opened, and nothing
+in it is read until it is needed: finding an entry is a binary search of the
+table, a level file entry is used in place (see LevelFile.h), a text entry is
+only parsed when its level is loaded, and a sound is only decoded the first
+time it is played.
+
+A level in a pack is named by the pack's file name and the entry's name,
+separated by PACKED_LEVEL_SEPARATOR (for example "levels.llp:terrain2.txt").
+*/
+
+#ifndef LUNAR_LANDER_LEVELPACK_H
+#define LUNAR_LANDER_LEVELPACK_H
+
+#include <SDL2/SDL.h>
+
+#include <stdbool.h>
+
+#include "GameObjects.h"
+
+/**
+@def LEVEL_PACK_VERSION
+@brief The version of the level pack format written by this build.
+*/
+#define LEVEL_PACK_VERSION 1
+
+/**
+@def LEVEL_PACK_BYTE_ORDER
+@brief Written into every level pack so that a pack written on a machine with
+the other byte order is recognized and rejected.
+*/
+#define LEVEL_PACK_BYTE_ORDER 0x01020304
+
+/**
+@def PACK_ENTRY_NAME_LENGTH
+@brief The longest name an entry can have, including its terminating 0 byte.
+*/
+#define PACK_ENTRY_NAME_LENGTH 56
+
+/**
+@def PACKED_LEVEL_SEPARATOR
+@brief Separates a pack's file name from an entry's name in a level's name.
+*/
+#define PACKED_LEVEL_SEPARATOR ':'
+
+/**
+@typedef LevelPackHeader
+@brief The header at the start of a level pack.
+*/
+typedef struct LevelPackHeader
+{
+	/* "LPAK", the format version and LEVEL_PACK_BYTE_ORDER. */
+	char magic[4];
+	Uint32 version;
+	Uint32 byteOrder;
+
+	/* The number of entries in the table of contents. */
+	Uint32 numEntries;
+
+	/* Where the table of contents starts, from the start of the pack. */
+	Uint64 entriesOffset;
+
+	/* The size of the whole pack. */
+	Uint64 fileSize;
+} LevelPackHeader;
+
+/**
+@typedef LevelPackEntry
+@brief An entry in a level pack's table of contents.
+*/
+typedef struct LevelPackEntry
+{
+	/* The name of the file the entry was packed from, without its directory,
+	   padded with 0 bytes. */
+	char name[PACK_ENTRY_NAME_LENGTH];
+
+	/* Where the entry's contents start (8-byte aligned, so a level file can be
+	   used in place), from the start of the pack, and their size. */
+	Uint64 offset;
+	Uint64 size;
+} LevelPackEntry;
+
+/**
+@typedef LevelPack
+@brief A level pack mapped into memory.
+*/
+typedef struct LevelPack
+{
+	/* The whole pack. */
+	void *mapping;
+	size_t mappingSize;
+
+	/* The table of contents, sorted by name, inside the mapping. */
+	const LevelPackEntry *entries;
+	Uint32 numEntries;
+} LevelPack;
+
+/**
+@fn isLevelPack
+@brief Reports whether a file is a level pack.
+@param fileName The name of the file to check.
+@return True if the file begins with the level pack magic bytes.
+*/
+bool isLevelPack (const char *fileName);
+
+/**
+@fn isPackedLevel
+@brief Reports whether a level name asks for an entry of a level pack.
+@param fileName The name of the level.
+@return True if the name is the file name of a level pack, followed by
+PACKED_LEVEL_SEPARATOR and an entry's name.
+*/
+bool isPackedLevel (char *fileName);
+
+/**
+@fn openLevelPack
+@brief Maps a level pack into memory and checks its table of contents.
+@param fileName The name of the level pack.
+@return Pointer to the new LevelPack (to be closed by closeLevelPack), or NULL
+if the file can't be opened or isn't a valid level pack.
+*/
+LevelPack *openLevelPack (const char *fileName);
+
+/**
+@fn openPackedLevel
+@brief Opens the level pack named in a level's name and finds the level's
+entry in it.
+@param fileName The name of the level (see isPackedLevel).
+@param pack Buffer for the opened LevelPack (to be closed by closeLevelPack),
+set to NULL if the entry isn't found.
+@return Pointer to the entry, or NULL if the pack can't be opened or has no
+entry by that name.
+*/
+const LevelPackEntry *openPackedLevel (char *fileName, LevelPack **pack);
+
+/**
+@fn findPackEntry
+@brief Finds an entry in a level pack by name.
+@param pack Pointer to the LevelPack to search.
+@param name The name of the entry.
+@return Pointer to the entry, or NULL if the pack has no entry by that name.
+*/
+const LevelPackEntry *findPackEntry (LevelPack *pack, const char *name);
+
+/**
+@fn getPackEntryData
+@brief Finds an entry's contents in a level pack.
+@param pack Pointer to the LevelPack holding the entry.
+@param entry Pointer to the entry.
+@return Pointer to the entry's contents (entry->size bytes), which stay valid
+until the pack is closed.
+*/
+void *getPackEntryData (LevelPack *pack, const LevelPackEntry *entry);
+
+/**
+@fn loadPackedLevel
+@brief Loads a level from an entry of a level pack. A level file entry is used
+in place, and a text entry is parsed and built as a text file would be. Exits
+if the pack, the entry or its level can't be read.
+@details The terrain keeps the pack open (in its pack member) until it is freed
+by freeTerrain, so the pack's sounds can still be loaded from it.
+@param fileName The name of the level (see isPackedLevel).
+@param state The GameState to load the level for. Its lander and terrain must
+be set.
+*/
+void loadPackedLevel (char *fileName, GameState *state);
+
+/**
+@fn checkPackedLevel
+@brief Reports whether a level can be loaded from a level pack by
+loadPackedLevel, without exiting if it can't.
+@param fileName The name of the level (see isPackedLevel).
+@return True if the pack has an entry by that name, holding a valid level file
+or a text file of vertices that parses.
+*/
+bool checkPackedLevel (char *fileName);
+
+/**
+@fn writeLevelPack
+@brief Packs a list of files into a level pack. Each entry is named after its
+file, without the file's directory.
+@param fileName The name of the level pack to write.
+@param fileNames The names of the files to pack.
+@param numFiles The number of files to pack.
+@return True if the pack was written, false otherwise (including if a file
+can't be read or two files have the same name).
+*/
+bool writeLevelPack (char *fileName, char **fileNames, int numFiles);
+
+/**
+@fn closeLevelPack
+@brief Unmaps a level pack and frees it.
+@param pack Pointer to the LevelPack to close (may be NULL).
+*/
+void closeLevelPack (LevelPack *pack);
+
+#endif /* LUNAR_LANDER_LEVELPACK_H */
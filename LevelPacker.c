@@ -0,0 +1,58 @@
+/**
+@file LevelPacker.c
+@author Rob Thomas
+@brief Packs levels and sound files into a single level pack.
+@details This file contains the main function of LunarLanderPack. It copies
+each file given into one indexed level pack (see LevelPack.h), which the game
+and the other tools load levels and sounds from as "packFile:entryName".
+Text files of vertices, compiled level files (see LevelFile.h) and WAV files
+can all be packed. Level files are used in place, so packing compiled levels
+makes them start fastest.
+
+Usage: LunarLanderPack packFile file...
+*/
+
+#include <SDL2/SDL.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "GameInitialization.h"
+#include "LevelPack.h"
+
+
+/**
+@fn main
+@brief The main function for LunarLanderPack.
+*/
+int main(int argc, char *argv[])
+{
+	LevelPack *pack;
+
+	/*** Read the command line. ***/
+	if (argc < 3)
+	{
+		fprintf(stderr, "Usage: %s packFile file...\n", argv[0]);
+		return EXIT_FAILURE;
+	}
+
+	/*** Write the pack, then read it back to check it. ***/
+	if (!writeLevelPack(argv[1], argv + 2, argc - 2) ||
+		!( pack = openLevelPack(argv[1]) ))
+	{
+		fprintf(stderr, "Problem encountered writing level pack.\n"
+				"fileName: %s\n", argv[1]);
+		return EXIT_FOPEN_FAIL;
+	}
+
+	for (Uint32 i = 0; i < pack->numEntries; i++)
+	{
+		printf("%s:%s (%llu bytes)\n", argv[1], pack->entries[i].name,
+			   (unsigned long long)(pack->entries[i].size));
+	}
+
+	closeLevelPack(pack);
+
+	return EXIT_SUCCESS;
+}
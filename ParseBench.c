@@ -0,0 +1,179 @@
+/**
+@file ParseBench.c
+@author Rob Thomas
+@brief Compares the speed of the terrain text parser with the fscanf loop it
+replaced.
+@details This file contains the main function of LunarLanderParseBench. It
+reads a text file of vertices a number of times with each of the two parsers,
+checks that they read the same vertices, and reports the best time of each.
+
+Usage: LunarLanderParseBench [terrainFile] [repeats]
+*/
+
+#include <SDL2/SDL.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+
+#include "GameInitialization.h"
+#include "TerrainBuilding.h"
+#include "GameObjects.h"
+
+
+/**
+@def DEFAULT_REPEATS
+@brief The number of times to read the file with each parser if none is given
+on the command line.
+*/
+#define DEFAULT_REPEATS 5
+
+/**
+@fn scanVertexList
+@brief Reads a file of vertices with fscanf, one line at a time, growing the
+Vertex array as it goes (the way readVertexList used to). Only the reading is
+reproduced; the vertices aren't checked.
+@param fileName The name of the file to read from.
+@param terrain Pointer to the Terrain to fill in.
+@return True if the file was read, false otherwise.
+*/
+static bool scanVertexList (char *fileName, Terrain *terrain)
+{
+	FILE *file;
+	Uint32 capacity = 0;
+	int X, Y;
+
+	terrain->vertices = NULL;
+	terrain->numVertices = 0;
+
+	if (!( file = fopen(fileName, "r") ))
+	{
+		return false;
+	}
+
+	while (fscanf(file, "%d %d\n", &X, &Y) == 2)
+	{
+		if (terrain->numVertices == capacity)
+		{
+			capacity = (capacity == 0) ? 64 : capacity * 2;
+			terrain->vertices = (Vertex*)realloc(terrain->vertices,
+												 capacity * sizeof(Vertex));
+			if (terrain->vertices == NULL)
+			{
+				fclose(file);
+				return false;
+			}
+		}
+
+		terrain->vertices[terrain->numVertices].X = X;
+		terrain->vertices[terrain->numVertices].Y = Y;
+		terrain->numVertices++;
+	}
+
+	fclose(file);
+
+	return true;
+}
+
+/**
+@fn getSeconds
+@brief Reads the processor clock.
+@return The processor time used so far (in seconds).
+*/
+static double getSeconds (void)
+{
+	return (double)(clock()) / CLOCKS_PER_SEC;
+}
+
+/**
+@fn main
+@brief The main function for LunarLanderParseBench.
+*/
+int main(int argc, char *argv[])
+{
+	Terrain scanned, parsed;
+	ParseError error;
+	char *fileName = "terrain.txt";
+	long repeats = DEFAULT_REPEATS;
+	double scanBest = -1.0, parseBest = -1.0;
+
+	/*** Read the command line. ***/
+	if (argc >= 2)
+	{
+		fileName = argv[1];
+	}
+	if (argc >= 3)
+	{
+		repeats = strtol(argv[2], NULL, 10);
+	}
+
+	/*** Time each parser, keeping the best of the repeats. ***/
+	for (long i = 0; i < repeats || i == 0; i++)
+	{
+		double start = getSeconds();
+
+		if (!scanVertexList(fileName, &scanned))
+		{
+			fprintf(stderr, "Problem encountered reading file.\nfileName: %s\n",
+					fileName);
+			return EXIT_FOPEN_FAIL;
+		}
+
+		double middle = getSeconds();
+		Uint32 levelWidth = LEVEL_WIDTH;
+
+		if (!parseVertexList(fileName, &parsed, &levelWidth, &error))
+		{
+			fprintf(stderr, "%s (line %u, column %u).\nfileName: %s\n",
+					error.message, error.line, error.column, fileName);
+			freeVertexArray(&scanned);
+			return EXIT_BADFILE_FAIL;
+		}
+
+		double end = getSeconds();
+
+		if (scanBest < 0 || middle - start < scanBest)
+		{
+			scanBest = middle - start;
+		}
+		if (parseBest < 0 || end - middle < parseBest)
+		{
+			parseBest = end - middle;
+		}
+
+		/* The parser may add a Vertex at each end of the level, so compare
+		   the ones read from the file. */
+		Uint32 skip = (parsed.numVertices > scanned.numVertices &&
+					   parsed.vertices[0].X != scanned.vertices[0].X);
+
+		if (parsed.numVertices < scanned.numVertices + skip ||
+			memcmp(parsed.vertices + skip, scanned.vertices,
+				   scanned.numVertices * sizeof(Vertex)) != 0)
+		{
+			fprintf(stderr, "The parsers read different vertices.\n");
+			freeVertexArray(&scanned);
+			freeVertexArray(&parsed);
+			return EXIT_BADFILE_FAIL;
+		}
+
+		if (i == 0)
+		{
+			printf("vertices:  %u\n", scanned.numVertices);
+		}
+
+		freeVertexArray(&scanned);
+		freeVertexArray(&parsed);
+	}
+
+	/*** Report the results. ***/
+	printf("fscanf:    %.3f s\n", scanBest);
+	printf("parser:    %.3f s\n", parseBest);
+	if (parseBest > 0)
+	{
+		printf("speedup:   %.1fx\n", scanBest / parseBest);
+	}
+
+	return EXIT_SUCCESS;
+}
@@ -4,6 +4,14 @@
 @brief The main source file of the Lunar Lander game.
 @details This file contains the main function of Project03_01 (Lunar Lander).
 It handles the primary processing loop of the game.
+
+Usage: Project03_01 [terrainFile] [--record replayFile]
+
+terrainFile may also be "seed:" followed by a number, which plays an endless
+level generated from that seed (see TerrainGenerator.h). It may also be a level
+pack's file name, ':' and the name of a level in the pack (for example
+"levels.llp:terrain2.txt"), in which case the sound effects are read from the
+pack too if it holds them (see LevelPack.h).
 */
 
 #include <SDL2/SDL.h>
@@ -12,17 +20,31 @@ It handles the primary processing loop of the game.
 
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 
 #include "GameInitialization.h"
 #include "GameFunctions.h"
 #include "GameObjects.h"
+#include "Replay.h"
+#include "TerrainReload.h"
+#include "TerrainCache.h"
+#include "TextCache.h"
 
 
 /**
 @def FPS
-@brief A constant for the number of frames per second to display at.
+@brief A constant for the number of frames per second to display at. The
+physics runs at PHYSICS_TICK_RATE regardless of this.
+*/
+#define FPS 60
+
+/**
+@def MAX_CATCH_UP_TICKS
+@brief The most ticks of physics simulated before drawing a frame. If the game
+falls further behind than this (for example, after a long stall), the rest of
+the backlog is dropped instead of fast-forwarding through it.
 */
-#define FPS 30
+#define MAX_CATCH_UP_TICKS 8
 
 /**
 @fn main
@@ -31,30 +53,21 @@ It handles the primary processing loop of the game.
 int main(int argc, char *argv[])
 {
 	GameState state;
+	RenderSnapshot snapshot;
 	Lander lander;
 	Terrain terrain;
-	Vertex firstVertex;
-	Flat firstFlat;
-	Uint16 heightMap[LEVEL_WIDTH];
 	char *fileName, defaultFileName[] = "terrain.txt";
+	char *replayFileName = NULL;
 	int landingType;
 	FPSmanager frameManager;
+	Uint64 tickLength, previousTime, currentTime, timeOwed;
 
 
 	/*** Initialize game state. ***/
-		/* Initialize Vertex first and the terrain. */
-	firstVertex.X = 0;
-	firstVertex.Y = 0;
-	firstVertex.next = NULL;
-	terrain.firstVertex = &firstVertex;
-	terrain.heightMap = heightMap;
-		/* Initialize the first Flat. */
-	firstFlat.X = 0;
-	firstFlat.Y = 0;
-	firstFlat.length = 0;
-	firstFlat.scoreModifier = -1;
-	firstFlat.next = NULL;
-	terrain.firstFlat = &firstFlat;
+		/* Initialize the terrain. */
+	terrain.vertices = NULL;
+	terrain.numVertices = 0;
+	terrain.heightMap = NULL;
 		/* Initialize the Mix chunks. */
 	Mix_Chunk *thrust = NULL;
 	Mix_Chunk *boom = NULL;
@@ -63,19 +76,40 @@ int main(int argc, char *argv[])
 
 		/* If an argument has been passed in from the command line, assume it is
 		   the name of the input file. Otherwise, assume the input file is named
-		   "terrain.txt". */
-	if (argc >= 2)
-	{
-		fileName = argv[1];
-	}
-	else
+		   "terrain.txt". "--record replayFile" records the game's input to
+		   replayFile. */
+	fileName = defaultFileName;
+	for (int i = 1; i < argc; i++)
 	{
-		fileName = defaultFileName;
+		if (strcmp(argv[i], "--record") == 0 && i + 1 < argc)
+		{
+			replayFileName = argv[++i];
+		}
+		else
+		{
+			fileName = argv[i];
+		}
 	}
 
 		/* Initialize the GameState struct with the structs built. */
 	initializeGameState(&state, &lander, &terrain, fileName);
 
+		/* Start recording, if asked to. */
+	if (replayFileName != NULL)
+	{
+		if (!( state.replay = openReplayLog(replayFileName, fileName, &state) ))
+		{
+			fprintf(stderr, "Problem encountered creating replay log.\nfileName: %s\n",
+					replayFileName);
+		}
+	}
+	else
+	{
+		/* Otherwise, reload the level whenever its file is saved. (A replay
+		   can only be played back on the level it was recorded on.) */
+		state.terrainWatch = watchTerrainFile(fileName, &state);
+	}
+
 
 	/*** Initialize SDL. ***/
 	if (!( initializeSDL("Lunar Lander", &state) ))
@@ -96,6 +130,12 @@ int main(int argc, char *argv[])
 	}
 
 
+	/*** Draw the terrain and text from cached textures, if the renderer
+	     can. ***/
+	state.terrainCache = createTerrainCache(&state);
+	state.textCache = createTextCache(&state);
+
+
 	/*** Initialize audio. ***/
 		/* Test for errors in audio initialization. */
 	if (!( initializeSound(&state) ))
@@ -106,12 +146,25 @@ int main(int argc, char *argv[])
 	}
 
 
+	/*** Play the landing and crash sounds whenever a collision is resolved. ***/
+	state.onCollision = playCollisionSound;
+
+
 	/*** Initialize the FPSmanager. ***/
 	SDL_initFramerate(&frameManager);
     SDL_setFramerate(&frameManager, FPS);
 
 
+	/*** Measure the length of one physics tick in performance counter 
+	     units. ***/
+	tickLength = SDL_GetPerformanceFrequency() / PHYSICS_TICK_RATE;
+	previousTime = SDL_GetPerformanceCounter();
+	timeOwed = 0;
+
+
 	/*** Begin game loop: ***/
+	initializeRenderSnapshot(&snapshot);
+
 	while (true)
 	{
 		/* Handle events from the user. If the user wants to quit,
@@ -121,34 +174,63 @@ int main(int argc, char *argv[])
 			break;
 		}
 
-		/* Apply one tick of time. Happens regardless of input from user. */
-		applyTick(&state);
+		/* Add the time since the last frame to the time owed to the 
+		   physics. */
+		currentTime = SDL_GetPerformanceCounter();
+		timeOwed += currentTime - previousTime;
+		previousTime = currentTime;
 
-		/* Check for any collisions and handle them. */
-		if (collisionDetected(state, &landingType))
+		/* Apply one tick of time for every tick's worth of time owed, up to
+		   MAX_CATCH_UP_TICKS. Happens regardless of input from user. */
+		for (int ticks = 0; timeOwed >= tickLength; ticks++)
 		{
-			/* Apply the collision to the game. */
-			applyCollision(&state, landingType);
-			
-			/* If the lander is out of fuel, restart the game completely. */
-			if (gameOver(state))
+			if (ticks == MAX_CATCH_UP_TICKS)
 			{
-				hardReset(&state);
+				timeOwed = 0;
+				break;
 			}
-			/* Otherwise, respawn the lander and continue playing as normal. */
-			else
+
+			applyTick(&state);
+			timeOwed -= tickLength;
+
+			/* Check for any collisions and handle them. */
+			if (collisionDetected(state, &landingType))
 			{
-				softReset(&state);
+				/* Apply the collision to the game. */
+				applyCollision(&state, landingType);
+				
+				/* If the lander is out of fuel, restart the game completely. */
+				if (gameOver(state))
+				{
+					hardReset(&state);
+				}
+				/* Otherwise, respawn the lander and continue playing as 
+				   normal. */
+				else
+				{
+					softReset(&state);
+				}
+
+				/* Don't count the time spent waiting on the collision message
+				   as time owed. */
+				previousTime = SDL_GetPerformanceCounter();
+				timeOwed = 0;
+				break;
 			}
 		}
 
+		/* Apply any changes made to the level's file. */
+		reloadTerrain(&state);
+
 		/* Wait until it's time to draw again. */
 		SDL_framerateDelay(&frameManager);
-		/* Draw the game state to the screen. */
-		draw(state);
+		/* Draw a snapshot of the game state to the screen. */
+		takeRenderSnapshot(&state, &snapshot);
+		draw(&snapshot);
 	}
 
 
 	/*** Once out of the game loop, clean up SDL and close. ***/
+	freeRenderSnapshot(&snapshot);
 	cleanAndExit(&state, EXIT_SUCCESS);
 }
\ No newline at end of file
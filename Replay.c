@@ -0,0 +1,636 @@
+/**
+@file Replay.c
+@author Rob Thomas
+@brief Contains functions for recording the player's input and replaying it.
+@details All integers in a replay log are little-endian and the physics
+constants are stored as the bits of IEEE doubles, so a log can be moved between
+machines.
+*/
+
+#include <SDL2/SDL.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "GameObjects.h"
+#include "GameInitialization.h"
+#include "Simulation.h"
+#include "TerrainGenerator.h"
+#include "LevelPack.h"
+
+#include "Replay.h"
+
+
+/* The number format of the lander's position and velocities, which changes
+   every result of the physics. */
+#ifdef FIXED_POINT_PHYSICS
+#define PHYSICS_FORMAT 1
+#else
+#define PHYSICS_FORMAT 0
+#endif
+
+/* The first four bytes of every replay log. */
+static const char replayMagic[4] = {'L', 'L', 'R', 'P'};
+
+/* The FNV-1a offset basis and prime for 64-bit hashes. */
+#define FNV_OFFSET 14695981039346656037ULL
+#define FNV_PRIME 1099511628211ULL
+
+/**
+@fn hashBytes
+@brief Adds bytes to a running FNV-1a hash.
+@param hash The hash so far.
+@param data The bytes to add.
+@param size The number of bytes to add.
+@return The new hash.
+*/
+static Uint64 hashBytes (Uint64 hash, const void *data, size_t size)
+{
+	const Uint8 *bytes = (const Uint8*)data;
+
+	for (size_t i = 0; i < size; i++)
+	{
+		hash ^= bytes[i];
+		hash *= FNV_PRIME;
+	}
+
+	return hash;
+}
+
+/**
+@fn writeUint
+@brief Writes the low size bytes of an integer, least significant first.
+@param file The file to write to.
+@param value The value to write.
+@param size The number of bytes to write.
+*/
+static void writeUint (FILE *file, Uint64 value, int size)
+{
+	for (int i = 0; i < size; i++)
+	{
+		fputc((int)((value >> (8 * i)) & 0xFF), file);
+	}
+}
+
+/**
+@fn readUint
+@brief Reads an integer of size bytes, least significant first.
+@param file The file to read from.
+@param value Buffer for the value read.
+@param size The number of bytes to read.
+@return True if the value was read, false at the end of the file.
+*/
+static bool readUint (FILE *file, Uint64 *value, int size)
+{
+	*value = 0;
+
+	for (int i = 0; i < size; i++)
+	{
+		int c = fgetc(file);
+		if (c == EOF)
+		{
+			return false;
+		}
+		*value |= (Uint64)(c) << (8 * i);
+	}
+
+	return true;
+}
+
+/**
+@fn writeDouble
+@brief Writes the bits of a double as a little-endian 64-bit integer.
+@param file The file to write to.
+@param value The value to write.
+*/
+static void writeDouble (FILE *file, double value)
+{
+	Uint64 bits;
+
+	memcpy(&bits, &value, sizeof(bits));
+	writeUint(file, bits, 8);
+}
+
+/**
+@fn writeVarint
+@brief Writes an integer 7 bits at a time, least significant first, with the
+high bit of each byte set if more bytes follow.
+@param file The file to write to.
+@param value The value to write.
+*/
+static void writeVarint (FILE *file, Uint32 value)
+{
+	while (value >= 0x80)
+	{
+		fputc((int)((value & 0x7F) | 0x80), file);
+		value >>= 7;
+	}
+
+	fputc((int)(value), file);
+}
+
+/**
+@fn readVarint
+@brief Reads an integer written by writeVarint.
+@param file The file to read from.
+@param value Buffer for the value read.
+@return True if the value was read, false at the end of the file.
+*/
+static bool readVarint (FILE *file, Uint32 *value)
+{
+	int c, shift = 0;
+
+	*value = 0;
+
+	do
+	{
+		if ((c = fgetc(file)) == EOF || shift > 28)
+		{
+			return false;
+		}
+		*value |= (Uint32)(c & 0x7F) << shift;
+		shift += 7;
+	} while (c & 0x80);
+
+	return true;
+}
+
+/**
+@fn writeConstants
+@brief Writes the physics constants this build was compiled with.
+@param file The file to write to.
+*/
+static void writeConstants (FILE *file)
+{
+	writeUint(file, PHYSICS_TICK_RATE, 2);
+	writeUint(file, BASE_TICK_RATE, 2);
+	writeUint(file, PHYSICS_FORMAT, 2);
+	writeDouble(file, GRAVITY);
+	writeDouble(file, UP_THRUST_POWER);
+	writeDouble(file, LEFT_THRUST_POWER);
+	writeDouble(file, RIGHT_THRUST_POWER);
+	writeUint(file, LANDING_THRESHOLD, 2);
+	writeUint(file, THRUST_FUEL_COST, 2);
+	writeUint(file, CRASH_FUEL_COST, 2);
+	writeUint(file, SCORE_FOR_LANDING, 2);
+	writeUint(file, FUEL_START, 2);
+	writeUint(file, LANDER_X_START, 2);
+	writeUint(file, LANDER_Y_START, 2);
+}
+
+/**
+@fn readConstants
+@brief Reads physics constants written by writeConstants and checks that they
+are the ones this build was compiled with.
+@param file The file to read from.
+@return True if every constant matches, false otherwise.
+*/
+static bool readConstants (FILE *file)
+{
+	const double doubles[4] = {GRAVITY, UP_THRUST_POWER, LEFT_THRUST_POWER,
+							   RIGHT_THRUST_POWER};
+	const Uint64 before[3] = {PHYSICS_TICK_RATE, BASE_TICK_RATE,
+							  PHYSICS_FORMAT};
+	const Uint64 after[7] = {LANDING_THRESHOLD, THRUST_FUEL_COST, 
+							 CRASH_FUEL_COST, SCORE_FOR_LANDING, FUEL_START,
+							 LANDER_X_START, LANDER_Y_START};
+	Uint64 value, bits;
+	bool match = true;
+
+	for (int i = 0; i < 3; i++)
+	{
+		match = readUint(file, &value, 2) && value == before[i] && match;
+	}
+	for (int i = 0; i < 4; i++)
+	{
+		memcpy(&bits, &doubles[i], sizeof(bits));
+		match = readUint(file, &value, 8) && value == bits && match;
+	}
+	for (int i = 0; i < 7; i++)
+	{
+		match = readUint(file, &value, 2) && value == after[i] && match;
+	}
+
+	return match;
+}
+
+/**
+@fn hashTerrainFile
+@brief Computes the FNV-1a hash of a terrain file's contents.
+@details A generated level has no file, so the hash of its name (which holds
+its seed) is used instead. A packed level is hashed from its entry in the
+pack, so it matches the loose file it was packed from.
+@param fileName The name of the terrain file.
+@return The hash of the file, or 0 if it couldn't be read.
+*/
+Uint64 hashTerrainFile (char *fileName)
+{
+	FILE *file;
+	Uint8 buffer[4096];
+	size_t read;
+	Uint64 hash = FNV_OFFSET;
+
+	if (isGeneratedLevel(fileName))
+	{
+		return hashBytes(hash, fileName, strlen(fileName));
+	}
+
+	/* A packed level is hashed from its entry's contents. */
+	if (isPackedLevel(fileName))
+	{
+		LevelPack *pack;
+		const LevelPackEntry *entry;
+
+		if (!( entry = openPackedLevel(fileName, &pack) ))
+		{
+			return 0;
+		}
+
+		hash = hashBytes(hash, getPackEntryData(pack, entry), entry->size);
+		closeLevelPack(pack);
+
+		return hash;
+	}
+
+	if (!( file = fopen(fileName, "rb") ))
+	{
+		return 0;
+	}
+
+	while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0)
+	{
+		hash = hashBytes(hash, buffer, read);
+	}
+
+	fclose(file);
+
+	return hash;
+}
+
+/**
+@fn hashGameState
+@brief Computes the FNV-1a hash of the simulated parts of a game state (the
+lander, score, fuel and tick count).
+@details The timer and focus point are left out, since they depend on the
+clock and on the window rather than on the physics.
+@param state The GameState to hash.
+@return The hash of the state.
+*/
+Uint64 hashGameState (GameState state)
+{
+	Uint64 hash = FNV_OFFSET;
+
+	hash = hashBytes(hash, &state.lander->realX, sizeof(state.lander->realX));
+	hash = hashBytes(hash, &state.lander->realY, sizeof(state.lander->realY));
+	hash = hashBytes(hash, &state.lander->horVelocity,
+					 sizeof(state.lander->horVelocity));
+	hash = hashBytes(hash, &state.lander->vertVelocity,
+					 sizeof(state.lander->vertVelocity));
+	hash = hashBytes(hash, &state.score, sizeof(state.score));
+	hash = hashBytes(hash, &state.fuel, sizeof(state.fuel));
+	hash = hashBytes(hash, &state.ticks, sizeof(state.ticks));
+
+	return hash;
+}
+
+/**
+@fn openReplayLog
+@brief Creates a replay log and writes its header.
+@details The header holds the magic bytes "LLRP", the format version, the
+terrain file's hash and name, the level width and the physics constants.
+@param replayFile The name of the file to record to.
+@param terrainFile The name of the terrain file being played.
+@param state Pointer to the initialized GameState struct.
+@return Pointer to the new ReplayLog, or NULL if it couldn't be created.
+*/
+ReplayLog *openReplayLog (char *replayFile, char *terrainFile,
+						  GameState *state)
+{
+	ReplayLog *log;
+	size_t nameLength = strlen(terrainFile);
+
+	if (nameLength > REPLAY_NAME_SIZE - 1)
+	{
+		nameLength = REPLAY_NAME_SIZE - 1;
+	}
+
+	if (!( log = (ReplayLog*)malloc(sizeof(ReplayLog)) ))
+	{
+		return NULL;
+	}
+
+	if (!( log->file = fopen(replayFile, "wb") ))
+	{
+		free(log);
+		return NULL;
+	}
+
+	log->lastTick = state->ticks;
+
+	/*** Write the header. ***/
+	fwrite(replayMagic, 1, sizeof(replayMagic), log->file);
+	writeUint(log->file, REPLAY_VERSION, 2);
+	writeUint(log->file, hashTerrainFile(terrainFile), 8);
+	fputc((int)(nameLength), log->file);
+	fwrite(terrainFile, 1, nameLength, log->file);
+	writeUint(log->file, state->levelWidth, 4);
+	writeConstants(log->file);
+	writeUint(log->file, state->ticks, 4);
+
+	return log;
+}
+
+/**
+@fn recordReplayInput
+@brief Records one thrust key processed at the given tick.
+@param log Pointer to the ReplayLog to record to.
+@param tick The tick the thrust was applied before.
+@param direction The thruster fired (THRUST_UP, THRUST_LEFT or THRUST_RIGHT).
+*/
+void recordReplayInput (ReplayLog *log, Uint32 tick, int direction)
+{
+	writeVarint(log->file, tick - log->lastTick);
+	fputc(direction, log->file);
+
+	log->lastTick = tick;
+}
+
+/**
+@fn closeReplayLog
+@brief Writes the end record of a replay log, then closes and frees it.
+@details The end record holds the ticks since the previous record, REPLAY_END
+and the hash of the final game state.
+@param log Pointer to the ReplayLog to close.
+@param state Pointer to the final GameState struct.
+*/
+void closeReplayLog (ReplayLog *log, GameState *state)
+{
+	Uint64 hash = hashGameState(*state);
+
+	writeVarint(log->file, state->ticks - log->lastTick);
+	fputc(REPLAY_END, log->file);
+	writeUint(log->file, hash, 8);
+
+	if (fclose(log->file))
+	{
+		fprintf(stderr, "Problem encountered trying to close replay log.\n");
+	}
+	free(log);
+
+	printf("Recorded %u ticks. Final state hash: %016llx\n", state->ticks,
+		   (unsigned long long)(hash));
+}
+
+/**
+@fn readReplayRecord
+@brief Reads the next record of a replay log being played back.
+@param playback Pointer to the ReplayPlayback.
+@return True if the record was read, false if the log ended early (the
+playback's action is then EOF, with no ticks left before it).
+*/
+static bool readReplayRecord (ReplayPlayback *playback)
+{
+	if (!readVarint(playback->file, &playback->ticksLeft) ||
+		(playback->action = fgetc(playback->file)) == EOF)
+	{
+		fprintf(stderr, "Replay log ended without an end record.\n");
+		playback->ticksLeft = 0;
+		playback->action = EOF;
+		return false;
+	}
+
+	return true;
+}
+
+/**
+@fn readReplayHeader
+@brief Reads and checks the start of a replay log's header, up to and
+including the terrain file's name.
+@param file The replay log, positioned at its start.
+@param terrainHash Buffer for the hash of the terrain file.
+@param terrainFile Buffer of REPLAY_NAME_SIZE chars for the terrain file's
+name.
+@return True if the header was read, false if the file isn't a replay log of
+this version.
+*/
+static bool readReplayHeader (FILE *file, Uint64 *terrainHash,
+							  char *terrainFile)
+{
+	char magic[4];
+	Uint64 version;
+	int nameLength;
+
+	if (fread(magic, 1, sizeof(magic), file) != sizeof(magic) ||
+		memcmp(magic, replayMagic, sizeof(magic)) != 0 ||
+		!readUint(file, &version, 2) || version != REPLAY_VERSION ||
+		!readUint(file, terrainHash, 8) || (nameLength = fgetc(file)) == EOF ||
+		fread(terrainFile, 1, nameLength, file) != (size_t)(nameLength))
+	{
+		return false;
+	}
+	terrainFile[nameLength] = '\0';
+
+	return true;
+}
+
+/**
+@fn readReplayTerrainName
+@brief Reads the name of the terrain file a replay log was recorded on, so the
+same level can be loaded to play it back.
+@param replayFile The name of the replay log.
+@param terrainFile Buffer of REPLAY_NAME_SIZE chars for the terrain file's
+name.
+@return True if the name was read, false if the log can't be read.
+*/
+bool readReplayTerrainName (char *replayFile, char *terrainFile)
+{
+	FILE *file;
+	Uint64 terrainHash;
+	bool read;
+
+	if (!( file = fopen(replayFile, "rb") ))
+	{
+		fprintf(stderr, "Problem encountered opening replay log.\nfileName: %s\n",
+				replayFile);
+		return false;
+	}
+
+	if (!( read = readReplayHeader(file, &terrainHash, terrainFile) ))
+	{
+		fprintf(stderr, "Not a version %d replay log.\nfileName: %s\n",
+				REPLAY_VERSION, replayFile);
+	}
+	fclose(file);
+
+	return read;
+}
+
+/**
+@fn openReplayPlayback
+@brief Opens a replay log to be played back tick by tick, and sets the game
+state's tick count to the one the log starts at.
+@details Checks that the log was recorded on the same terrain and with the same
+physics constants. A log that wasn't is still played back, but reported, and
+won't count as matching when it is closed.
+@param replayFile The name of the replay log to play back.
+@param terrainFile The name of the terrain file the log was recorded on.
+@param state Pointer to a GameState initialized with that terrain.
+@return Pointer to the new ReplayPlayback, or NULL if the log can't be read.
+*/
+ReplayPlayback *openReplayPlayback (char *replayFile, char *terrainFile,
+									GameState *state)
+{
+	ReplayPlayback *playback;
+	FILE *file;
+	char recordedFile[REPLAY_NAME_SIZE];
+	Uint64 terrainHash, levelWidth, startTick;
+	bool ok = true;
+
+	if (!( file = fopen(replayFile, "rb") ))
+	{
+		fprintf(stderr, "Problem encountered opening replay log.\nfileName: %s\n",
+				replayFile);
+		return NULL;
+	}
+
+	/*** Read and check the header. ***/
+	if (!readReplayHeader(file, &terrainHash, recordedFile) ||
+		!readUint(file, &levelWidth, 4))
+	{
+		fprintf(stderr, "Not a version %d replay log.\nfileName: %s\n",
+				REPLAY_VERSION, replayFile);
+		fclose(file);
+		return NULL;
+	}
+
+	if (terrainHash != hashTerrainFile(terrainFile) ||
+		levelWidth != state->levelWidth)
+	{
+		fprintf(stderr, "Replay log was recorded on different terrain.\n");
+		ok = false;
+	}
+
+	if (!readConstants(file))
+	{
+		fprintf(stderr, "Replay log was recorded with different physics.\n");
+		ok = false;
+	}
+
+	if (!readUint(file, &startTick, 4) ||
+		!( playback = (ReplayPlayback*)malloc(sizeof(ReplayPlayback)) ))
+	{
+		fclose(file);
+		return NULL;
+	}
+	state->ticks = (Uint32)(startTick);
+
+	playback->file = file;
+	playback->ticksLeft = 0;
+	playback->action = REPLAY_END;
+	playback->ok = ok;
+
+	/*** Read the first record. ***/
+	readReplayRecord(playback);
+
+	return playback;
+}
+
+/**
+@fn advanceReplayPlayback
+@brief Applies the thrusts recorded before the next tick of a replay, which
+the caller then simulates.
+@details Each record holds the ticks to simulate before its thrust, so the
+thrusts of every record whose ticks have all been simulated are applied (and
+the records after them read) until one with ticks left is reached.
+@param playback Pointer to the ReplayPlayback.
+@param state Pointer to the GameState being played back.
+@return True if there is another tick to simulate, false once the end of the
+log has been reached.
+*/
+bool advanceReplayPlayback (ReplayPlayback *playback, GameState *state)
+{
+	while (playback->ticksLeft == 0)
+	{
+		if (playback->action == REPLAY_END || playback->action == EOF)
+		{
+			return false;
+		}
+
+		applyThrust(state, playback->action);
+		readReplayRecord(playback);
+	}
+
+	playback->ticksLeft--;
+
+	return true;
+}
+
+/**
+@fn closeReplayPlayback
+@brief Closes a replay log and frees it, printing the final state hash and
+whether it matches the one recorded.
+@param playback Pointer to the ReplayPlayback to close.
+@param state Pointer to the final GameState struct.
+@return True if the whole log was played back and the final state matched the
+recorded one, false otherwise.
+*/
+bool closeReplayPlayback (ReplayPlayback *playback, GameState *state)
+{
+	Uint64 recordedHash;
+	bool matched = false;
+
+	/*** Report the final state, if the log was played to its end. ***/
+	if (playback->action == REPLAY_END && playback->ticksLeft == 0)
+	{
+		if (readUint(playback->file, &recordedHash, 8))
+		{
+			Uint64 hash = hashGameState(*state);
+
+			printf("Replayed %u ticks. Final state hash: %016llx (%s)\n",
+				   state->ticks, (unsigned long long)(hash),
+				   (hash == recordedHash) ? "matches" : "DOES NOT MATCH");
+
+			matched = playback->ok && (hash == recordedHash);
+		}
+		else
+		{
+			fprintf(stderr, "Replay log ended without a final state hash.\n");
+		}
+	}
+
+	fclose(playback->file);
+	free(playback);
+
+	return matched;
+}
+
+/**
+@fn runReplay
+@brief Runs a replay log through the simulation as fast as possible.
+@details Plays the log back (see openReplayPlayback), stepping the simulation
+tick by tick and handling collisions the way the game does. Prints the final
+state hash and whether it matches the one recorded.
+@param replayFile The name of the replay log to run.
+@param terrainFile The name of the terrain file the log was recorded on.
+@param state Pointer to a GameState initialized with that terrain.
+@return True if the replay ran and its final state matched the recorded one,
+false otherwise.
+*/
+bool runReplay (char *replayFile, char *terrainFile, GameState *state)
+{
+	ReplayPlayback *playback;
+
+	if (!( playback = openReplayPlayback(replayFile, terrainFile, state) ))
+	{
+		return false;
+	}
+
+	while (advanceReplayPlayback(playback, state))
+	{
+		stepSimulation(state);
+	}
+
+	return closeReplayPlayback(playback, state);
+}
@@ -0,0 +1,178 @@
+/**
+@file Replay.h
+@author Rob Thomas
+@brief Contains functions for recording the player's input and replaying it.
+@details A replay log is a small binary file. It begins with a header holding
+the hash and name of the terrain file and the physics constants (and number
+format) the game was built with. It is followed by one record per thrust key
+processed by handleKey: the number of ticks since the previous record (as a
+variable-length integer) and the thruster fired. It ends with an end record holding the total
+number of ticks and the hash of the final game state. Since the physics is
+deterministic, running the same input through the simulation gives the same
+final state, so a replay can be verified without a window and at full CPU
+speed.
+*/
+#ifndef LUNAR_LANDER_REPLAY_H
+#define LUNAR_LANDER_REPLAY_H
+
+#include <SDL2/SDL.h>
+
+#include <stdio.h>
+#include <stdbool.h>
+
+#include "GameObjects.h"
+
+/**
+@def REPLAY_VERSION
+@brief The version of the replay log format written by this build.
+*/
+#define REPLAY_VERSION 5
+
+/**
+@def REPLAY_END
+@brief The action byte marking the end record of a replay log.
+*/
+#define REPLAY_END 0xFF
+
+/**
+@def REPLAY_NAME_SIZE
+@brief The size of a buffer holding the name of the terrain file stored in a
+replay log's header (including its terminating null character).
+*/
+#define REPLAY_NAME_SIZE 256
+
+/**
+@typedef ReplayLog
+@brief A replay log being recorded.
+*/
+typedef struct ReplayLog
+{
+	/* The file the log is written to. */
+	FILE *file;
+
+	/* The tick of the last record written. */
+	Uint32 lastTick;
+} ReplayLog;
+
+/**
+@typedef ReplayPlayback
+@brief A replay log being played back tick by tick.
+*/
+typedef struct ReplayPlayback
+{
+	/* The file the log is read from. */
+	FILE *file;
+
+	/* The ticks left to simulate before the current record's action, and the
+	   action (REPLAY_END for the end record, or EOF if the log ended
+	   early). */
+	Uint32 ticksLeft;
+	int action;
+
+	/* False if the log was recorded on different terrain or physics. */
+	bool ok;
+} ReplayPlayback;
+
+/**
+@fn hashTerrainFile
+@brief Computes the FNV-1a hash of a terrain file's contents (or of a packed
+level's entry, or of the name of a generated level).
+@param fileName The name of the terrain file.
+@return The hash of the file, or 0 if it couldn't be read.
+*/
+Uint64 hashTerrainFile (char *fileName);
+
+/**
+@fn hashGameState
+@brief Computes the FNV-1a hash of the simulated parts of a game state (the
+lander, score, fuel and tick count).
+@param state The GameState to hash.
+@return The hash of the state.
+*/
+Uint64 hashGameState (GameState state);
+
+/**
+@fn openReplayLog
+@brief Creates a replay log and writes its header.
+@param replayFile The name of the file to record to.
+@param terrainFile The name of the terrain file being played.
+@param state Pointer to the initialized GameState struct.
+@return Pointer to the new ReplayLog, or NULL if it couldn't be created.
+*/
+ReplayLog *openReplayLog (char *replayFile, char *terrainFile,
+						  GameState *state);
+
+/**
+@fn recordReplayInput
+@brief Records one thrust key processed at the given tick.
+@param log Pointer to the ReplayLog to record to.
+@param tick The tick the thrust was applied before.
+@param direction The thruster fired (THRUST_UP, THRUST_LEFT or THRUST_RIGHT).
+*/
+void recordReplayInput (ReplayLog *log, Uint32 tick, int direction);
+
+/**
+@fn closeReplayLog
+@brief Writes the end record of a replay log, then closes and frees it.
+@param log Pointer to the ReplayLog to close.
+@param state Pointer to the final GameState struct.
+*/
+void closeReplayLog (ReplayLog *log, GameState *state);
+
+/**
+@fn readReplayTerrainName
+@brief Reads the name of the terrain file a replay log was recorded on, so the
+same level can be loaded to play it back.
+@param replayFile The name of the replay log.
+@param terrainFile Buffer of REPLAY_NAME_SIZE chars for the terrain file's
+name.
+@return True if the name was read, false if the log can't be read.
+*/
+bool readReplayTerrainName (char *replayFile, char *terrainFile);
+
+/**
+@fn openReplayPlayback
+@brief Opens a replay log to be played back tick by tick, and sets the game
+state's tick count to the one the log starts at.
+@param replayFile The name of the replay log to play back.
+@param terrainFile The name of the terrain file the log was recorded on.
+@param state Pointer to a GameState initialized with that terrain.
+@return Pointer to the new ReplayPlayback, or NULL if the log can't be read.
+*/
+ReplayPlayback *openReplayPlayback (char *replayFile, char *terrainFile,
+									GameState *state);
+
+/**
+@fn advanceReplayPlayback
+@brief Applies the thrusts recorded before the next tick of a replay, which
+the caller then simulates.
+@param playback Pointer to the ReplayPlayback.
+@param state Pointer to the GameState being played back.
+@return True if there is another tick to simulate, false once the end of the
+log has been reached.
+*/
+bool advanceReplayPlayback (ReplayPlayback *playback, GameState *state);
+
+/**
+@fn closeReplayPlayback
+@brief Closes a replay log and frees it, printing the final state hash and
+whether it matches the one recorded.
+@param playback Pointer to the ReplayPlayback to close.
+@param state Pointer to the final GameState struct.
+@return True if the whole log was played back and the final state matched the
+recorded one, false otherwise.
+*/
+bool closeReplayPlayback (ReplayPlayback *playback, GameState *state);
+
+/**
+@fn runReplay
+@brief Runs a replay log through the simulation as fast as possible.
+@param replayFile The name of the replay log to run.
+@param terrainFile The name of the terrain file the log was recorded on.
+@param state Pointer to a GameState initialized with that terrain.
+@return True if the replay ran and its final state matched the recorded one,
+false otherwise.
+*/
+bool runReplay (char *replayFile, char *terrainFile, GameState *state);
+
+#endif /* LUNAR_LANDER_REPLAY_H */
@@ -0,0 +1,1088 @@
+/**
+@file Simulation.c
+@author Rob Thomas
+@brief Contains the physics and rules of the Lunar Lander game.
+@details This file contains the functions that move the lander, detect and
+resolve collisions with the terrain, and reset the game. None of them draw,
+play sounds or read the clock, so they can be run without a window or an audio
+device. Landings and crashes are reported through the GameState's onCollision
+callback.
+*/
+
+#include <SDL2/SDL.h>
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <math.h>
+
+#include "GameObjects.h"
+#include "GameInitialization.h"
+#include "TerrainBuilding.h"
+#include "LevelFile.h"
+#include "LevelPack.h"
+#include "TerrainGenerator.h"
+
+#include "Simulation.h"
+
+
+/**
+@fn initializeSimulation
+@brief Initializes the simulated parts of a GameState's fields.
+@details Fills in the lander, builds the terrain from the given file and resets
+the score, fuel, timer and focus point. The window, renderer and sounds are left
+untouched so that this can be used without initializing SDL.
+@param state Pointer to the struct to initialize.
+@param lander Pointer to an empty Lander struct.
+@param terrain Pointer to a terrain struct whose data members have been 
+initialized.
+@param fileName String containing the name of the file to read vertices from
+(or "seed:" followed by a seed, to generate an endless level, or a level
+pack's file name, ':' and an entry's name, to load a level from the pack).
+*/
+void initializeSimulation (GameState *state, Lander *lander, Terrain *terrain,
+						   char *fileName)
+{
+	/*** First fill the Lander passed in. ***/
+	lander->realX = TO_REAL(LANDER_X_START);
+	lander->realY = TO_REAL(LANDER_Y_START);
+	lander->X = LANDER_X_START;
+	lander->Y = LANDER_Y_START;
+	lander->length = LANDER_LENGTH;
+	lander->height = LANDER_HEIGHT;
+	lander->horVelocity = TO_REAL(LANDER_VX_START);
+	lander->vertVelocity = TO_REAL(LANDER_VY_START);
+	lander->deltaX = 0;
+	lander->deltaY = 0;
+
+
+	/*** Fill the GameState passed in with the Lander and defaults values. ***/
+	state->lander = lander;
+
+	state->levelWidth = LEVEL_WIDTH;
+	state->levelHeight = LEVEL_HEIGHT;
+	
+	/*** Load a compiled level file in place, load a level from a level pack,
+	     generate a level from a seed, or build the terrain from a text file
+	     of vertices. ***/
+	state->terrain = terrain;
+	terrain->mapping = NULL;
+	terrain->mappingSize = 0;
+	terrain->flats = NULL;
+	terrain->numFlats = 0;
+	terrain->flatTable = NULL;
+	terrain->stream = NULL;
+	terrain->pack = NULL;
+	terrain->changedFirst = 1;
+	terrain->changedLast = 0;
+
+	if (isLevelFile(fileName))
+	{
+		mapLevelFile(fileName, terrain, &state->levelWidth);
+	}
+	else if (isPackedLevel(fileName))
+	{
+		loadPackedLevel(fileName, state);
+	}
+	else if (isGeneratedLevel(fileName))
+	{
+		generateTerrain(fileName, state);
+	}
+	else
+	{
+		buildHeightMap(fileName, terrain, &state->levelWidth);
+		buildHeightIndex(terrain, state->levelWidth);
+		findLandingStrips(state);
+	}
+
+	state->focusPointX = 0;
+	state->focusPointY = WINDOW_HEIGHT;
+
+	state->realFocusPointX = 0;
+	state->realFocusPointY = WINDOW_HEIGHT;
+
+	state->timeStart = -1;
+	state->timeElapsed = 0;
+	state->ticks = 0;
+	state->score = 0;
+	state->fuel = FUEL_START;
+
+	/*** No one is listening for collisions, recording input, watching the
+	     level's file or caching its terrain or text yet. ***/
+	state->onCollision = NULL;
+	state->collisionData = NULL;
+	state->replay = NULL;
+	state->terrainWatch = NULL;
+	state->terrainCache = NULL;
+	state->textCache = NULL;
+}
+
+/**
+@fn simulateTick
+@brief Moves the lander by one tick of game time.
+@details Applies gravity to the lander, then moves it by its velocities, 
+wrapping it around the horizontal boundaries of the level (and streaming in the
+chunks ahead of it, in a generated level). Velocities are
+measured per base tick, so both are scaled by TICK_SCALE. Independent of user
+action and of the clock.
+@param state Pointer to the current GameState struct.
+*/
+void simulateTick (GameState *state)
+{
+	/*** Decrease the lander's vertical velocity by GRAVITY constant. ***/
+	state->lander->vertVelocity -= TO_REAL(GRAVITY * TICK_SCALE);
+
+	/*** Change the lander's x and y positions by the corresponding 
+	     velocities. ***/
+	state->lander->deltaX = SCALE_BY_TICK(state->lander->horVelocity);
+	state->lander->deltaY = SCALE_BY_TICK(state->lander->vertVelocity);
+
+	state->lander->realX += state->lander->deltaX;
+		/* If the lander's position surpasses any of the boundaries, 
+		   wrap it around that boundary. */
+	while ( state->lander->realX < 0 )
+	{
+		state->lander->realX += TO_REAL(state->levelWidth);
+	}
+	while ( state->lander->realX >= TO_REAL(state->levelWidth) )
+	{
+		state->lander->realX -= TO_REAL(state->levelWidth);
+	}
+
+	state->lander->realY += state->lander->deltaY;
+
+	state->lander->X = REAL_TO_INT(state->lander->realX);
+	state->lander->Y = REAL_TO_INT(state->lander->realY);
+
+	/*** Bring the chunks ahead of the lander in, if the level is generated. ***/
+	streamTerrain(state);
+
+	/*** Count the tick. ***/
+	state->ticks++;
+}
+
+/**
+@fn stepSimulation
+@brief Simulates one tick of game time and handles any collision it causes.
+@details Handles a collision the same way the game does, minus the message:
+the collision is resolved, then the game is restarted completely if the lander
+is out of fuel, or the lander is respawned otherwise.
+@param state Pointer to the current GameState struct.
+@return The type of collision that occurred during the tick (LANDING_NONE if 
+none).
+*/
+int stepSimulation (GameState *state)
+{
+	simulateTick(state);
+
+	int landingType = detectCollision(*state);
+
+	if (landingType != LANDING_NONE)
+	{
+		resolveCollision(state, landingType);
+
+		if (gameOver(*state))
+		{
+			hardReset(state);
+		}
+		else
+		{
+			softReset(state);
+		}
+	}
+
+	return landingType;
+}
+
+/**
+@fn applyThrust
+@brief Fires one of the lander's thrusters for one tick.
+@details Firing the UP thruster increases the lander's vertical velocity, the 
+LEFT thruster increases its horizontal velocity and the RIGHT thruster decreases
+it. Each firing consumes THRUST_FUEL_COST fuel; nothing happens if there isn't
+enough fuel left.
+@param state Pointer to the current GameState struct.
+@param direction The thruster to fire (THRUST_UP, THRUST_LEFT or THRUST_RIGHT).
+@return True if the thruster fired, false if there wasn't enough fuel.
+*/
+bool applyThrust (GameState *state, int direction)
+{
+	if (state->fuel < THRUST_FUEL_COST)
+	{
+		return false;
+	}
+
+	switch (direction)
+	{
+		case THRUST_UP:
+			state->lander->vertVelocity += TO_REAL(UP_THRUST_POWER);
+			break;
+		case THRUST_LEFT:
+			state->lander->horVelocity += TO_REAL(LEFT_THRUST_POWER);
+			break;
+		case THRUST_RIGHT:
+			state->lander->horVelocity -= TO_REAL(RIGHT_THRUST_POWER);
+			break;
+		default:
+			return false;
+	}
+
+	state->fuel -= THRUST_FUEL_COST;
+
+	return true;
+}
+
+/**
+@fn flyAutopilot
+@brief Fires the thrusters to keep the lander from falling or drifting faster
+than the given speeds.
+@details Fires the UP thruster if the lander is falling faster than 
+maxFallSpeed, and the LEFT or RIGHT thruster if it is drifting faster than 
+maxDriftSpeed. Meant to be called as often as a player's key repeat would fire
+(once per base tick).
+@param state Pointer to the current GameState struct.
+@param maxFallSpeed The fastest the lander may fall before thrusting up.
+@param maxDriftSpeed The fastest the lander may drift sideways before thrusting
+against the drift.
+*/
+void flyAutopilot (GameState *state, double maxFallSpeed, double maxDriftSpeed)
+{
+	if (state->lander->vertVelocity < TO_REAL(-maxFallSpeed))
+	{
+		applyThrust(state, THRUST_UP);
+	}
+	if (state->lander->horVelocity > TO_REAL(maxDriftSpeed))
+	{
+		applyThrust(state, THRUST_RIGHT);
+	}
+	else if (state->lander->horVelocity < TO_REAL(-maxDriftSpeed))
+	{
+		applyThrust(state, THRUST_LEFT);
+	}
+}
+
+/**
+@fn detectCollision
+@brief Detects if a collision has occurred between the lander and terrain.
+@details A collision happens when any part of the bottom of the lander reached
+terrain level during the last tick (see sweepCollision). Make sure that the
+entirety of the lander's bottom has hit FLAT land. If not, the lander has
+crashed. Then, check the total velocity of the lander. If it's at or below the
+LANDING_THRESHOLD, a successful landing took place. Otherwise, a crash
+occurred.
+@param state The GameState struct representing the current state of the game.
+@return LANDING_PROPER if a proper landing occurred, LANDING_CRASH if a crash
+occurred or LANDING_NONE if no collision was detected.
+*/
+int detectCollision (GameState state)
+{
+	int impactX;
+
+	return sweepCollision(state, &impactX);
+}
+
+/**
+@fn sweepCollision
+@brief Detects if the lander hit the terrain at any point during the last
+tick, and where.
+@details The lander's whole bottom edge is swept along the path it moved along
+during the tick (given by its deltaX and deltaY), so it can't pass through a
+narrow peak between columns or between ticks. If it hit the terrain, the
+landing is judged by the speed of the lander and the flatness of the terrain
+under its whole width at the moment of impact.
+@param state The GameState struct representing the current state of the game.
+@param impactX Buffer for the column under the lander's left end at the moment
+of impact. Left unchanged if there was no collision.
+@return LANDING_PROPER if a proper landing occurred, LANDING_CRASH if a crash
+occurred or LANDING_NONE if no collision was detected.
+*/
+int sweepCollision (GameState state, int *impactX)
+{
+	Lander *lander = state.lander;
+	int leftX;
+
+	/*** Find the column under the lander's left end the first moment it
+	     touched the terrain. ***/
+	if (!findImpact(state.terrain, state.levelWidth, lander->length,
+					lander->realX - lander->deltaX,
+					lander->realY - lander->deltaY,
+					lander->deltaX, lander->deltaY, &leftX))
+	{
+		return LANDING_NONE;
+	}
+
+	/* The width is unsigned, so widen it to a signed type first for a column
+	   left of the start of the level to wrap to the end of it. */
+	Sint64 levelWidth = state.levelWidth;
+
+	leftX = (int)(((leftX % levelWidth) + levelWidth) % levelWidth);
+	*impactX = leftX;
+
+	/*** Check for a proper landing. The speed of the lander must be at or
+	     under the LANDING_THRESHOLD and the terrain must be flat. ***/
+	if ( isLandingSpeed(state) && isFlatLand(state, leftX, lander->length) )
+	{
+		return LANDING_PROPER;
+	}
+
+	/*** Otherwise, a crash occurred. ***/
+	return LANDING_CRASH;
+}
+
+#ifdef FIXED_POINT_PHYSICS
+
+/**
+@fn multiplyWide
+@brief Multiplies two unsigned 64-bit integers into a 128-bit product.
+@param first The first factor.
+@param second The second factor.
+@param high Buffer for the upper 64 bits of the product.
+@param low Buffer for the lower 64 bits of the product.
+*/
+static void multiplyWide (Uint64 first, Uint64 second, Uint64 *high,
+						  Uint64 *low)
+{
+	Uint64 lowLow = (first & 0xFFFFFFFF) * (second & 0xFFFFFFFF);
+	Uint64 lowHigh = (first & 0xFFFFFFFF) * (second >> 32);
+	Uint64 highLow = (first >> 32) * (second & 0xFFFFFFFF);
+	Uint64 middle = (lowLow >> 32) + (lowHigh & 0xFFFFFFFF) +
+					(highLow & 0xFFFFFFFF);
+
+	*low = (middle << 32) | (lowLow & 0xFFFFFFFF);
+	*high = (first >> 32) * (second >> 32) + (lowHigh >> 32) +
+			(highLow >> 32) + (middle >> 32);
+}
+
+/**
+@fn compareProducts
+@brief Compares two products of unsigned 64-bit integers exactly, as the
+products of two Reals can overflow 64 bits.
+@return A negative number, 0 or a positive number if a * b is less than, equal
+to or greater than c * d.
+*/
+static int compareProducts (Uint64 a, Uint64 b, Uint64 c, Uint64 d)
+{
+	Uint64 firstHigh, firstLow, secondHigh, secondLow;
+
+	multiplyWide(a, b, &firstHigh, &firstLow);
+	multiplyWide(c, d, &secondHigh, &secondLow);
+
+	if (firstHigh != secondHigh)
+	{
+		return (firstHigh < secondHigh) ? -1 : 1;
+	}
+	if (firstLow != secondLow)
+	{
+		return (firstLow < secondLow) ? -1 : 1;
+	}
+
+	return 0;
+}
+
+/**
+@fn scaleByFraction
+@brief Multiplies a value by a fraction no greater than 1, exactly.
+@details The 128-bit product is divided by long division, one bit at a time.
+@param value The value to scale.
+@param numerator The fraction's numerator (no greater than its denominator).
+@param denominator The fraction's denominator.
+@param roundUp True to round the result up, false to round it down.
+@return value * numerator / denominator, rounded as asked.
+*/
+static Uint64 scaleByFraction (Uint64 value, Uint64 numerator,
+							   Uint64 denominator, bool roundUp)
+{
+	Uint64 remainder, low, quotient = 0;
+
+	multiplyWide(value, numerator, &remainder, &low);
+
+	for (int bit = 0; bit < 64; bit++)
+	{
+		/* Bring the next bit of the product down into the remainder, which
+		   may then need a 65th bit (carried). */
+		bool carried = (remainder >> 63) != 0;
+
+		remainder = (remainder << 1) | (low >> 63);
+		low <<= 1;
+		quotient <<= 1;
+
+		if (carried || remainder >= denominator)
+		{
+			remainder -= denominator;
+			quotient |= 1;
+		}
+	}
+
+	return quotient + ((roundUp && remainder != 0) ? 1 : 0);
+}
+
+/**
+@fn floorToColumn
+@brief Finds the column a (possibly negative) X position lies in.
+@param x The X position.
+@return The column, floor(x).
+*/
+static int floorToColumn (Position x)
+{
+	return (int)((x >= 0) ? (x >> 32) : ~(~x >> 32));
+}
+
+#else
+
+/**
+@fn floorToColumn
+@brief Finds the column a (possibly negative) X position lies in.
+@param x The X position.
+@return The column, floor(x).
+*/
+static int floorToColumn (Position x)
+{
+	return (int)(x) - (x < (int)(x));
+}
+
+#endif
+
+/**
+@fn findImpact
+@brief Finds the first moment a lander's bottom edge touches the terrain as it
+moves along a straight path, and where its left end is then.
+@details A lander whose left end is at x covers columns floor(x) to
+floor(x) + length, and touches a column when its bottom is less than one pixel
+above the column's height. For each column the path passes over, this finds the
+part of the path during which the lander covers it, then the first moment in
+that part that the lander's bottom is low enough to touch it.
+
+In the fixed-point build this is done entirely in Reals. Each moment is kept
+as a fraction of the path (a distance over |deltaX| or |deltaY|), and two
+moments are compared by cross-multiplying, so the result is exact and the same
+on every machine. The floating point build works in doubles.
+@param terrain Pointer to the Terrain, with its height index built.
+@param levelWidth The width of the level (in pixels).
+@param length The length (left to right) of the lander.
+@param startX The X position of the lander's bottom-left corner at the start of
+the path (it need not be wrapped into the level).
+@param startY The Y position of the lander's bottom-left corner at the start of
+the path.
+@param deltaX The distance moved right along the path.
+@param deltaY The distance moved up along the path.
+@param impactX Buffer for the column under the lander's left end at the moment
+of impact (not wrapped into the level).
+@return True if the lander touched the terrain along the path, false otherwise.
+*/
+bool findImpact (Terrain *terrain, Uint32 levelWidth, Uint16 length,
+				 Position startX, Position startY, Real deltaX, Real deltaY,
+				 int *impactX)
+{
+	Position endX = startX + deltaX;
+	Position lowestY = startY + ((deltaY < 0) ? deltaY : 0);
+	Position left = (deltaX < 0) ? endX : startX;
+	Position right = (deltaX < 0) ? startX : endX;
+	int firstColumn = floorToColumn(left);
+	int lastColumn = floorToColumn(right) + length;
+	int wrapped = firstColumn;
+	Uint16 *heightMap = terrain->heightMap;
+#ifdef FIXED_POINT_PHYSICS
+	/* The earliest moment found so far, as a fraction (starting past the end
+	   of the path), and the length of the path across and down. */
+	Uint64 earliest = 2, earliestOver = 1;
+	Uint64 across = (deltaX < 0) ? -(Uint64)(deltaX) : (Uint64)(deltaX);
+	Uint64 down = (deltaY < 0) ? -(Uint64)(deltaY) : (Uint64)(deltaY);
+#else
+	double earliest = 2.0;
+#endif
+
+	while (wrapped < 0)
+	{
+		wrapped += levelWidth;
+	}
+	while (wrapped >= levelWidth)
+	{
+		wrapped -= levelWidth;
+	}
+
+	/*** Most of the time the whole path is above every column it passes over,
+	     which the height index shows at once. ***/
+	Uint16 highest = getHighestTerrain(terrain, wrapped,
+									   lastColumn - firstColumn + 1);
+
+	if (lowestY >= INT_TO_REAL(highest + 1))
+	{
+		return false;
+	}
+
+	/*** Otherwise find the first column touched. ***/
+	for (int column = firstColumn; column <= lastColumn; column++, wrapped++)
+	{
+		if (wrapped == levelWidth)
+		{
+			wrapped = 0;
+		}
+
+		/* Most columns are never reached by the lowest point of the path.
+		   On a long path, skip past a run of them at once, found with the
+		   height pyramid. */
+		Position top = INT_TO_REAL(heightMap[wrapped] + 1);
+		if (lowestY >= top && lastColumn - column < HEIGHT_BLOCK_SIZE)
+		{
+			continue;
+		}
+		if (lowestY >= top)
+		{
+			Uint32 runEnd = min(levelWidth - 1,
+								wrapped + (Uint32)(lastColumn - column));
+			Uint32 next = findTerrainAbove(terrain, wrapped, runEnd,
+										   (Uint16)(REAL_TO_INT(lowestY) - 1));
+
+			column += next - 1 - wrapped;
+			wrapped = next - 1;
+			continue;
+		}
+
+#ifdef FIXED_POINT_PHYSICS
+		/* Find when the lander's left end is in [column - length, column + 1),
+		   i.e. when the lander covers the column, as distances across (over
+		   the whole distance across, or over 1 if it didn't move across). */
+		Sint64 enter = 0, leave = 1;
+		Uint64 over = 1;
+
+		if (deltaX > 0)
+		{
+			enter = INT_TO_REAL(column - length) - startX;
+			leave = INT_TO_REAL(column + 1) - startX;
+			over = across;
+		}
+		else if (deltaX < 0)
+		{
+			enter = startX - INT_TO_REAL(column + 1);
+			leave = startX - INT_TO_REAL(column - length);
+			over = across;
+		}
+		enter = (enter < 0) ? 0 : enter;
+		leave = (leave > (Sint64)(over)) ? (Sint64)(over) : leave;
+
+		if (enter > leave ||
+			compareProducts(enter, earliestOver, earliest, over) >= 0)
+		{
+			continue;
+		}
+
+		/* Find the first moment in that time the bottom is low enough: the
+		   bottom is (top - startY) - deltaY * time below the top of the
+		   column. */
+		Real gap = top - startY;
+
+		if (gap > 0 && (deltaY <= 0 ||
+						compareProducts(enter, down, gap, over) < 0))
+		{
+			earliest = enter;
+			earliestOver = over;
+		}
+		else if (gap <= 0 && deltaY < 0 &&
+				 compareProducts(enter, down, -gap, over) > 0)
+		{
+			earliest = enter;
+			earliestOver = over;
+		}
+		else if (gap <= 0 && deltaY < 0 &&
+				 compareProducts(leave, down, -gap, over) > 0 &&
+				 compareProducts(-gap, earliestOver, earliest, down) < 0)
+		{
+			earliest = -gap;
+			earliestOver = down;
+		}
+#else
+		/* Find when the lander's left end is in [column - length, column + 1),
+		   i.e. when the lander covers the column. */
+		double enter = 0.0, leave = 1.0, hit;
+
+		if (deltaX > 0)
+		{
+			enter = (column - length - startX) / deltaX;
+			leave = (column + 1 - startX) / deltaX;
+		}
+		else if (deltaX < 0)
+		{
+			enter = (column + 1 - startX) / deltaX;
+			leave = (column - length - startX) / deltaX;
+		}
+		enter = (enter < 0.0) ? 0.0 : enter;
+		leave = (leave > 1.0) ? 1.0 : leave;
+
+		if (enter > leave || enter >= earliest)
+		{
+			continue;
+		}
+
+		/* Find the first moment in that time the bottom is low enough. */
+		if (startY + enter * deltaY < top)
+		{
+			hit = enter;
+		}
+		else if (deltaY < 0 && startY + leave * deltaY < top)
+		{
+			hit = (top - startY) / deltaY;
+		}
+		else
+		{
+			continue;
+		}
+
+		if (hit < earliest)
+		{
+			earliest = hit;
+		}
+#endif
+	}
+
+#ifdef FIXED_POINT_PHYSICS
+	if (earliest > earliestOver)
+	{
+		return false;
+	}
+
+	/* Move the left end that fraction of the way across. The distance is
+	   rounded down moving right and up moving left, so the position is
+	   floored to the same column as the exact one would be. */
+	Uint64 moved = scaleByFraction(across, earliest, earliestOver,
+								   deltaX < 0);
+
+	*impactX = floorToColumn((deltaX < 0) ? startX - (Position)(moved) :
+											startX + (Position)(moved));
+#else
+	if (earliest > 1.0)
+	{
+		return false;
+	}
+
+	*impactX = (int)(floor(startX + earliest * deltaX));
+#endif
+	return true;
+}
+
+/**
+@fn resolveCollision
+@brief Alters the game state following a collision given the type of collision.
+@details If it was a proper landing, then the player's score is incremented by 
+SCORE_FOR_LANDING times the score modifier of the strip landed on. If it was a 
+crash, then some of the player's fuel is lost. The onCollision callback (if any)
+is then told about the collision.
+@param state Pointer to the current GameState struct.
+@param landingType The type of collision that has occurred.
+@return The score gained (if positive or 0) OR the fuel lost (if negative).
+*/
+int resolveCollision (GameState *state, int landingType)
+{
+	int score;
+
+	/*** If landingType is LANDING_PROPER, increment the player's score. ***/
+	if (landingType == LANDING_PROPER)
+	{
+		Uint16 modifier = 0;
+
+		/* Find the Flat representing the region just landed on. */
+		Flat* currentFlat = findLandedFlat(*state);
+
+		if (currentFlat != NULL)
+		{
+			modifier = currentFlat->scoreModifier;
+		}
+
+		/* Increment the player's score with SCORE_FOR_LANDING times the
+		   modifier. */
+		score = SCORE_FOR_LANDING * modifier;
+		state->score += score;
+	}
+
+	/*** If landingType is LANDING_CRASH, decrement the lander's fuel. ***/
+	else if (landingType == LANDING_CRASH)
+	{
+		state->fuel -= CRASH_FUEL_COST;
+
+		score = CRASH_FUEL_COST * -1;
+	}
+
+	/*** If landingType is neither, then an error has occurred. ***/
+	else
+	{
+		return 0;
+	}
+
+	/*** Tell whoever is listening about the collision. ***/
+	if (state->onCollision != NULL)
+	{
+		state->onCollision(state, landingType, score, state->collisionData);
+	}
+
+	return score;
+}
+
+/**
+@fn findLandedFlat
+@brief Finds the landing strip under the lander.
+@details Looks up the first Flat that doesn't end left of the lander in the
+terrain's Flat table.
+@param state The current GameState struct.
+@return Pointer to the Flat the lander is on, or NULL if there is none.
+*/
+Flat *findLandedFlat (GameState state)
+{
+	Terrain *terrain = state.terrain;
+	Uint32 index;
+
+	if (state.lander->X >= state.levelWidth)
+	{
+		return NULL;
+	}
+
+	index = terrain->flatTable[state.lander->X];
+
+	return (index < terrain->numFlats) ? &terrain->flats[index] : NULL;
+}
+
+/**
+@fn isLandingSpeed
+@brief Reports whether or not the lander is going slow enough for a proper 
+landing.
+@param state The current GameState struct.
+@return True if the lander's speed is at or under LANDING_THRESHOLD.
+False otherwise.
+*/
+bool isLandingSpeed (GameState state)
+{
+	return isLandingVelocity(state.lander->horVelocity,
+							 state.lander->vertVelocity);
+}
+
+/**
+@fn isLandingVelocity
+@brief Reports whether or not a lander with the given velocities is going slow
+enough for a proper landing. In the fixed-point build the speeds are compared
+in integer arithmetic.
+@param horVelocity The lander's horizontal velocity.
+@param vertVelocity The lander's vertical velocity.
+@return True if the speed is at or under LANDING_THRESHOLD. False otherwise.
+*/
+bool isLandingVelocity (Real horVelocity, Real vertVelocity)
+{
+#ifdef FIXED_POINT_PHYSICS
+	/* The truncated speed is at or under the threshold exactly when the
+	   squared speed is under (threshold + 1) squared. Compare them in 16.16
+	   fixed point, which can't overflow for any speed the lander reaches. */
+	Sint64 vx = horVelocity / 65536;
+	Sint64 vy = vertVelocity / 65536;
+	Sint64 limit = (Sint64)(LANDING_THRESHOLD + 1) * 65536;
+
+	return vx * vx + vy * vy < limit * limit;
+#else
+	double speed = sqrt( (double)((vertVelocity * vertVelocity)
+								  + (horVelocity * horVelocity)) );
+
+	if ( (int)(speed) <= LANDING_THRESHOLD )
+	{
+		return true;
+	}
+
+	return false;
+#endif
+}
+
+/**
+@fn isFlatLand
+@brief Reports if the terrain under a lander is flat.
+@details This function checks if the highest and lowest terrain under every
+column the lander covers are the same. If so, returns true.
+@param state The current GameState struct.
+@param leftX The x coordinate of the lander's left end.
+@param length The length (left to right) of the lander.
+@return True if the terrain is at the same height at each column from leftX to
+leftX + length. False otherwise.
+*/
+bool isFlatLand (GameState state, int leftX, int length)
+{
+	if (getHighestTerrain(state.terrain, leftX, length + 1) ==
+		getLowestTerrain(state.terrain, leftX, length + 1))
+	{
+		return true;
+	}
+
+	return false;
+}
+
+/**
+@fn gameOver
+@brief Reports whether or not the game is over now.
+@param state The GameState struct representing the current state of the game.
+@return True if the land has no more fuel. False otherwise.
+*/
+bool gameOver (GameState state)
+{
+	/*** Return true if there is no more fuel. ***/
+		/* Since fuel is an unsigned int, it will overflow to large positive
+		   value when it falls below 0, so check for that. */
+	if (state.fuel <= 0 || state.fuel > FUEL_START)
+	{
+		return true;
+	}
+
+	/*** Otherwise, return false. ***/
+	return false;
+}
+
+/**
+@fn hardReset
+@brief Refreshes the game as if it were just relaunched.
+@details Ends the current game, displaying the user's score and time. Then,
+waits for the user to respond. Once the user responds, resets the GameState as
+if the game were just launched.
+@param state Pointer to the current GameState struct.
+*/
+void hardReset (GameState *state)
+{
+	/*** Draw a message showing the user's score and time. ***/
+
+	/*** Reset the game state to initial state. ***/
+		/* Reset lander's position. */
+	state->lander->realX = TO_REAL(LANDER_X_START);
+	state->lander->realY = TO_REAL(LANDER_Y_START);
+	state->lander->X = REAL_TO_INT(state->lander->realX);
+	state->lander->Y = REAL_TO_INT(state->lander->realY);
+	state->lander->length = LANDER_LENGTH;
+	state->lander->height = LANDER_HEIGHT;
+
+		/* Reset the lander's horizontal and vertical velocities. */
+	state->lander->horVelocity = TO_REAL(LANDER_VX_START);
+	state->lander->vertVelocity = TO_REAL(LANDER_VY_START);
+	state->lander->deltaX = 0;
+	state->lander->deltaY = 0;
+
+		/* Reset the focus point. */
+	state->realFocusPointX = 0;
+	state->realFocusPointY = WINDOW_HEIGHT;
+	state->focusPointX = (int)(state->realFocusPointX);
+	state->focusPointY = (int)(state->realFocusPointY);
+
+		/* Reset score, time, and fuel. */
+	state->score = 0;
+	state->timeStart = -1;
+	state->timeElapsed = 0;
+	state->fuel = FUEL_START;
+
+		/* Return a generated level to its start. */
+	seekTerrainStream(state, 0);
+
+	/*** Wait for a user event, then release. ***/
+}
+
+/**
+@fn softReset
+@brief Respawns the lander and continues the game.
+@details Moves the lander back to its original spawn position, then waits for
+the user to respond. Once the user responds, releases the game and allows the
+user to continue playing.
+@param state Pointer to the current GameState struct.
+*/
+void softReset (GameState *state)
+{
+	/*** Reset the lander's position and velocities. ***/
+	state->lander->realX = TO_REAL(LANDER_X_START);
+	state->lander->realY = TO_REAL(LANDER_Y_START);
+	state->lander->X = REAL_TO_INT(state->lander->realX);
+	state->lander->Y = REAL_TO_INT(state->lander->realY);
+	state->lander->length = LANDER_LENGTH;
+	state->lander->height = LANDER_HEIGHT;
+	state->lander->horVelocity = TO_REAL(LANDER_VX_START);
+	state->lander->vertVelocity = TO_REAL(LANDER_VY_START);
+	state->lander->deltaX = 0;
+	state->lander->deltaY = 0;
+
+		/* Reset the focus point. */
+	state->realFocusPointX = 0;
+	state->realFocusPointY = WINDOW_HEIGHT;
+	state->focusPointX = (int)(state->realFocusPointX);
+	state->focusPointY = (int)(state->realFocusPointY);
+
+	/*** Wait for a user event, then release. ***/
+}
+
+/**
+@fn wrapIntoLevel
+@brief Wraps the lander and focus point back inside the level, if they are
+past its right edge (after the level has narrowed, or a snapshot taken before
+it did has been restored).
+@param state Pointer to the current GameState struct.
+*/
+void wrapIntoLevel (GameState *state)
+{
+	while ( state->lander->realX >= TO_REAL(state->levelWidth) )
+	{
+		state->lander->realX -= TO_REAL(state->levelWidth);
+	}
+	state->lander->X = REAL_TO_INT(state->lander->realX);
+
+	while ( state->realFocusPointX >= (double)(state->levelWidth) )
+	{
+		state->realFocusPointX -= (double)(state->levelWidth);
+	}
+	state->focusPointX = (int)(state->realFocusPointX);
+}
+
+/**
+@fn saveSnapshot
+@brief Copies the parts of a game that change during play into a snapshot.
+@param state The GameState to save.
+@param snapshot Pointer to the GameSnapshot to fill.
+*/
+void saveSnapshot (GameState state, GameSnapshot *snapshot)
+{
+	snapshot->lander = *(state.lander);
+
+	snapshot->timeStart = state.timeStart;
+	snapshot->timeElapsed = state.timeElapsed;
+	snapshot->ticks = state.ticks;
+
+	snapshot->score = state.score;
+	snapshot->fuel = state.fuel;
+
+	snapshot->focusPointX = state.focusPointX;
+	snapshot->focusPointY = state.focusPointY;
+	snapshot->realFocusPointX = state.realFocusPointX;
+	snapshot->realFocusPointY = state.realFocusPointY;
+
+	snapshot->terrainChunk = getStreamChunk(state.terrain);
+}
+
+/**
+@fn restoreSnapshot
+@brief Rolls a game back (or forward) to a snapshot. The snapshot must have
+been taken of a game on the same level.
+@details The level may have been reloaded since the snapshot was taken, so the
+lander and focus point are wrapped into its current width.
+@param state Pointer to the GameState to restore into.
+@param snapshot Pointer to the GameSnapshot to restore.
+*/
+void restoreSnapshot (GameState *state, const GameSnapshot *snapshot)
+{
+	*(state->lander) = snapshot->lander;
+
+	state->timeStart = snapshot->timeStart;
+	state->timeElapsed = snapshot->timeElapsed;
+	state->ticks = snapshot->ticks;
+
+	state->score = snapshot->score;
+	state->fuel = snapshot->fuel;
+
+	state->focusPointX = snapshot->focusPointX;
+	state->focusPointY = snapshot->focusPointY;
+	state->realFocusPointX = snapshot->realFocusPointX;
+	state->realFocusPointY = snapshot->realFocusPointY;
+
+	wrapIntoLevel(state);
+	seekTerrainStream(state, snapshot->terrainChunk);
+}
+
+/**
+@fn getVelocity 
+@brief Calculates the magnitude of the lander's velocity.
+@param state The GameState struct representing the current state of the game.
+@return The magnitude of the lander's velocity as a positive double.
+*/
+double getVelocity (GameState state)
+{
+#ifdef FIXED_POINT_PHYSICS
+	double vertVelocity = FROM_REAL(state.lander->vertVelocity);
+	double horVelocity = FROM_REAL(state.lander->horVelocity);
+
+	return sqrt( (vertVelocity * vertVelocity) + (horVelocity * horVelocity) );
+#else
+	return sqrt( (double)
+				((state.lander->vertVelocity * state.lander->vertVelocity)
+			    + (state.lander->horVelocity * state.lander->horVelocity)));
+#endif
+}
+
+/**
+@fn getMinutes
+@brief Returns the number of elapsed minutes in game time (mod 100).
+@param state The current GameState struct.
+@return The number of minutes elapsed while playing.
+*/
+int getMinutes (GameState state)
+{
+	/* Get the elapsed time (in ms) from the game state. */
+	int t = state.timeElapsed;
+
+	/* Convert to minutes. */
+	t /= 60000;
+
+	/* Mod by 100 (only two decimal places returned). */
+	t = t % 100;
+
+	return t;
+}
+
+/**
+@fn getSeconds 
+@brief Returns the number of elapsed seconds in game time (mod 60).
+@param state The current GameState struct.
+@return The number of seconds elapsed while playing.
+*/
+int getSeconds (GameState state)
+{
+	/* Get the elapsed time (in ms) from the game state. */
+	int t = state.timeElapsed;
+
+	/* Convert to seconds. */
+	t /= 1000;
+
+	/* Mod by 60. */
+	t = t % 60;
+
+	return t;
+}
+
+/**
+@fn getAltitude 
+@brief Returns the distance between the lander and the highest terrain under
+any part of it.
+@param state The current GameState struct.
+@return The distance (in pixels) between the terrain and lander.
+*/
+
+int getAltitude (GameState state)
+{
+	return state.lander->Y - getHighestTerrain(state.terrain, state.lander->X,
+											   state.lander->length + 1);
+}
+
+/**
+@fn min
+@brief Returns the smaller of two ints.
+@param first One of two ints to compare.
+@param second One of two ints to compare.
+@return The smaller of the two ints.
+*/
+int min (int first, int second)
+{
+	if (first <= second)
+	{
+		return first;
+	}
+
+	return second;
+}
+
+/**
+@fn max
+@brief Returns the larger of two ints.
+@param first One of two ints to compare.
+@param second One of two ints to compare.
+@return The larger of the two ints.
+*/
+int max (int first, int second)
+{
+	if (first >= second)
+	{
+		return first;
+	}
+
+	return second;
+}
@@ -0,0 +1,388 @@
+/**
+@file Simulation.h
+@author Rob Thomas
+@brief Contains the physics and rules of the Lunar Lander game.
+@details This file contains the functions that move the lander, detect and
+resolve collisions with the terrain, and reset the game. None of them draw,
+play sounds or read the clock, so they can be run without a window or an audio
+device. Landings and crashes are reported through the GameState's onCollision
+callback.
+*/
+#ifndef LUNAR_LANDER_SIMULATION_H
+#define LUNAR_LANDER_SIMULATION_H
+
+#include <SDL2/SDL.h>
+
+#include <stdbool.h>
+
+#include "GameObjects.h"
+
+/**
+@def BASE_TICK_RATE
+@brief The number of ticks per second that GRAVITY, the thrust powers and the
+lander's velocities are measured against. (The game originally applied exactly
+one tick per frame at 30 frames per second.)
+*/
+#define BASE_TICK_RATE 30
+
+/**
+@def PHYSICS_TICK_RATE
+@brief The number of ticks of physics simulated per second of game time.
+*/
+#define PHYSICS_TICK_RATE 120
+
+/**
+@def TICK_SCALE
+@brief The length of one physics tick as a fraction of a base tick. Gravity and
+movement are multiplied by this so that the lander flies the same way whatever
+PHYSICS_TICK_RATE is.
+*/
+#define TICK_SCALE ((double)(BASE_TICK_RATE) / (double)(PHYSICS_TICK_RATE))
+
+/**
+@def SCALE_BY_TICK
+@brief Multiplies a Real (such as a velocity) by TICK_SCALE. In the fixed-point
+build this is a shift that rounds towards negative infinity, which needs
+PHYSICS_TICK_RATE to be BASE_TICK_RATE times a power of two.
+*/
+#ifdef FIXED_POINT_PHYSICS
+#define TICK_SCALE_SHIFT 2
+#if (BASE_TICK_RATE << TICK_SCALE_SHIFT) != PHYSICS_TICK_RATE
+#error "Fixed-point physics needs PHYSICS_TICK_RATE == BASE_TICK_RATE << TICK_SCALE_SHIFT."
+#endif
+#define SCALE_BY_TICK(real) (((real) >= 0) ? ((real) >> TICK_SCALE_SHIFT) : \
+							 ~(~(real) >> TICK_SCALE_SHIFT))
+#else
+#define SCALE_BY_TICK(real) ((real) * TICK_SCALE)
+#endif
+
+/**
+@def REAL_TO_INT
+@brief Truncates a (non-negative) Real or Position to the int below it. In the
+fixed-point build this takes the integer bits with a shift rather than going
+through a double, which would round once the value has more than 53
+significant bits (past about 2^21 columns).
+*/
+#ifdef FIXED_POINT_PHYSICS
+#define REAL_TO_INT(real) ((int)((real) >> 32))
+#else
+#define REAL_TO_INT(real) ((int)(real))
+#endif
+
+/**
+@def INT_TO_REAL
+@brief Converts an int (such as a column or a height) to a Real, with a
+multiplication rather than through a double in the fixed-point build.
+*/
+#ifdef FIXED_POINT_PHYSICS
+#define INT_TO_REAL(value) ((Real)(value) * 4294967296LL)
+#else
+#define INT_TO_REAL(value) ((Real)(value))
+#endif
+
+/**
+@def GRAVITY
+@brief A constant for the downward acceleration per base tick of the lander.
+*/
+#define GRAVITY 0.005
+
+/**
+@def LANDING_THRESHOLD
+@brief A constant that dictates the max velocity for a landing to take place.
+*/
+#define LANDING_THRESHOLD 1
+
+/**
+@def UP_THRUST_POWER
+@brief A constant that dictates how much the vertical velocity is increased by
+when the UP arrow key is pressed.
+*/
+#define UP_THRUST_POWER 0.04
+
+/**
+@def LEFT_THRUST_POWER
+@brief A constant that dictates how much the horizonal velocity is increased by
+when the LEFT arrow key is pressed.
+*/
+#define LEFT_THRUST_POWER 0.1
+
+/**
+@def RIGHT_THRUST_POWER
+@brief A constant that dictates how much the horizontal velocity is decreased by
+when the RIGHT arrow key is pressed.
+*/
+#define RIGHT_THRUST_POWER 0.1
+
+/**
+@def THRUST_FUEL_COST
+@brief A constant that dictates how much fuel is lost by thrusting for one tick.
+*/
+#define THRUST_FUEL_COST 1
+
+/**
+@def SCORE_FOR_LANDING
+@brief The default amount of score to gain from a proper landing,
+later multiplied by the score multiplier for that landing spot.
+*/
+#define SCORE_FOR_LANDING 100
+
+/**
+@def CRASH_FUEL_COST
+@brief The default amount of fuel lost when the lander crashes.
+*/
+#define CRASH_FUEL_COST 200
+
+/* Collision (landing) types. */
+#define LANDING_NONE 0
+#define LANDING_PROPER 1
+#define LANDING_CRASH 2
+
+/* Thrust directions. */
+#define THRUST_UP 0
+#define THRUST_LEFT 1
+#define THRUST_RIGHT 2
+
+
+/**
+@fn initializeSimulation
+@brief Initializes the simulated parts of a GameState's fields.
+@param state Pointer to the struct to initialize.
+@param lander Pointer to an empty Lander struct.
+@param terrain Pointer to a terrain struct whose data members have been
+initialized.
+@param fileName String containing the name of the file to read vertices from
+(or "seed:" followed by a seed, to generate an endless level, or a level
+pack's file name, ':' and an entry's name, to load a level from the pack).
+*/
+void initializeSimulation (GameState *state, Lander *lander, Terrain *terrain,
+						   char *fileName);
+
+/**
+@fn simulateTick
+@brief Moves the lander by one tick of game time.
+@param state Pointer to the current GameState struct.
+*/
+void simulateTick (GameState *state);
+
+/**
+@fn stepSimulation
+@brief Simulates one tick of game time and handles any collision it causes.
+@param state Pointer to the current GameState struct.
+@return The type of collision that occurred during the tick (LANDING_NONE if 
+none).
+*/
+int stepSimulation (GameState *state);
+
+/**
+@fn applyThrust
+@brief Fires one of the lander's thrusters for one tick.
+@param state Pointer to the current GameState struct.
+@param direction The thruster to fire (THRUST_UP, THRUST_LEFT or THRUST_RIGHT).
+@return True if the thruster fired, false if there wasn't enough fuel.
+*/
+bool applyThrust (GameState *state, int direction);
+
+/**
+@fn flyAutopilot
+@brief Fires the thrusters to keep the lander from falling or drifting faster
+than the given speeds.
+@param state Pointer to the current GameState struct.
+@param maxFallSpeed The fastest the lander may fall before thrusting up.
+@param maxDriftSpeed The fastest the lander may drift sideways before thrusting
+against the drift.
+*/
+void flyAutopilot (GameState *state, double maxFallSpeed, double maxDriftSpeed);
+
+/**
+@fn detectCollision
+@brief Detects if a collision has occurred between the lander and terrain.
+@param state The GameState struct representing the current state of the game.
+@return LANDING_PROPER if a proper landing occurred, LANDING_CRASH if a crash
+occurred or LANDING_NONE if no collision was detected.
+*/
+int detectCollision (GameState state);
+
+/**
+@fn sweepCollision
+@brief Detects if the lander hit the terrain at any point during the last
+tick, and where.
+@param state The GameState struct representing the current state of the game.
+@param impactX Buffer for the column under the lander's left end at the moment
+of impact. Left unchanged if there was no collision.
+@return LANDING_PROPER if a proper landing occurred, LANDING_CRASH if a crash
+occurred or LANDING_NONE if no collision was detected.
+*/
+int sweepCollision (GameState state, int *impactX);
+
+/**
+@fn findImpact
+@brief Finds the first moment a lander's bottom edge touches the terrain as it
+moves along a straight path, and where its left end is then. The fixed-point
+build finds it with integers alone.
+@param terrain Pointer to the Terrain, with its height index built.
+@param levelWidth The width of the level (in pixels).
+@param length The length (left to right) of the lander.
+@param startX The X position of the lander's bottom-left corner at the start of
+the path (it need not be wrapped into the level).
+@param startY The Y position of the lander's bottom-left corner at the start of
+the path.
+@param deltaX The distance moved right along the path.
+@param deltaY The distance moved up along the path.
+@param impactX Buffer for the column under the lander's left end at the moment
+of impact (not wrapped into the level).
+@return True if the lander touched the terrain along the path, false otherwise.
+*/
+bool findImpact (Terrain *terrain, Uint32 levelWidth, Uint16 length,
+				 Position startX, Position startY, Real deltaX, Real deltaY,
+				 int *impactX);
+
+/**
+@fn resolveCollision
+@brief Alters the game state following a collision given the type of collision.
+@param state Pointer to the current GameState struct.
+@param landingType The type of collision that has occurred.
+@return The score gained (if positive or 0) OR the fuel lost (if negative).
+*/
+int resolveCollision (GameState *state, int landingType);
+
+/**
+@fn findLandedFlat
+@brief Finds the landing strip under the lander.
+@param state The current GameState struct.
+@return Pointer to the Flat the lander is on, or NULL if there is none.
+*/
+Flat *findLandedFlat (GameState state);
+
+/**
+@fn isLandingSpeed
+@brief Reports whether or not the lander is going slow enough for a proper
+landing.
+@param state The current GameState struct.
+@return True if the lander's speed is at or under LANDING_THRESHOLD.
+False otherwise.
+*/
+bool isLandingSpeed (GameState state);
+
+/**
+@fn isLandingVelocity
+@brief Reports whether or not a lander with the given velocities is going slow
+enough for a proper landing. In the fixed-point build the speeds are compared
+in integer arithmetic.
+@param horVelocity The lander's horizontal velocity.
+@param vertVelocity The lander's vertical velocity.
+@return True if the speed is at or under LANDING_THRESHOLD. False otherwise.
+*/
+bool isLandingVelocity (Real horVelocity, Real vertVelocity);
+
+/**
+@fn isFlatLand
+@brief Reports if the terrain under a lander is flat.
+@param state The current GameState struct.
+@param leftX The x coordinate of the lander's left end.
+@param length The length (left to right) of the lander.
+@return True if the terrain is at the same height at each column from leftX to
+leftX + length. False otherwise.
+*/
+bool isFlatLand (GameState state, int leftX, int length);
+
+/**
+@fn gameOver
+@brief Reports whether or not the game is over now.
+@param state The GameState struct representing the current state of the game.
+@return True if the land has no more fuel. False otherwise.
+*/
+bool gameOver (GameState state);
+
+/**
+@fn hardReset
+@brief Refreshes the game as if it were just relaunched.
+@param state Pointer to the current GameState struct.
+*/
+void hardReset (GameState *state);
+
+/**
+@fn softReset
+@brief Respawns the lander and continues the game.
+@param state Pointer to the current GameState struct.
+*/
+void softReset (GameState *state);
+
+/**
+@fn wrapIntoLevel
+@brief Wraps the lander and focus point back inside the level, if they are
+past its right edge (after the level has narrowed, or a snapshot taken before
+it did has been restored).
+@param state Pointer to the current GameState struct.
+*/
+void wrapIntoLevel (GameState *state);
+
+/**
+@fn saveSnapshot
+@brief Copies the parts of a game that change during play into a snapshot.
+@param state The GameState to save.
+@param snapshot Pointer to the GameSnapshot to fill.
+*/
+void saveSnapshot (GameState state, GameSnapshot *snapshot);
+
+/**
+@fn restoreSnapshot
+@brief Rolls a game back (or forward) to a snapshot. The snapshot must have
+been taken of a game on the same level.
+@param state Pointer to the GameState to restore into.
+@param snapshot Pointer to the GameSnapshot to restore.
+*/
+void restoreSnapshot (GameState *state, const GameSnapshot *snapshot);
+
+/**
+@fn getMinutes
+@brief Returns the number of elapsed minutes in game time (mod 100).
+@param state The current GameState struct.
+@return The number of minutes elapsed while playing.
+*/
+int getMinutes (GameState state);
+
+/**
+@fn getSeconds
+@brief Returns the number of elapsed seconds in game time (mod 60).
+@param state The current GameState struct.
+@return The number of seconds elapsed while playing.
+*/
+int getSeconds (GameState state);
+
+/**
+@fn getAltitude
+@brief Returns the distance between the lander and the highest terrain under
+any part of it.
+@param state The current GameState struct.
+@return The distance (in pixels) between the terrain and lander.
+*/
+
+int getAltitude (GameState state);
+
+/**
+@fn getVelocity
+@brief Calculates the magnitude of the lander's velocity.
+@param state The GameState struct representing the current state of the game.
+@return The magnitude of the lander's velocity as a positive double.
+*/
+double getVelocity (GameState state);
+
+/**
+@fn min
+@brief Returns the smaller of two ints.
+@param first One of two ints to compare.
+@param second One of two ints to compare.
+@return The smaller of the two ints.
+*/
+int min (int first, int second);
+
+/**
+@fn max
+@brief Returns the larger of two ints.
+@param first One of two ints to compare.
+@param second One of two ints to compare.
+@return The larger of the two ints.
+*/
+int max (int first, int second);
+
+#endif /* LUNAR_LANDER_SIMULATION_H */
@@ -0,0 +1,450 @@
+/**
+@file Sweep.c
+@author Rob Thomas
+@brief Sweeps a grid of starting conditions over a level to map where the
+lander can land.
+@details This file contains the main function of LunarLanderSweep. It loads a
+level and flies one flight for every combination of starting X position,
+horizontal velocity, vertical velocity and thrust policy in a grid. The flights
+are shared out between a pool of threads, which all read the same terrain.
+Every flight's outcome (the landing strip landed on, a crash, or a timeout) is
+written to prefix.csv, and prefix.pgm is a heatmap with one pixel per starting
+X (across) and horizontal velocity (down) whose brightness is the fraction of
+those flights that landed.
+
+Usage: LunarLanderSweep [terrainFile] [xSteps] [velocitySteps] [threads]
+                        [outputPrefix]
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <SDL2/SDL.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "GameInitialization.h"
+#include "TerrainBuilding.h"
+#include "Simulation.h"
+#include "GameObjects.h"
+
+
+/* Default grid size and outputs. */
+#define DEFAULT_X_STEPS 900
+#define DEFAULT_VELOCITY_STEPS 41
+#define DEFAULT_PREFIX "sweep"
+
+/* The ranges of starting velocities swept. */
+#define MIN_HOR_VELOCITY -2.0
+#define MAX_HOR_VELOCITY 2.0
+#define MIN_VERT_VELOCITY -1.0
+#define MAX_VERT_VELOCITY 0.5
+
+/**
+@def MAX_SWEEP_TICKS
+@brief The number of ticks (two minutes of game time) after which a flight that
+hasn't touched down is counted as a timeout.
+*/
+#define MAX_SWEEP_TICKS (PHYSICS_TICK_RATE * 120)
+
+/**
+@def CELLS_PER_GRAB
+@brief The number of grid cells a thread takes from the shared counter at once.
+*/
+#define CELLS_PER_GRAB 256
+
+/* Flight outcomes that aren't a landing strip index. */
+#define OUTCOME_CRASHED -1
+#define OUTCOME_TIMEOUT -2
+
+/* Thrust policies. */
+#define POLICY_NONE 0
+#define POLICY_AUTOPILOT 1
+#define POLICY_CAREFUL 2
+#define NUM_POLICIES 3
+
+static const char *policyNames[NUM_POLICIES] = {"none", "autopilot",
+												"careful"};
+
+/**
+@typedef Sweep
+@brief The grid being swept and the results of its flights.
+*/
+typedef struct Sweep
+{
+	/* The level every flight flies over. */
+	Terrain *terrain;
+	Uint32 levelWidth;
+
+	/* The number of steps along each axis of the grid. */
+	int xSteps;
+	int velocitySteps;
+	long numCells;
+
+	/* The outcome and length (in ticks) of each cell's flight. */
+	Sint32 *outcomes;
+	Uint32 *ticks;
+
+	/* The next cell to be flown, guarded by lock. */
+	long nextCell;
+	pthread_mutex_t lock;
+} Sweep;
+
+/**
+@fn cellStart
+@brief Finds the starting conditions of a grid cell.
+@param sweep Pointer to the Sweep.
+@param cell The index of the cell.
+@param lander Pointer to the Lander to place.
+@param policy Buffer for the cell's thrust policy.
+*/
+static void cellStart (Sweep *sweep, long cell, Lander *lander, int *policy)
+{
+	int steps = sweep->velocitySteps;
+	int xIndex = (int)(cell % sweep->xSteps);
+	int hIndex = (int)((cell / sweep->xSteps) % steps);
+	int vIndex = (int)((cell / sweep->xSteps / steps) % steps);
+	double divisor = (steps > 1) ? (double)(steps - 1) : 1.0;
+
+	*policy = (int)(cell / ((long)(sweep->xSteps) * steps * steps));
+
+	lander->realX = TO_REAL((double)(xIndex) * sweep->levelWidth /
+							sweep->xSteps);
+	lander->realY = TO_REAL(LANDER_Y_START);
+	lander->X = REAL_TO_INT(lander->realX);
+	lander->Y = REAL_TO_INT(lander->realY);
+	lander->length = LANDER_LENGTH;
+	lander->height = LANDER_HEIGHT;
+	lander->horVelocity = TO_REAL(MIN_HOR_VELOCITY +
+		(MAX_HOR_VELOCITY - MIN_HOR_VELOCITY) * hIndex / divisor);
+	lander->vertVelocity = TO_REAL(MIN_VERT_VELOCITY +
+		(MAX_VERT_VELOCITY - MIN_VERT_VELOCITY) * vIndex / divisor);
+	lander->deltaX = 0;
+	lander->deltaY = 0;
+}
+
+/**
+@fn flyCell
+@brief Flies the flight of one grid cell.
+@param sweep Pointer to the Sweep.
+@param state Pointer to the thread's own GameState.
+@param cell The index of the cell to fly.
+*/
+static void flyCell (Sweep *sweep, GameState *state, long cell)
+{
+	int policy;
+	Uint32 tick;
+	Sint32 outcome = OUTCOME_TIMEOUT;
+
+	cellStart(sweep, cell, state->lander, &policy);
+	state->fuel = FUEL_START;
+
+	for (tick = 0; tick < MAX_SWEEP_TICKS; tick++)
+	{
+		/* The policies react as often as a player's key repeat would. */
+		if (tick % (PHYSICS_TICK_RATE / BASE_TICK_RATE) == 0)
+		{
+			if (policy == POLICY_AUTOPILOT)
+			{
+				flyAutopilot(state, 0.6, 0.3);
+			}
+			else if (policy == POLICY_CAREFUL)
+			{
+				flyAutopilot(state, 0.3, 0.1);
+			}
+		}
+
+		simulateTick(state);
+
+		int landingType = detectCollision(*state);
+
+		if (landingType == LANDING_CRASH)
+		{
+			outcome = OUTCOME_CRASHED;
+			break;
+		}
+		if (landingType == LANDING_PROPER)
+		{
+			/* Number the strip landed on by its position in the array. */
+			Flat *landed = findLandedFlat(*state);
+
+			outcome = (landed != NULL) ?
+					  (Sint32)(landed - state->terrain->flats) :
+					  (Sint32)(state->terrain->numFlats);
+			break;
+		}
+	}
+
+	sweep->outcomes[cell] = outcome;
+	sweep->ticks[cell] = tick;
+}
+
+/**
+@fn sweepWorker
+@brief Flies grid cells, a batch at a time, until there are none left.
+@param data Pointer to the Sweep.
+@return NULL.
+*/
+static void *sweepWorker (void *data)
+{
+	Sweep *sweep = (Sweep*)data;
+	GameState state;
+	Lander lander;
+
+	/* Each thread flies its own lander over the shared terrain. */
+	state.lander = &lander;
+	state.terrain = sweep->terrain;
+	state.levelWidth = sweep->levelWidth;
+	state.levelHeight = LEVEL_HEIGHT;
+	state.score = 0;
+	state.ticks = 0;
+	state.onCollision = NULL;
+	state.collisionData = NULL;
+	state.replay = NULL;
+
+	while (true)
+	{
+		long first, last;
+
+		pthread_mutex_lock(&sweep->lock);
+		first = sweep->nextCell;
+		sweep->nextCell += CELLS_PER_GRAB;
+		pthread_mutex_unlock(&sweep->lock);
+
+		if (first >= sweep->numCells)
+		{
+			break;
+		}
+
+		last = first + CELLS_PER_GRAB;
+		if (last > sweep->numCells)
+		{
+			last = sweep->numCells;
+		}
+
+		for (long cell = first; cell < last; cell++)
+		{
+			flyCell(sweep, &state, cell);
+		}
+	}
+
+	return NULL;
+}
+
+/**
+@fn writeCsv
+@brief Writes every cell's starting conditions and outcome to a CSV file.
+@param sweep Pointer to the finished Sweep.
+@param fileName The name of the file to write.
+@return True if the file was written, false otherwise.
+*/
+static bool writeCsv (Sweep *sweep, char *fileName)
+{
+	FILE *file;
+	Lander lander;
+	int policy;
+
+	if (!( file = fopen(fileName, "w") ))
+	{
+		return false;
+	}
+
+	fprintf(file, "x,horVelocity,vertVelocity,policy,outcome,strip,ticks\n");
+
+	for (long cell = 0; cell < sweep->numCells; cell++)
+	{
+		Sint32 outcome = sweep->outcomes[cell];
+
+		cellStart(sweep, cell, &lander, &policy);
+		fprintf(file, "%.2f,%.3f,%.3f,%s,%s,%d,%u\n", FROM_REAL(lander.realX),
+				FROM_REAL(lander.horVelocity), FROM_REAL(lander.vertVelocity),
+				policyNames[policy],
+				(outcome >= 0) ? "landed" :
+				(outcome == OUTCOME_CRASHED) ? "crashed" : "timeout",
+				(outcome >= 0) ? outcome : -1, sweep->ticks[cell]);
+	}
+
+	return fclose(file) == 0;
+}
+
+/**
+@fn writeHeatmap
+@brief Writes a binary PGM image with one pixel per starting X (across) and
+horizontal velocity (down), whose brightness is the fraction of flights from
+there (over every vertical velocity and policy) that landed.
+@param sweep Pointer to the finished Sweep.
+@param fileName The name of the file to write.
+@return True if the file was written, false otherwise.
+*/
+static bool writeHeatmap (Sweep *sweep, char *fileName)
+{
+	FILE *file;
+	int width = sweep->xSteps, height = sweep->velocitySteps;
+	long perPixel = sweep->numCells / ((long)(width) * height);
+	Uint32 *landed = (Uint32*)calloc((size_t)(width) * height, sizeof(Uint32));
+
+	if (landed == NULL || !( file = fopen(fileName, "wb") ))
+	{
+		free(landed);
+		return false;
+	}
+
+	/* The cell index is x + width * (h + height * (v + height * policy)),
+	   so the pixel is the cell index mod width * height. */
+	for (long cell = 0; cell < sweep->numCells; cell++)
+	{
+		if (sweep->outcomes[cell] >= 0)
+		{
+			landed[cell % ((long)(width) * height)]++;
+		}
+	}
+
+	fprintf(file, "P5\n%d %d\n255\n", width, height);
+	for (long pixel = 0; pixel < (long)(width) * height; pixel++)
+	{
+		fputc((int)((landed[pixel] * 255) / perPixel), file);
+	}
+
+	free(landed);
+
+	return fclose(file) == 0;
+}
+
+/**
+@fn main
+@brief The main function for LunarLanderSweep.
+*/
+int main(int argc, char *argv[])
+{
+	GameState state;
+	Lander lander;
+	Terrain terrain;
+	Sweep sweep;
+	char *fileName = "terrain.txt";
+	char *prefix = DEFAULT_PREFIX;
+	char csvName[256], pgmName[256];
+	long numThreads = sysconf(_SC_NPROCESSORS_ONLN);
+
+	/*** Read the command line. ***/
+	sweep.xSteps = DEFAULT_X_STEPS;
+	sweep.velocitySteps = DEFAULT_VELOCITY_STEPS;
+	if (argc >= 2)
+	{
+		fileName = argv[1];
+	}
+	if (argc >= 3)
+	{
+		sweep.xSteps = (int)(strtol(argv[2], NULL, 10));
+	}
+	if (argc >= 4)
+	{
+		sweep.velocitySteps = (int)(strtol(argv[3], NULL, 10));
+	}
+	if (argc >= 5)
+	{
+		numThreads = strtol(argv[4], NULL, 10);
+	}
+	if (argc >= 6)
+	{
+		prefix = argv[5];
+	}
+	if (numThreads < 1)
+	{
+		numThreads = 1;
+	}
+	if (sweep.xSteps < 1 || sweep.velocitySteps < 1)
+	{
+		fprintf(stderr, "The grid must have at least one step on each axis.\n");
+		return EXIT_BADFILE_FAIL;
+	}
+
+	/*** Build the terrain shared by every thread. ***/
+	terrain.vertices = NULL;
+	terrain.numVertices = 0;
+	terrain.heightMap = NULL;
+
+	initializeSimulation(&state, &lander, &terrain, fileName);
+
+	/*** Set up the grid. ***/
+	sweep.terrain = &terrain;
+	sweep.levelWidth = state.levelWidth;
+	sweep.numCells = (long)(sweep.xSteps) * sweep.velocitySteps *
+					 sweep.velocitySteps * NUM_POLICIES;
+	sweep.outcomes = (Sint32*)malloc(sweep.numCells * sizeof(Sint32));
+	sweep.ticks = (Uint32*)malloc(sweep.numCells * sizeof(Uint32));
+	sweep.nextCell = 0;
+	pthread_mutex_init(&sweep.lock, NULL);
+
+	if (sweep.outcomes == NULL || sweep.ticks == NULL)
+	{
+		fprintf(stderr, "Couldn't allocate a grid of %ld cells.\n",
+				sweep.numCells);
+		return EXIT_MAP_FAIL;
+	}
+
+	/*** Fly every cell across the thread pool. ***/
+	pthread_t *threads = (pthread_t*)malloc(numThreads * sizeof(pthread_t));
+	struct timespec start, end;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (long i = 0; i < numThreads; i++)
+	{
+		pthread_create(&threads[i], NULL, sweepWorker, &sweep);
+	}
+	for (long i = 0; i < numThreads; i++)
+	{
+		pthread_join(threads[i], NULL);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	double seconds = (end.tv_sec - start.tv_sec) +
+					 (end.tv_nsec - start.tv_nsec) / 1e9;
+
+	/*** Summarize and write out the results. ***/
+	long landings = 0, crashes = 0, timeouts = 0;
+	for (long cell = 0; cell < sweep.numCells; cell++)
+	{
+		if (sweep.outcomes[cell] >= 0)
+		{
+			landings++;
+		}
+		else if (sweep.outcomes[cell] == OUTCOME_CRASHED)
+		{
+			crashes++;
+		}
+		else
+		{
+			timeouts++;
+		}
+	}
+
+	printf("flights:   %ld (%ld threads)\n", sweep.numCells, numThreads);
+	printf("landings:  %ld\n", landings);
+	printf("crashes:   %ld\n", crashes);
+	printf("timeouts:  %ld\n", timeouts);
+	if (seconds > 0)
+	{
+		printf("flights/s: %.0f\n", sweep.numCells / seconds);
+	}
+
+	snprintf(csvName, sizeof(csvName), "%s.csv", prefix);
+	snprintf(pgmName, sizeof(pgmName), "%s.pgm", prefix);
+	if (!writeCsv(&sweep, csvName) || !writeHeatmap(&sweep, pgmName))
+	{
+		fprintf(stderr, "Problem encountered writing %s or %s.\n", csvName,
+				pgmName);
+	}
+
+	/*** Clean up. ***/
+	pthread_mutex_destroy(&sweep.lock);
+	free(threads);
+	free(sweep.outcomes);
+	free(sweep.ticks);
+	freeTerrain(&terrain);
+
+	return EXIT_SUCCESS;
+}
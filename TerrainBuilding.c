@@ -0,0 +1,1330 @@
+/**
+@file TerrainBuilding.c
+@author Rob Thomas
+@brief Contains functions for building the terrain of a Lunar Lander level.
+@details These functions read a level's vertices from a file and turn them into
+the height map and landing strips used by the game. None of them depend on a 
+window or an audio device, so they can be used by the headless simulation.
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <SDL2/SDL.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "GameObjects.h"
+#include "GameInitialization.h"
+
+#include "TerrainBuilding.h"
+#include "LevelFile.h"
+#include "LevelPack.h"
+#include "Simulation.h"
+
+
+/**
+@fn getFlatLevel
+@brief Fills in an empty height map with a flat level at Y = heightOfTerrain.
+@details Fills in an empty height map with the same value at each position. 
+The level produced by this will be completely flat and will have terrain at 
+the heightOfTerrain.
+@param heightMap An empty Uint16 array of size levelWidth.
+@param heightOfTerrain The height (in pixels) to create flat terrain at.
+0 = bottommost pixel of screen.
+*/
+void getFlatLevel(Uint16 *heightMap, Uint16 heightOfTerrain)
+{
+	for (int i = 0; i < LEVEL_WIDTH; i++)
+	{
+		heightMap[i] = heightOfTerrain;
+	}
+}
+
+/**
+@typedef RasterJob
+@brief The share of the height map given to one thread by buildHeightMap.
+*/
+typedef struct RasterJob
+{
+	Terrain *terrain;
+	Uint32 first;
+	Uint32 last;
+} RasterJob;
+
+/**
+@fn rasterizeJob
+@brief Thread entry point that rasterizes one RasterJob.
+@param data Pointer to the RasterJob.
+@return NULL.
+*/
+static void *rasterizeJob (void *data)
+{
+	RasterJob *job = (RasterJob*)(data);
+
+	rasterizeHeightMap(job->terrain->heightMap, job->terrain->vertices,
+					   job->terrain->numVertices, job->first, job->last);
+
+	return NULL;
+}
+
+/**
+@fn buildHeightMap
+@brief Builds the terrain height map from an input file of vertices.
+@details This function dynamically constructs the terrain height map from an 
+input file containing the X and Y coordinates of each vertex. The vertices are
+line-delineated and the X and Y coordinates are separated by a single space.
+The array of Vertexes and the height map are dynamically allocated and MUST BE
+FREED later (by freeTerrain).
+@param fileName The file of vertices to build the height map from.
+@param terrain Pointer to the Terrain to read the vertices into and build the
+height map of.
+@param levelWidth Pointer to the width (in pixels) of the level whose height
+map is being built. Widened if the vertices reach further.
+*/
+void buildHeightMap (char *fileName, Terrain *terrain, Uint32 *levelWidth)
+{
+	/*** Read in the vertices from the input file. ***/
+	readVertexList(fileName, terrain, levelWidth);
+
+	rasterizeTerrain(terrain, *levelWidth);
+}
+
+/**
+@fn rasterizeTerrain
+@brief Allocates a terrain's height map and fills it in from its Vertexes.
+@details The height map MUST BE FREED later (by freeTerrain). Every column's
+height is worked out on its own (see rasterizeHeightMap), so a wide level is
+split into runs of columns that are rasterized by separate threads.
+@param terrain Pointer to the Terrain whose Vertex array has been read.
+@param levelWidth The width (in pixels) of the level.
+*/
+void rasterizeTerrain (Terrain *terrain, Uint32 levelWidth)
+{
+	/* Make sure the first Vertex actually has X = 0. */
+	if (terrain->vertices[0].X != 0)
+	{
+		fprintf(stderr, "Error encountered building height map - first Vertex has non-zero X.\n");
+		exit(EXIT_MAP_FAIL);
+	}
+
+	/*** Allocate the height map, which is too large for the stack in wide
+	     levels. ***/
+	terrain->heightMap = (Uint16*)malloc(levelWidth * sizeof(Uint16));
+	if (terrain->heightMap == NULL)
+	{
+		fprintf(stderr, "Couldn't allocate the height map.\n");
+		exit(EXIT_MAP_FAIL);
+	}
+
+	/*** Share the columns out between as many threads as are worth
+	     starting, one per processor at most. ***/
+	long numThreads = sysconf(_SC_NPROCESSORS_ONLN);
+
+	numThreads = min(numThreads, levelWidth / RASTER_THREAD_COLUMNS);
+	numThreads = max(1, min(numThreads, MAX_RASTER_THREADS));
+
+	if (numThreads == 1)
+	{
+		rasterizeHeightMap(terrain->heightMap, terrain->vertices,
+						   terrain->numVertices, 0, levelWidth - 1);
+		return;
+	}
+
+	RasterJob jobs[MAX_RASTER_THREADS];
+	pthread_t threads[MAX_RASTER_THREADS];
+
+	for (long i = 0; i < numThreads; i++)
+	{
+		jobs[i].terrain = terrain;
+		jobs[i].first = (Uint32)((Uint64)(levelWidth) * i / numThreads);
+		jobs[i].last = (Uint32)((Uint64)(levelWidth) * (i + 1) / numThreads)
+					   - 1;
+	}
+
+	/* This thread takes the first job itself. If a thread can't be started,
+	   its job is done here too. */
+	for (long i = 1; i < numThreads; i++)
+	{
+		if (pthread_create(&threads[i], NULL, rasterizeJob, &jobs[i]) != 0)
+		{
+			rasterizeJob(&jobs[i]);
+			jobs[i].terrain = NULL;
+		}
+	}
+
+	rasterizeJob(&jobs[0]);
+
+	for (long i = 1; i < numThreads; i++)
+	{
+		if (jobs[i].terrain != NULL)
+		{
+			pthread_join(threads[i], NULL);
+		}
+	}
+}
+
+/**
+@fn rasterizeSegment
+@brief Fills in the heights of some of the columns under the line between two
+Vertexes, rounding heights up.
+@details Each height is the exact value Y0 + ceil((Y1 - Y0) * (x - X0) /
+(X1 - X0)). Rather than dividing at every column, the quotient and remainder
+of the numerator are stepped along in integers, so no error builds up however
+long the line.
+@param heightMap The height map to fill in.
+@param from The Vertex at the left end of the line.
+@param to The Vertex at the right end of the line. Its X must be greater than
+from's.
+@param first The first column to fill in (greater than from's X).
+@param last The last column to fill in (less than to's X).
+*/
+static void rasterizeSegment (Uint16 *heightMap, const Vertex *from,
+							  const Vertex *to, Uint32 first, Uint32 last)
+{
+	Sint64 width = to->X - from->X;
+	Sint64 rise = to->Y - from->Y;
+
+	/* The numerator (rise * (x - X0)) as quotient and remainder of width. */
+	Sint64 numerator = rise * (Sint64)(first - from->X);
+	Sint64 quotient = numerator / width;
+	Sint64 remainder = numerator % width;
+
+	if (remainder < 0)
+	{
+		quotient--;
+		remainder += width;
+	}
+
+	/* The step in the numerator from one column to the next, likewise. */
+	Sint64 stepQuotient = rise / width;
+	Sint64 stepRemainder = rise % width;
+
+	if (stepRemainder < 0)
+	{
+		stepQuotient--;
+		stepRemainder += width;
+	}
+
+	for (Uint32 x = first; x <= last; x++)
+	{
+		heightMap[x] = (Uint16)(from->Y + quotient + (remainder > 0));
+
+		quotient += stepQuotient;
+		remainder += stepRemainder;
+		if (remainder >= width)
+		{
+			quotient++;
+			remainder -= width;
+		}
+	}
+}
+
+/**
+@fn rasterizeHeightMap
+@brief Fills in a run of columns of a height map from an array of Vertexes.
+@details A column with Vertexes at it is as high as the highest of them (so
+a vertical edge rises to its top). Every other column lies under the line
+between the Vertexes either side of it, and is rasterized from that line alone
+(see rasterizeSegment). A column's height therefore doesn't depend on any
+other column, and runs of columns can be filled in any order or at once.
+@param heightMap The height map to fill in.
+@param vertices The array of Vertexes, sorted by X.
+@param numVertices The number of Vertexes in the array.
+@param first The first column to fill in. There must be a Vertex at or to the
+left of it.
+@param last The last column to fill in. Columns past the last Vertex are as
+high as it is.
+*/
+void rasterizeHeightMap (Uint16 *heightMap, const Vertex *vertices,
+						 Uint32 numVertices, Uint32 first, Uint32 last)
+{
+	/*** Binary search for the first Vertex to the right of first. ***/
+	Uint32 low = 0, high = numVertices;
+
+	while (low < high)
+	{
+		Uint32 middle = low + (high - low) / 2;
+
+		if ((Uint32)(vertices[middle].X) <= first)
+		{
+			low = middle + 1;
+		}
+		else
+		{
+			high = middle;
+		}
+	}
+
+	/*** Walk right from there, alternating between columns at Vertexes and
+	     the columns under the lines between them. ***/
+	Uint32 next = low;
+	Uint32 x = first;
+
+	while (x <= last)
+	{
+		const Vertex *current = &vertices[next - 1];
+
+		if ((Uint32)(current->X) == x)
+		{
+			/* Every Vertex at this column comes just before next. */
+			int highest = current->Y;
+
+			for (Uint32 i = next - 1; i > 0 && vertices[i - 1].X == current->X;
+				 i--)
+			{
+				highest = max(highest, vertices[i - 1].Y);
+			}
+
+			heightMap[x++] = (Uint16)(highest);
+		}
+		else if (next == numVertices)
+		{
+			/* Past the last Vertex. */
+			heightMap[x++] = (Uint16)(current->Y);
+			continue;
+		}
+		else
+		{
+			/* Under the line to the next Vertex. */
+			Uint32 end = min(last, vertices[next].X - 1);
+
+			rasterizeSegment(heightMap, current, &vertices[next], x, end);
+			x = end + 1;
+		}
+
+		/* Move past every Vertex at or before the next column. */
+		while (next < numVertices && (Uint32)(vertices[next].X) <= x)
+		{
+			next++;
+		}
+	}
+}
+
+/**
+@fn markTerrainChanged
+@brief Notes that a run of a terrain's columns has changed since it was built,
+so that anything drawn from them is drawn again.
+@param terrain Pointer to the Terrain that changed.
+@param first The first column that changed.
+@param last The last column that changed.
+*/
+void markTerrainChanged (Terrain *terrain, Uint32 first, Uint32 last)
+{
+	if (terrain->changedFirst > terrain->changedLast)
+	{
+		terrain->changedFirst = first;
+		terrain->changedLast = last;
+	}
+	else
+	{
+		terrain->changedFirst = min(terrain->changedFirst, first);
+		terrain->changedLast = max(terrain->changedLast, last);
+	}
+}
+
+/**
+@fn setParseError
+@brief Fills in a ParseError.
+@param error Pointer to the ParseError to fill in.
+@param code The PARSE_* code of the error.
+@param message A description of the error.
+@param line The line the error was found on (0 if not on a line).
+@param column The column the error was found at (0 if not on a line).
+@return False, so that a parser can return the result.
+*/
+static bool setParseError (ParseError *error, int code, const char *message,
+						   Uint32 line, Uint32 column)
+{
+	error->code = code;
+	error->message = message;
+	error->line = line;
+	error->column = column;
+
+	return false;
+}
+
+/**
+@fn readWholeFile
+@brief Reads a file into a single buffer, with a terminating 0 byte after its
+contents.
+@param fileName The name of the file to read.
+@param size Buffer for the size of the file (in bytes).
+@return Pointer to the buffer (to be freed by the caller), or NULL if the file
+couldn't be opened or read.
+*/
+static char *readWholeFile (char *fileName, size_t *size)
+{
+	FILE *file;
+	char *buffer = NULL;
+	long length;
+
+	if (!( file = fopen(fileName, "rb") ))
+	{
+		return NULL;
+	}
+
+	if (fseek(file, 0, SEEK_END) == 0 && (length = ftell(file)) >= 0 &&
+		fseek(file, 0, SEEK_SET) == 0 &&
+		( buffer = (char*)malloc((size_t)(length) + 1) ))
+	{
+		*size = fread(buffer, 1, (size_t)(length), file);
+		buffer[*size] = '\0';
+	}
+
+	fclose(file);
+
+	return buffer;
+}
+
+/**
+@fn parseNumber
+@brief Parses a decimal integer (with an optional sign) from a line of text.
+@param text Pointer to the text, advanced past the number.
+@param value Buffer for the number.
+@return True if a number was found and fits in an int, false otherwise.
+*/
+static bool parseNumber (const char **text, int *value)
+{
+	const char *current = *text;
+	bool negative = false;
+	long long number = 0;
+
+	if (*current == '-' || *current == '+')
+	{
+		negative = (*current == '-');
+		current++;
+	}
+
+	if (*current < '0' || *current > '9')
+	{
+		return false;
+	}
+
+	while (*current >= '0' && *current <= '9')
+	{
+		number = number * 10 + (*current - '0');
+		if (number > 2147483647LL)
+		{
+			return false;
+		}
+		current++;
+	}
+
+	*value = (int)(negative ? -number : number);
+	*text = current;
+
+	return true;
+}
+
+/**
+@fn parseVertexText
+@brief Parses a list of vertices describing the terrain from text in memory
+and stores them in the terrain's array of Vertexes, without exiting on errors.
+@details The text is first scanned for line breaks (with memchr) to size the
+Vertex array, which is then allocated once with room for a Vertex on every
+line. The lines are then parsed by hand in a second pass, which is many times
+faster than fscanf. Each line holds the X and Y of a vertex separated by spaces
+or tabs. Blank lines are skipped.
+@param text The text to parse, followed by a terminating 0 byte.
+@param size The length of the text (in bytes, not counting the 0 byte).
+@param terrain Pointer to the Terrain to fill in. Its Vertex array is
+allocated here, and left NULL if there is an error.
+@param levelWidth Pointer to the width of the level (in pixels). If the last
+vertex is further right than this, the level is widened to end at it.
+@param error Pointer to a ParseError, filled in if the text can't be used.
+@return True if the vertices were read, false otherwise.
+*/
+bool parseVertexText (const char *text, size_t size, Terrain *terrain,
+					  Uint32 *levelWidth, ParseError *error)
+{
+	int prevX = -1;
+
+	terrain->vertices = NULL;
+	terrain->numVertices = 0;
+
+	/*** Allocate one Vertex for every line, plus one each for the Vertexes
+	     that may be added at the start and end of the level. ***/
+	Uint32 capacity = 3;
+	for (const char *newline = text;
+		 ( newline = memchr(newline, '\n', size - (newline - text)) );
+		 newline++)
+	{
+		capacity++;
+	}
+
+	if (!( terrain->vertices = (Vertex*)malloc(capacity * sizeof(Vertex)) ))
+	{
+		return setParseError(error, PARSE_MEMORY_FAIL,
+							 "Couldn't allocate the Vertex array", 0, 0);
+	}
+
+	/*** Parse and check each line. A bad vertex is one whose x is less than
+	     the previous vertex's, whose x is less than 0 or too large, or whose
+	     y is less than 0. ***/
+	const char *current = text;
+	const char *end = text + size;
+	Uint32 line = 1;
+
+	while (current < end)
+	{
+		const char *lineStart = current;
+		const char *xStart, *yStart;
+		int X, Y;
+
+		while (*current == ' ' || *current == '\t' || *current == '\r')
+		{
+			current++;
+		}
+
+		/* Skip blank lines. */
+		if (*current == '\n' || current == end)
+		{
+			current++;
+			line++;
+			continue;
+		}
+
+		xStart = current;
+		if (!parseNumber(&current, &X))
+		{
+			break;
+		}
+		while (*current == ' ' || *current == '\t')
+		{
+			current++;
+		}
+		yStart = current;
+		if (!parseNumber(&current, &Y))
+		{
+			current = yStart;
+			break;
+		}
+		while (*current == ' ' || *current == '\t' || *current == '\r')
+		{
+			current++;
+		}
+		if (*current != '\n' && current != end)
+		{
+			break;
+		}
+
+		/* Catch negative or too large X or Y. */
+		if (X < 0 || Y < 0 || X >= MAX_LEVEL_WIDTH || Y > 65535)
+		{
+			freeVertexArray(terrain);
+			return setParseError(error, PARSE_BAD_VERTEX,
+								 (X < 0 || X >= MAX_LEVEL_WIDTH) ?
+								 "Vertex X out of range" :
+								 "Vertex Y out of range", line,
+								 (Uint32)(((X < 0 || X >= MAX_LEVEL_WIDTH) ?
+										   xStart : yStart) - lineStart) + 1);
+		}
+		/* Catch an X that is less than the previous X. */
+		if (X < prevX)
+		{
+			freeVertexArray(terrain);
+			return setParseError(error, PARSE_BAD_VERTEX,
+								 "Vertex earlier than previous one", line,
+								 (Uint32)(xStart - lineStart) + 1);
+		}
+
+		/* If X of the first Vertex given isn't 0, then begin the array with a
+		   Vertex at X = 0 and Y = 0. */
+		if (prevX == -1 && X != 0)
+		{
+			terrain->vertices[terrain->numVertices].X = 0;
+			terrain->vertices[terrain->numVertices].Y = 0;
+			terrain->numVertices++;
+		}
+
+		terrain->vertices[terrain->numVertices].X = X;
+		terrain->vertices[terrain->numVertices].Y = Y;
+		terrain->numVertices++;
+		prevX = X;
+
+		current++;
+		line++;
+	}
+
+	/*** Anything left over is a line that couldn't be parsed. ***/
+	if (current < end)
+	{
+		const char *lineStart = current;
+
+		while (lineStart > text && lineStart[-1] != '\n')
+		{
+			lineStart--;
+		}
+
+		freeVertexArray(terrain);
+		return setParseError(error, PARSE_BAD_SYNTAX,
+							 "Expected two whole numbers", line,
+							 (Uint32)(current - lineStart) + 1);
+	}
+
+	/*** Check if no Vertexes were read. If so, an empty file was given. ***/
+	if (terrain->numVertices == 0)
+	{
+		freeVertexArray(terrain);
+		return setParseError(error, PARSE_EMPTY_FILE, "File given was empty",
+							 0, 0);
+	}
+
+	/* Widen the level if its last Vertex is past the right edge. */
+	Vertex *last = &terrain->vertices[terrain->numVertices - 1];
+
+	if ((Uint32)(last->X) >= *levelWidth)
+	{
+		*levelWidth = last->X + 1;
+	}
+
+	/* If the last Vertex's X is not levelWidth - 1 or Y is not the same as the
+	   first Vertex's Y, then add a Vertex with the appropriate values. */
+	if (last->X != *levelWidth - 1 || last->Y != terrain->vertices[0].Y)
+	{
+		terrain->vertices[terrain->numVertices].X = *levelWidth - 1;
+		terrain->vertices[terrain->numVertices].Y = terrain->vertices[0].Y;
+		terrain->numVertices++;
+	}
+
+	error->code = PARSE_OK;
+
+	return true;
+}
+
+/**
+@fn parseVertexList
+@brief Reads in the list of vertices describing the terrain from an input file
+and stores them in the terrain's array of Vertexes, without exiting on errors.
+@details The whole file is read into one buffer and parsed by parseVertexText.
+@param fileName The name of the file to read from.
+@param terrain Pointer to the Terrain to fill in. Its Vertex array is
+allocated here, and left NULL if there is an error.
+@param levelWidth Pointer to the width of the level (in pixels). If the last
+vertex is further right than this, the level is widened to end at it.
+@param error Pointer to a ParseError, filled in if the file can't be used.
+@return True if the vertices were read, false otherwise.
+*/
+bool parseVertexList (char *fileName, Terrain *terrain, Uint32 *levelWidth,
+					  ParseError *error)
+{
+	size_t size;
+	char *buffer;
+	bool parsed;
+
+	terrain->vertices = NULL;
+	terrain->numVertices = 0;
+
+	/*** Read the whole file at once. ***/
+	if (!( buffer = readWholeFile(fileName, &size) ))
+	{
+		return setParseError(error, PARSE_FOPEN_FAIL,
+							 "Problem encountered opening file", 0, 0);
+	}
+
+	parsed = parseVertexText(buffer, size, terrain, levelWidth, error);
+	free(buffer);
+
+	return parsed;
+}
+
+/**
+@fn printParseError
+@brief Reports why a file of vertices couldn't be used.
+@param fileName The name of the file.
+@param error Pointer to the ParseError filled in by parseVertexList.
+*/
+void printParseError (char *fileName, ParseError *error)
+{
+	if (error->line > 0)
+	{
+		fprintf(stderr, "%s (line %u, column %u).\nfileName: %s\n",
+				error->message, error->line, error->column, fileName);
+	}
+	else
+	{
+		fprintf(stderr, "%s.\nfileName: %s\n", error->message, fileName);
+	}
+}
+
+/**
+@fn readVertexList
+@brief Reads in the list of vertices describing the terrain from an input file
+and stores them in the terrain's array of Vertexes. Exits if the file can't be
+read or holds a bad vertex.
+@param fileName The name of the file to read from.
+@param terrain Pointer to the Terrain to fill in. Its Vertex array is
+allocated here.
+@param levelWidth Pointer to the width of the level (in pixels). If the last
+vertex is further right than this, the level is widened to end at it.
+*/
+void readVertexList(char* fileName, Terrain *terrain, Uint32 *levelWidth)
+{
+	ParseError error;
+
+	if (parseVertexList(fileName, terrain, levelWidth, &error))
+	{
+		return;
+	}
+
+	printParseError(fileName, &error);
+
+	switch (error.code)
+	{
+		case PARSE_FOPEN_FAIL:
+			exit(EXIT_FOPEN_FAIL);
+		case PARSE_EMPTY_FILE:
+			exit(EXIT_EMPTYFILE_FAIL);
+		case PARSE_MEMORY_FAIL:
+			exit(EXIT_MAP_FAIL);
+		default:
+			exit(EXIT_BADFILE_FAIL);
+	}
+}
+
+/**
+@fn getScoreModifier
+@brief Finds the score modifier of a landing strip from its length. Shorter
+strips are worth more, down to FLAT_LAND_BASE pixels.
+@param length The length of the strip (in pixels).
+@return The strip's score modifier, from 1 to TOP_SCORE_TIER, or 0 if the strip
+is too short to land on (or far too long).
+*/
+Uint16 getScoreModifier (int length)
+{
+	/* Worked out in a Uint16, as the Flat holds it: a very long strip wraps
+	   around past TOP_SCORE_TIER and so is worth nothing. */
+	Uint16 scoreModifier;
+
+	if (length < FLAT_LAND_BASE)
+	{
+		scoreModifier = TOP_SCORE_TIER + 1;
+	}
+	else
+	{
+		scoreModifier = TOP_SCORE_TIER - 
+						((length - FLAT_LAND_BASE) / FLAT_LAND_INCREMENT);
+	}
+
+	/* Prevent score modifiers below 1. */
+	if (scoreModifier < 1)
+	{
+		scoreModifier = 1;
+	}
+
+	/* Set Flats that are too short to have a score modifier 0. */
+	if (scoreModifier > TOP_SCORE_TIER)
+	{
+		scoreModifier = 0;
+	}
+
+	return scoreModifier;
+}
+
+/**
+@fn findStripsBetween
+@brief Finds the flat strips of terrain among a run of Vertexes.
+@details Scrolls along the Vertexes until two adjacent ones have the same Y
+value, then on to the last Vertex at that height, which ends the strip.
+@param vertices The array of Vertexes.
+@param first The index of the first Vertex to search.
+@param last The index of the last Vertex to search. No strip may continue past
+it (or start before first).
+@param strips Buffer for the strips found, with room for one per Vertex.
+@return The number of strips found.
+*/
+Uint32 findStripsBetween (const Vertex *vertices, Uint32 first, Uint32 last,
+						  Flat *strips)
+{
+	Uint32 numStrips = 0;
+	Uint32 current = first;
+
+	while (current < last)
+	{
+		if (vertices[current].Y == vertices[current + 1].Y)
+		{
+			Uint32 end = current + 1;
+			Flat *strip = &strips[numStrips++];
+
+			/*** Scroll along to the last Vertex at the same height. ***/
+			while (end < last && vertices[end + 1].Y == vertices[end].Y)
+			{
+				end++;
+			}
+
+			/*** Note where the strip is, its length and its score
+			     modifier. ***/
+			strip->X = vertices[current].X;
+			strip->Y = vertices[current].Y;
+			strip->length = (vertices[end].X - vertices[current].X);
+			strip->scoreModifier = getScoreModifier(strip->length);
+
+			current = end;
+		}
+		else
+		{
+			current++;
+		}
+	}
+
+	return numStrips;
+}
+
+/**
+@fn findLandingStrips
+@brief Finds vertices that define flat strips of terrain at which the lander can
+safely land. 
+@details Fills an array of Flat structs indicating where to display the
+flashing score indicator, then builds the table used to find the strip under
+any column.
+@param state The already initialized GameState struct.
+*/
+void findLandingStrips (GameState *state)
+{
+	Terrain *terrain = state->terrain;
+	Flat *flats;
+
+	if (terrain->numVertices == 0)
+	{
+		fprintf(stderr, "Vertex array found to be empty while finding landing strips.\n");
+		return;
+	}
+
+	/*** There are fewer strips than Vertexes, so find them into an array of
+	     that size, then give back the rest. ***/
+	if (!( flats = (Flat*)malloc(terrain->numVertices * sizeof(Flat)) ))
+	{
+		fprintf(stderr, "Couldn't allocate the Flat array.\n");
+		exit(EXIT_MAP_FAIL);
+	}
+
+	terrain->numFlats = findStripsBetween(terrain->vertices, 0,
+										  terrain->numVertices - 1, flats);
+	terrain->flats = (Flat*)realloc(flats, (terrain->numFlats + 1) *
+										   sizeof(Flat));
+
+	buildFlatTable(terrain, state->levelWidth);
+}
+
+/**
+@fn buildFlatTable
+@brief Builds the table of the Flat at or after each column of a terrain.
+@param terrain Pointer to the Terrain whose Flat array has been built.
+@param levelWidth The width of the level (in pixels).
+*/
+void buildFlatTable (Terrain *terrain, Uint32 levelWidth)
+{
+	if (!( terrain->flatTable = (Uint32*)malloc(levelWidth * sizeof(Uint32)) ))
+	{
+		fprintf(stderr, "Couldn't allocate the Flat table.\n");
+		exit(EXIT_MAP_FAIL);
+	}
+
+	updateFlatTable(terrain, 0, levelWidth - 1);
+}
+
+/**
+@fn updateFlatTable
+@brief Brings part of a terrain's Flat table up to date after its Flat array
+has changed.
+@details The Flats don't overlap, so the columns they end at rise along with
+their X. The first Flat ending at or after the first column is found by binary
+search, and each later column moves it on as needed.
+@param terrain Pointer to the Terrain, with its table allocated.
+@param first The first column to update.
+@param last The last column to update.
+*/
+void updateFlatTable (Terrain *terrain, Uint32 first, Uint32 last)
+{
+	Flat *flats = terrain->flats;
+	Uint32 low = 0, high = terrain->numFlats;
+
+	while (low < high)
+	{
+		Uint32 middle = low + (high - low) / 2;
+
+		if ((Sint64)(flats[middle].X) + flats[middle].length < (Sint64)(first))
+		{
+			low = middle + 1;
+		}
+		else
+		{
+			high = middle;
+		}
+	}
+
+	for (Uint32 x = first; x <= last; x++)
+	{
+		while (low < terrain->numFlats &&
+			   (Sint64)(flats[low].X) + flats[low].length < (Sint64)(x))
+		{
+			low++;
+		}
+
+		terrain->flatTable[x] = low;
+	}
+}
+
+
+/**
+@fn countIndexLevels
+@brief Finds the number of rows in the sparse tables of a HeightIndex.
+@param numBlocks The number of blocks indexed.
+@return The number of rows (runs of 1, 2, 4... blocks) needed.
+*/
+static int countIndexLevels (int numBlocks)
+{
+	int numLevels = 1;
+
+	while ((1 << numLevels) <= numBlocks)
+	{
+		numLevels++;
+	}
+
+	return numLevels;
+}
+
+/**
+@fn countMipLevels
+@brief Finds the number of rows in the min/max pyramid of a HeightIndex.
+@param levelWidth The width of the level (in pixels).
+@return The number of rows, counting the height map itself as row 0. The top
+row has a single entry.
+*/
+static Uint32 countMipLevels (Uint32 levelWidth)
+{
+	Uint32 numMipLevels = 1;
+
+	while (((levelWidth - 1) >> (numMipLevels - 1)) > 0)
+	{
+		numMipLevels++;
+	}
+
+	return numMipLevels;
+}
+
+/**
+@fn countMipEntries
+@brief Finds the number of entries in every row of the min/max pyramid of a
+HeightIndex, after the height map itself.
+@param levelWidth The width of the level (in pixels).
+@return The number of entries.
+*/
+static size_t countMipEntries (Uint32 levelWidth)
+{
+	Uint32 numMipLevels = countMipLevels(levelWidth);
+	size_t numEntries = 0;
+
+	for (Uint32 k = 1; k < numMipLevels; k++)
+	{
+		numEntries += ((levelWidth - 1) >> k) + 1;
+	}
+
+	return numEntries;
+}
+
+/**
+@fn getHeightIndexSize
+@brief Finds the size of the single block holding a HeightIndex's arrays.
+@param levelWidth The width of the level (in pixels).
+@return The size of the block (in bytes).
+*/
+size_t getHeightIndexSize (Uint32 levelWidth)
+{
+	size_t numBlocks = (levelWidth + HEIGHT_BLOCK_SIZE - 1) / HEIGHT_BLOCK_SIZE;
+	size_t numLevels = countIndexLevels((int)(numBlocks));
+
+	return (4 * (size_t)(levelWidth) + 2 * numLevels * numBlocks +
+			2 * countMipEntries(levelWidth)) * sizeof(Uint16) +
+		   (numBlocks + 1) * sizeof(Uint8);
+}
+
+/**
+@fn placeHeightIndex
+@brief Points a HeightIndex's arrays into a block of getHeightIndexSize bytes,
+whether freshly allocated or loaded from a level file.
+@param index Pointer to the HeightIndex to fill in.
+@param data The block holding the arrays.
+@param levelWidth The width of the level (in pixels).
+*/
+void placeHeightIndex (HeightIndex *index, void *data, Uint32 levelWidth)
+{
+	int numBlocks = (levelWidth + HEIGHT_BLOCK_SIZE - 1) / HEIGHT_BLOCK_SIZE;
+	int numLevels = countIndexLevels(numBlocks);
+
+	index->levelWidth = levelWidth;
+	index->numBlocks = numBlocks;
+	index->prefixMax = (Uint16*)(data);
+	index->prefixMin = index->prefixMax + levelWidth;
+	index->suffixMax = index->prefixMin + levelWidth;
+	index->suffixMin = index->suffixMax + levelWidth;
+	index->blockMax = index->suffixMin + levelWidth;
+	index->blockMin = index->blockMax + numLevels * numBlocks;
+
+	/*** The rows of the pyramid follow, all of the highest then all of the
+	     lowest. ***/
+	Uint16 *mipMax = index->blockMin + numLevels * numBlocks;
+	Uint16 *mipMin = mipMax + countMipEntries(levelWidth);
+
+	index->numMipLevels = countMipLevels(levelWidth);
+	index->mipMax[0] = NULL;
+	index->mipMin[0] = NULL;
+	for (Uint32 k = 1; k < index->numMipLevels; k++)
+	{
+		index->mipMax[k] = mipMax;
+		index->mipMin[k] = mipMin;
+		mipMax += ((levelWidth - 1) >> k) + 1;
+		mipMin += ((levelWidth - 1) >> k) + 1;
+	}
+
+	index->floorLog2 = (Uint8*)(mipMin);
+}
+
+/**
+@fn buildHeightIndex
+@brief Builds the range index and min/max pyramid over a terrain's finished
+height map.
+@details All of the index's arrays are allocated as one block, pointed to by
+prefixMax.
+@param terrain Pointer to the Terrain whose height map has been built.
+@param levelWidth The width of the level (in pixels).
+*/
+void buildHeightIndex (Terrain *terrain, Uint32 levelWidth)
+{
+	HeightIndex *index = &terrain->heightIndex;
+	int numBlocks = (levelWidth + HEIGHT_BLOCK_SIZE - 1) / HEIGHT_BLOCK_SIZE;
+
+	/*** Allocate every array at once. ***/
+	void *data = malloc(getHeightIndexSize(levelWidth));
+
+	if (data == NULL)
+	{
+		fprintf(stderr, "Couldn't allocate the height index.\n");
+		exit(EXIT_MAP_FAIL);
+	}
+
+	placeHeightIndex(index, data, levelWidth);
+	updateHeightIndex(terrain, 0, levelWidth - 1);
+
+	index->floorLog2[0] = 0;
+	for (int n = 1; n <= numBlocks; n++)
+	{
+		index->floorLog2[n] = index->floorLog2[n / 2] + (n > 1);
+	}
+}
+
+/**
+@fn updateHeightIndex
+@brief Brings a terrain's range index up to date after some of its height map
+has changed.
+@details Only the blocks holding the changed columns, the runs of blocks that
+cover them and the entries of the pyramid over them are recomputed.
+@param terrain Pointer to the Terrain, with its index allocated.
+@param first The first column that changed.
+@param last The last column that changed.
+*/
+void updateHeightIndex (Terrain *terrain, Uint32 first, Uint32 last)
+{
+	HeightIndex *index = &terrain->heightIndex;
+	Uint16 *heightMap = terrain->heightMap;
+	int levelWidth = index->levelWidth;
+	int numBlocks = index->numBlocks;
+	int numLevels = countIndexLevels(numBlocks);
+	int firstBlock = first / HEIGHT_BLOCK_SIZE;
+	int lastBlock = last / HEIGHT_BLOCK_SIZE;
+
+	/*** Fill the prefix and suffix extremes of each block, and the extremes
+	     of each single block (the first row of the sparse tables). ***/
+	for (int block = firstBlock; block <= lastBlock; block++)
+	{
+		int start = block * HEIGHT_BLOCK_SIZE;
+		int end = min(start + HEIGHT_BLOCK_SIZE, levelWidth) - 1;
+
+		index->prefixMax[start] = heightMap[start];
+		index->prefixMin[start] = heightMap[start];
+		for (int x = start + 1; x <= end; x++)
+		{
+			index->prefixMax[x] = max(index->prefixMax[x - 1], heightMap[x]);
+			index->prefixMin[x] = min(index->prefixMin[x - 1], heightMap[x]);
+		}
+
+		index->suffixMax[end] = heightMap[end];
+		index->suffixMin[end] = heightMap[end];
+		for (int x = end - 1; x >= start; x--)
+		{
+			index->suffixMax[x] = max(index->suffixMax[x + 1], heightMap[x]);
+			index->suffixMin[x] = min(index->suffixMin[x + 1], heightMap[x]);
+		}
+
+		index->blockMax[block] = index->prefixMax[end];
+		index->blockMin[block] = index->prefixMin[end];
+	}
+
+	/*** Each row of the sparse tables combines two runs from the row below.
+	     Only the runs that overlap the changed blocks are affected. ***/
+	for (int level = 1; level < numLevels; level++)
+	{
+		Uint16 *maxRow = index->blockMax + level * numBlocks;
+		Uint16 *minRow = index->blockMin + level * numBlocks;
+		int half = 1 << (level - 1);
+		int start = max(0, firstBlock - (1 << level) + 1);
+		int end = min(lastBlock, numBlocks - (1 << level));
+
+		for (int block = start; block <= end; block++)
+		{
+			maxRow[block] = max(maxRow[block - numBlocks],
+								maxRow[block - numBlocks + half]);
+			minRow[block] = min(minRow[block - numBlocks],
+								minRow[block - numBlocks + half]);
+		}
+	}
+	/*** Each row of the pyramid combines pairs of entries from the row
+	     below, the first row pairs of columns. Only the entries over the
+	     changed columns are affected. ***/
+	for (Uint32 k = 1; k < index->numMipLevels; k++)
+	{
+		const Uint16 *belowMax = (k > 1) ? index->mipMax[k - 1] : heightMap;
+		const Uint16 *belowMin = (k > 1) ? index->mipMin[k - 1] : heightMap;
+		Uint32 belowLast = (levelWidth - 1) >> (k - 1);
+
+		for (Uint32 entry = first >> k; entry <= (last >> k); entry++)
+		{
+			Uint32 left = 2 * entry;
+			Uint32 right = min(left + 1, belowLast);
+
+			index->mipMax[k][entry] = max(belowMax[left], belowMax[right]);
+			index->mipMin[k][entry] = min(belowMin[left], belowMin[right]);
+		}
+	}
+}
+
+/**
+@fn findTerrainAbove
+@brief Finds the first column in a range whose terrain is above a height.
+@details Climbs the index's min/max pyramid from each column for as long as
+the runs starting there lie wholly at or below the height, and skips past the
+largest such run.
+@param terrain Pointer to the Terrain, with its index built.
+@param first The first column of the range.
+@param last The last column of the range (not past the right edge).
+@param height The height (in pixels) to look above.
+@return The first column whose height is greater than height, or last + 1 if
+there is none.
+*/
+Uint32 findTerrainAbove (Terrain *terrain, Uint32 first, Uint32 last,
+						 Uint16 height)
+{
+	HeightIndex *index = &terrain->heightIndex;
+	Uint32 column = first;
+
+	while (column <= last)
+	{
+		if (terrain->heightMap[column] > height)
+		{
+			return column;
+		}
+
+		Uint32 k = 0;
+
+		while (k + 1 < index->numMipLevels &&
+			   (column & ((2u << k) - 1)) == 0 &&
+			   index->mipMax[k + 1][column >> (k + 1)] <= height)
+		{
+			k++;
+		}
+
+		column += 1u << k;
+	}
+
+	return last + 1;
+}
+
+/**
+@fn freeHeightIndex
+@brief Frees the arrays of a terrain's range index.
+@param terrain Pointer to the Terrain.
+*/
+void freeHeightIndex (Terrain *terrain)
+{
+	free(terrain->heightIndex.prefixMax);
+	terrain->heightIndex.prefixMax = NULL;
+}
+
+/**
+@fn queryHeightIndex
+@brief Finds the highest or lowest terrain over columns first to last (which
+must not wrap).
+@param terrain Pointer to the Terrain, with its index built.
+@param first The first column of the range.
+@param last The last column of the range.
+@param highest True to find the highest terrain, false for the lowest.
+@return The greatest or least height in the range.
+*/
+static Uint16 queryHeightIndex (Terrain *terrain, int first, int last,
+								bool highest)
+{
+	HeightIndex *index = &terrain->heightIndex;
+	int firstBlock = first / HEIGHT_BLOCK_SIZE;
+	int lastBlock = last / HEIGHT_BLOCK_SIZE;
+	int result;
+
+	/*** A range inside one block is short enough to scan. ***/
+	if (firstBlock == lastBlock)
+	{
+		result = terrain->heightMap[first];
+		for (int x = first + 1; x <= last; x++)
+		{
+			result = highest ? max(result, terrain->heightMap[x])
+							 : min(result, terrain->heightMap[x]);
+		}
+
+		return (Uint16)(result);
+	}
+
+	/*** Otherwise combine the ends of the first and last blocks... ***/
+	result = highest ? max(index->suffixMax[first], index->prefixMax[last])
+					 : min(index->suffixMin[first], index->prefixMin[last]);
+
+	/*** ...with two (possibly overlapping) runs covering the blocks between. ***/
+	int count = lastBlock - firstBlock - 1;
+	if (count > 0)
+	{
+		int level = index->floorLog2[count];
+		int offset = level * index->numBlocks;
+		int second = lastBlock - (1 << level);
+
+		if (highest)
+		{
+			result = max(result, max(index->blockMax[offset + firstBlock + 1],
+									 index->blockMax[offset + second]));
+		}
+		else
+		{
+			result = min(result, min(index->blockMin[offset + firstBlock + 1],
+									 index->blockMin[offset + second]));
+		}
+	}
+
+	return (Uint16)(result);
+}
+
+/**
+@fn queryWrappedRange
+@brief Finds the highest or lowest terrain over a range of columns that may
+wrap around the level, by splitting it at the right edge.
+@param terrain Pointer to the Terrain, with its index built.
+@param first The first column of the range.
+@param count The number of columns in the range.
+@param highest True to find the highest terrain, false for the lowest.
+@return The greatest or least height in the range.
+*/
+static Uint16 queryWrappedRange (Terrain *terrain, int first, int count,
+								 bool highest)
+{
+	int levelWidth = terrain->heightIndex.levelWidth;
+
+	while (first < 0)
+	{
+		first += levelWidth;
+	}
+	while (first >= levelWidth)
+	{
+		first -= levelWidth;
+	}
+	count = max(1, min(count, levelWidth));
+
+	if (first + count <= levelWidth)
+	{
+		return queryHeightIndex(terrain, first, first + count - 1, highest);
+	}
+
+	Uint16 right = queryHeightIndex(terrain, first, levelWidth - 1, highest);
+	Uint16 left = queryHeightIndex(terrain, 0, first + count - levelWidth - 1,
+								   highest);
+
+	return highest ? max(left, right) : min(left, right);
+}
+
+/**
+@fn getHighestTerrain
+@brief Finds the highest terrain over a range of columns in constant time.
+@param terrain Pointer to the Terrain, with its index built.
+@param first The first column of the range. Columns wrap around the level, so
+this may be negative or past the right edge.
+@param count The number of columns in the range.
+@return The greatest height in the range.
+*/
+Uint16 getHighestTerrain (Terrain *terrain, int first, int count)
+{
+	return queryWrappedRange(terrain, first, count, true);
+}
+
+/**
+@fn getLowestTerrain
+@brief Finds the lowest terrain over a range of columns in constant time.
+@param terrain Pointer to the Terrain, with its index built.
+@param first The first column of the range. Columns wrap around the level, so
+this may be negative or past the right edge.
+@param count The number of columns in the range.
+@return The least height in the range.
+*/
+Uint16 getLowestTerrain (Terrain *terrain, int first, int count)
+{
+	return queryWrappedRange(terrain, first, count, false);
+}
+
+/**
+@fn freeVertexArray
+@brief Frees the array of Vertexes used for drawing terrain.
+@param terrain Pointer to the Terrain whose Vertexes to free.
+*/
+void freeVertexArray (Terrain *terrain)
+{
+	free(terrain->vertices);
+
+	terrain->vertices = NULL;
+	terrain->numVertices = 0;
+}
+
+/**
+@fn freeTerrain
+@brief Frees everything buildHeightMap, buildHeightIndex and findLandingStrips
+(or generateTerrain) allocated for a terrain.
+@param terrain Pointer to the Terrain to free.
+*/
+void freeTerrain (Terrain *terrain)
+{
+	/* A mapped level file holds all of the arrays, so unmap it instead. */
+	if (terrain->mapping != NULL)
+	{
+		unmapLevelFile(terrain);
+	}
+	else
+	{
+		freeVertexArray(terrain);
+		freeHeightIndex(terrain);
+
+		free(terrain->heightMap);
+		terrain->heightMap = NULL;
+
+		free(terrain->flats);
+		free(terrain->flatTable);
+	}
+
+	terrain->flats = NULL;
+	terrain->numFlats = 0;
+	terrain->flatTable = NULL;
+
+	/* A generated level's streaming state. */
+	free(terrain->stream);
+	terrain->stream = NULL;
+
+	/* The level pack the level was loaded from. */
+	closeLevelPack(terrain->pack);
+	terrain->pack = NULL;
+}
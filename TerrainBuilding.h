@@ -0,0 +1,315 @@
+/**
+@file TerrainBuilding.h
+@author Rob Thomas
+@brief Contains functions for building the terrain of a Lunar Lander level.
+@details These functions read a level's vertices from a file and turn them into
+the height map and landing strips used by the game. None of them depend on a 
+window or an audio device, so they can be used by the headless simulation.
+*/
+
+#ifndef LUNAR_LANDER_TERRAINBUILDING_H
+#define LUNAR_LANDER_TERRAINBUILDING_H
+
+#include <SDL2/SDL.h>
+
+#include <stdbool.h>
+
+#include "GameObjects.h"
+
+/**
+@def HEIGHT_BLOCK_SIZE
+@brief The number of columns in each block of a HeightIndex. Ranges that fit
+inside one block are scanned, so this is kept small.
+*/
+#define HEIGHT_BLOCK_SIZE 16
+
+/**
+@def RASTER_THREAD_COLUMNS
+@brief The fewest columns of height map worth starting a thread to rasterize.
+*/
+#define RASTER_THREAD_COLUMNS (1 << 18)
+
+/**
+@def MAX_RASTER_THREADS
+@brief The most threads buildHeightMap rasterizes with.
+*/
+#define MAX_RASTER_THREADS 16
+
+/* Codes for the errors parseVertexList can report. */
+#define PARSE_OK 0
+#define PARSE_FOPEN_FAIL 1
+#define PARSE_EMPTY_FILE 2
+#define PARSE_BAD_VERTEX 3
+#define PARSE_BAD_SYNTAX 4
+#define PARSE_MEMORY_FAIL 5
+
+/**
+@typedef ParseError
+@brief Describes why a file of vertices couldn't be used.
+*/
+typedef struct ParseError
+{
+	/* One of the PARSE_* codes. */
+	int code;
+
+	/* A description of the error. */
+	const char *message;
+
+	/* Where the error was found (counting from 1), or 0 if it isn't on any
+	   one line (for instance, if the file couldn't be opened). */
+	Uint32 line;
+	Uint32 column;
+} ParseError;
+
+/**
+@fn getFlatLevel
+@brief Fills in an empty height map with a flat level at Y = heightOfTerrain.
+@param heightMap An empty Uint16 array of size levelWidth.
+@param heightOfTerrain The height (in pixels) to create flat terrain at.
+0 = bottommost pixel of screen.
+*/
+void getFlatLevel(Uint16 *heightMap, Uint16 heightOfTerrain);
+
+/**
+@fn buildHeightMap
+@brief Builds the terrain height map from an input file of vertices. 
+@param fileName The file of vertices to build the height map from.
+@param terrain Pointer to the Terrain to read the vertices into and build the
+height map of.
+@param levelWidth Pointer to the width (in pixels) of the level whose height
+map is being built. Widened if the vertices reach further.
+*/
+void buildHeightMap (char *fileName, Terrain *terrain, Uint32 *levelWidth);
+
+/**
+@fn rasterizeTerrain
+@brief Allocates a terrain's height map and fills it in from its Vertexes.
+@param terrain Pointer to the Terrain whose Vertex array has been read.
+@param levelWidth The width (in pixels) of the level.
+*/
+void rasterizeTerrain (Terrain *terrain, Uint32 levelWidth);
+
+/**
+@fn rasterizeHeightMap
+@brief Fills in a run of columns of a height map from an array of Vertexes.
+@details A column with Vertexes at it is as high as the highest of them. Every
+other column is rasterized exactly from the line between the Vertexes either
+side of it, rounding up, so columns can be filled in any order or at once.
+@param heightMap The height map to fill in.
+@param vertices The array of Vertexes, sorted by X.
+@param numVertices The number of Vertexes in the array.
+@param first The first column to fill in. There must be a Vertex at or to the
+left of it.
+@param last The last column to fill in. Columns past the last Vertex are as
+high as it is.
+*/
+void rasterizeHeightMap (Uint16 *heightMap, const Vertex *vertices,
+						 Uint32 numVertices, Uint32 first, Uint32 last);
+
+/**
+@fn markTerrainChanged
+@brief Notes that a run of a terrain's columns has changed since it was built,
+so that anything drawn from them is drawn again.
+@param terrain Pointer to the Terrain that changed.
+@param first The first column that changed.
+@param last The last column that changed.
+*/
+void markTerrainChanged (Terrain *terrain, Uint32 first, Uint32 last);
+
+/**
+@fn parseVertexText
+@brief Parses a list of vertices describing the terrain from text in memory
+and stores them in the terrain's array of Vertexes, without exiting on errors.
+@param text The text to parse, followed by a terminating 0 byte.
+@param size The length of the text (in bytes, not counting the 0 byte).
+@param terrain Pointer to the Terrain to fill in. Its Vertex array is
+allocated here, and left NULL if there is an error.
+@param levelWidth Pointer to the width of the level (in pixels). If the last
+vertex is further right than this, the level is widened to end at it.
+@param error Pointer to a ParseError, filled in if the text can't be used.
+@return True if the vertices were read, false otherwise.
+*/
+bool parseVertexText (const char *text, size_t size, Terrain *terrain,
+					  Uint32 *levelWidth, ParseError *error);
+
+/**
+@fn parseVertexList
+@brief Reads in the list of vertices describing the terrain from an input file
+and stores them in the terrain's array of Vertexes, without exiting on errors.
+@param fileName The name of the file to read from.
+@param terrain Pointer to the Terrain to fill in. Its Vertex array is
+allocated here, and left NULL if there is an error.
+@param levelWidth Pointer to the width of the level (in pixels). If the last
+vertex is further right than this, the level is widened to end at it.
+@param error Pointer to a ParseError, filled in if the file can't be used.
+@return True if the vertices were read, false otherwise.
+*/
+bool parseVertexList (char *fileName, Terrain *terrain, Uint32 *levelWidth,
+					  ParseError *error);
+
+/**
+@fn printParseError
+@brief Reports why a file of vertices couldn't be used.
+@param fileName The name of the file.
+@param error Pointer to the ParseError filled in by parseVertexList.
+*/
+void printParseError (char *fileName, ParseError *error);
+
+/**
+@fn readVertexList
+@brief Reads in the list of vertices describing the terrain from an input file
+and stores them in the terrain's array of Vertexes. Exits if the file can't be
+read or holds a bad vertex.
+@param fileName The name of the file to read from.
+@param terrain Pointer to the Terrain to fill in. Its Vertex array is
+allocated here.
+@param levelWidth Pointer to the width of the level (in pixels). If the last
+vertex is further right than this, the level is widened to end at it.
+*/
+void readVertexList(char* fileName, Terrain *terrain, Uint32 *levelWidth);
+
+/**
+@fn getScoreModifier
+@brief Finds the score modifier of a landing strip from its length. Shorter
+strips are worth more, down to FLAT_LAND_BASE pixels.
+@param length The length of the strip (in pixels).
+@return The strip's score modifier, from 1 to TOP_SCORE_TIER, or 0 if the strip
+is too short to land on (or far too long).
+*/
+Uint16 getScoreModifier (int length);
+
+/**
+@fn findStripsBetween
+@brief Finds the flat strips of terrain among a run of Vertexes.
+@param vertices The array of Vertexes.
+@param first The index of the first Vertex to search.
+@param last The index of the last Vertex to search. No strip may continue past
+it (or start before first).
+@param strips Buffer for the strips found, with room for one per Vertex.
+@return The number of strips found.
+*/
+Uint32 findStripsBetween (const Vertex *vertices, Uint32 first, Uint32 last,
+						  Flat *strips);
+
+/**
+@fn findLandingStrips
+@brief Finds vertices that define flat strips of terrain at which the lander can
+safely land, then builds the terrain's Flat array and table.
+@param state The already initialized GameState struct.
+*/
+void findLandingStrips (GameState *state);
+
+/**
+@fn buildFlatTable
+@brief Builds the table of the Flat at or after each column of a terrain.
+@param terrain Pointer to the Terrain whose Flat array has been built.
+@param levelWidth The width of the level (in pixels).
+*/
+void buildFlatTable (Terrain *terrain, Uint32 levelWidth);
+
+/**
+@fn updateFlatTable
+@brief Brings part of a terrain's Flat table up to date after its Flat array
+has changed.
+@param terrain Pointer to the Terrain, with its table allocated.
+@param first The first column to update.
+@param last The last column to update.
+*/
+void updateFlatTable (Terrain *terrain, Uint32 first, Uint32 last);
+
+/**
+@fn getHeightIndexSize
+@brief Finds the size of the single block holding a HeightIndex's arrays.
+@param levelWidth The width of the level (in pixels).
+@return The size of the block (in bytes).
+*/
+size_t getHeightIndexSize (Uint32 levelWidth);
+
+/**
+@fn placeHeightIndex
+@brief Points a HeightIndex's arrays into a block of getHeightIndexSize bytes,
+whether freshly allocated or loaded from a level file.
+@param index Pointer to the HeightIndex to fill in.
+@param data The block holding the arrays.
+@param levelWidth The width of the level (in pixels).
+*/
+void placeHeightIndex (HeightIndex *index, void *data, Uint32 levelWidth);
+
+/**
+@fn buildHeightIndex
+@brief Builds the range index and min/max pyramid over a terrain's finished
+height map.
+@param terrain Pointer to the Terrain whose height map has been built.
+@param levelWidth The width of the level (in pixels).
+*/
+void buildHeightIndex (Terrain *terrain, Uint32 levelWidth);
+
+/**
+@fn updateHeightIndex
+@brief Brings a terrain's range index up to date after some of its height map
+has changed.
+@param terrain Pointer to the Terrain, with its index allocated.
+@param first The first column that changed.
+@param last The last column that changed.
+*/
+void updateHeightIndex (Terrain *terrain, Uint32 first, Uint32 last);
+
+/**
+@fn findTerrainAbove
+@brief Finds the first column in a range whose terrain is above a height.
+@param terrain Pointer to the Terrain, with its index built.
+@param first The first column of the range.
+@param last The last column of the range (not past the right edge).
+@param height The height (in pixels) to look above.
+@return The first column whose height is greater than height, or last + 1 if
+there is none.
+*/
+Uint32 findTerrainAbove (Terrain *terrain, Uint32 first, Uint32 last,
+						 Uint16 height);
+
+/**
+@fn freeHeightIndex
+@brief Frees the arrays of a terrain's range index.
+@param terrain Pointer to the Terrain.
+*/
+void freeHeightIndex (Terrain *terrain);
+
+/**
+@fn getHighestTerrain
+@brief Finds the highest terrain over a range of columns in constant time.
+@param terrain Pointer to the Terrain, with its index built.
+@param first The first column of the range. Columns wrap around the level, so
+this may be negative or past the right edge.
+@param count The number of columns in the range.
+@return The greatest height in the range.
+*/
+Uint16 getHighestTerrain (Terrain *terrain, int first, int count);
+
+/**
+@fn getLowestTerrain
+@brief Finds the lowest terrain over a range of columns in constant time.
+@param terrain Pointer to the Terrain, with its index built.
+@param first The first column of the range. Columns wrap around the level, so
+this may be negative or past the right edge.
+@param count The number of columns in the range.
+@return The least height in the range.
+*/
+Uint16 getLowestTerrain (Terrain *terrain, int first, int count);
+
+/**
+@fn freeVertexArray
+@brief Frees the array of Vertexes used for drawing terrain.
+@param terrain Pointer to the Terrain whose Vertexes to free.
+*/
+void freeVertexArray (Terrain *terrain);
+
+/**
+@fn freeTerrain
+@brief Frees everything buildHeightMap, buildHeightIndex and findLandingStrips
+(or generateTerrain) allocated for a terrain.
+@param terrain Pointer to the Terrain to free.
+*/
+void freeTerrain (Terrain *terrain);
+
+
+#endif /* LUNAR_LANDER_TERRAINBUILDING_H */
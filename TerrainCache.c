@@ -0,0 +1,403 @@
+/**
+@file TerrainCache.c
+@author Rob Thomas
+@brief Contains functions for drawing a level's terrain from textures instead
+of line by line.
+@details See TerrainCache.h. Tiles are drawn with the same lines as
+drawTerrain, into textures that are transparent everywhere else, so they are
+blended over whatever was drawn before the terrain.
+*/
+
+#include <SDL2/SDL.h>
+
+#include <stdlib.h>
+#include <stdbool.h>
+
+#include "GameObjects.h"
+#include "GameInitialization.h"
+#include "GameFunctions.h"
+#include "TerrainBuilding.h"
+#include "Simulation.h"
+
+#include "TerrainCache.h"
+
+
+/**
+@fn createTerrainCache
+@brief Creates an empty cache of terrain tiles for a GameState's renderer.
+@param state Pointer to the GameState, whose renderer has been created.
+@return Pointer to the new TerrainCache, or NULL if the renderer can't draw
+into textures.
+*/
+TerrainCache *createTerrainCache (GameState *state)
+{
+	TerrainCache *cache;
+
+	if (state->renderer == NULL || !SDL_RenderTargetSupported(state->renderer) ||
+		!( cache = (TerrainCache*)malloc(sizeof(TerrainCache)) ))
+	{
+		return NULL;
+	}
+
+	cache->renderer = state->renderer;
+	cache->levelWidth = state->levelWidth;
+	cache->frame = 0;
+
+	for (int i = 0; i < TERRAIN_CACHE_TILES; i++)
+	{
+		cache->tiles[i].index = -1;
+		cache->tiles[i].texture = NULL;
+		cache->tiles[i].lastUsed = 0;
+	}
+
+	return cache;
+}
+
+/**
+@fn countTiles
+@brief Finds how many tiles a level is split into.
+@param levelWidth The width of the level (in pixels).
+@return The number of tiles (at least 1).
+*/
+static Sint32 countTiles (Uint32 levelWidth)
+{
+	return max(1, levelWidth / TERRAIN_TILE_WIDTH);
+}
+
+/**
+@fn getTileColumns
+@brief Finds the columns a tile covers. The last tile also takes the columns
+left over at the end of the level.
+@param levelWidth The width of the level (in pixels).
+@param index The tile.
+@param first Buffer for the tile's first column.
+@param last Buffer for the tile's last column.
+*/
+static void getTileColumns (Uint32 levelWidth, Sint32 index, Uint32 *first,
+							Uint32 *last)
+{
+	*first = (Uint32)(index) * TERRAIN_TILE_WIDTH;
+	*last = (index == countTiles(levelWidth) - 1) ?
+			levelWidth - 1 : *first + TERRAIN_TILE_WIDTH - 1;
+}
+
+/**
+@fn findTileIndex
+@brief Finds the tile holding a column.
+@param levelWidth The width of the level (in pixels).
+@param column The column (less than levelWidth).
+@return The tile.
+*/
+static Sint32 findTileIndex (Uint32 levelWidth, Uint32 column)
+{
+	return min(column / TERRAIN_TILE_WIDTH, countTiles(levelWidth) - 1);
+}
+
+/**
+@fn findCachedColumns
+@brief Finds the columns whose lines drawCachedTerrain may need to draw: those
+of the tiles the window with focus crosses, and one column either side of them.
+@param levelWidth The width of the level (in pixels).
+@param focusPointX The X of the focus point.
+@param first Buffer for the first column.
+@param last Buffer for the last column.
+@param wrappedLast Buffer for the last column from the start of the level, if
+the window wraps around the end of it.
+@return True if the window wraps around the end of the level, so the columns
+from -1 to wrappedLast are needed as well, false otherwise.
+*/
+bool findCachedColumns (Uint32 levelWidth, Sint32 focusPointX, int *first,
+						int *last, int *wrappedLast)
+{
+	Uint32 left = focusPointX % levelWidth;
+	Uint32 right = left + WINDOW_WIDTH - 1;
+	Uint32 tileFirst, tileLast;
+
+	/*** A level no wider than the window may be drawn from every tile. ***/
+	if (WINDOW_WIDTH >= levelWidth)
+	{
+		*first = -1;
+		*last = (int)(levelWidth);
+		return false;
+	}
+
+	getTileColumns(levelWidth, findTileIndex(levelWidth, left), &tileFirst,
+				   &tileLast);
+	*first = (int)(tileFirst) - 1;
+
+	if (right < levelWidth)
+	{
+		getTileColumns(levelWidth, findTileIndex(levelWidth, right),
+					   &tileFirst, &tileLast);
+		*last = (int)(tileLast) + 1;
+		return false;
+	}
+
+	/*** Otherwise the tiles run to the end of the level, and on from the
+	     start of it. ***/
+	getTileColumns(levelWidth, findTileIndex(levelWidth, right - levelWidth),
+				   &tileFirst, &tileLast);
+	*last = (int)(levelWidth);
+	*wrappedLast = (int)(tileLast) + 1;
+
+	return true;
+}
+
+/**
+@fn discardTile
+@brief Frees a tile's texture and empties its slot.
+@param tile Pointer to the TerrainTile to discard.
+*/
+static void discardTile (TerrainTile *tile)
+{
+	if (tile->texture != NULL)
+	{
+		SDL_DestroyTexture(tile->texture);
+		tile->texture = NULL;
+	}
+
+	tile->index = -1;
+}
+
+/**
+@fn discardChangedTiles
+@brief Discards the tiles the terrain has changed under since they were drawn.
+@param snapshot Pointer to the RenderSnapshot being drawn.
+*/
+static void discardChangedTiles (RenderSnapshot *snapshot)
+{
+	TerrainCache *cache = snapshot->terrainCache;
+
+	/*** A level that changed width is split into different tiles. ***/
+	if (cache->levelWidth != snapshot->levelWidth)
+	{
+		clearTerrainCache(cache);
+		cache->levelWidth = snapshot->levelWidth;
+	}
+
+	if (snapshot->changedFirst > snapshot->changedLast)
+	{
+		return;
+	}
+
+	/*** A tile's lines and height also depend on the column either side of
+	     it, so widen the changed run by a column (around the end of the
+	     level, too). ***/
+	Uint32 changedFirst = snapshot->changedFirst;
+	Uint32 changedLast = snapshot->changedLast;
+	bool wrapped = (changedFirst == 0 ||
+					changedLast + 1 >= snapshot->levelWidth);
+
+	changedFirst = (changedFirst > 0) ? changedFirst - 1 : 0;
+	changedLast++;
+
+	for (int i = 0; i < TERRAIN_CACHE_TILES; i++)
+	{
+		TerrainTile *tile = &cache->tiles[i];
+		Uint32 first, last;
+
+		if (tile->index < 0)
+		{
+			continue;
+		}
+
+		getTileColumns(snapshot->levelWidth, tile->index, &first, &last);
+
+		if ((first <= changedLast && changedFirst <= last) ||
+			(wrapped && (first == 0 || last + 1 == snapshot->levelWidth)))
+		{
+			discardTile(tile);
+		}
+	}
+}
+
+/**
+@fn drawTile
+@brief Draws a tile's lines into a new texture.
+@details The texture is only as tall as the heights the tile's terrain spans.
+If that is more than MAX_TERRAIN_TILE_HEIGHT, or the texture can't be made, the
+tile is kept without one and its lines are drawn directly.
+@param snapshot Pointer to the RenderSnapshot being drawn.
+@param tile Pointer to the empty TerrainTile to draw into.
+@param index The tile to draw.
+*/
+static void drawTile (RenderSnapshot *snapshot, TerrainTile *tile,
+					  Sint32 index)
+{
+	SDL_Renderer *renderer = snapshot->terrainCache->renderer;
+	Uint32 first, last;
+
+	getTileColumns(snapshot->levelWidth, index, &first, &last);
+
+	/*** Find the heights the tile's lines reach. Every line lies between the
+	     heights of its ends, so these are the highest and lowest of its
+	     Vertexes. ***/
+	const VertexRun *run = findVertexRun(snapshot, (int)(first) - 1, last);
+	Uint32 start, end;
+	int top = 0, bottom = 0;
+
+	if (run != NULL && findColumnVertices(run->vertices, run->numVertices,
+										  (int)(first) - 1, last, &start,
+										  &end))
+	{
+		const Vertex *vertices = run->vertices;
+
+		top = bottom = vertices[start].Y;
+
+		for (Uint32 i = start + 1; i <= end; i++)
+		{
+			top = max(top, vertices[i].Y);
+			bottom = min(bottom, vertices[i].Y);
+		}
+	}
+
+	tile->index = index;
+	tile->top = top;
+	tile->height = top - bottom + 1;
+	tile->texture = NULL;
+
+	if (tile->height > MAX_TERRAIN_TILE_HEIGHT ||
+		!( tile->texture = SDL_CreateTexture(renderer,
+											 SDL_PIXELFORMAT_RGBA8888,
+											 SDL_TEXTUREACCESS_TARGET,
+											 (int)(last - first) + 1,
+											 tile->height) ))
+	{
+		return;
+	}
+
+	if (SDL_SetRenderTarget(renderer, tile->texture) != 0)
+	{
+		SDL_DestroyTexture(tile->texture);
+		tile->texture = NULL;
+		return;
+	}
+
+	/*** Draw the lines, with the tile's first column and top height at the
+	     texture's top-left corner, over a transparent background. The lines
+	     ending in the first column from the left are drawn too. ***/
+	SDL_SetTextureBlendMode(tile->texture, SDL_BLENDMODE_BLEND);
+	SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+	SDL_RenderClear(renderer);
+	SDL_SetRenderDrawColor(renderer, 255, 255, 255, 255);
+	drawTerrainColumns(snapshot, (int)(first) - 1, last, (int)(first), top);
+
+	SDL_SetRenderTarget(renderer, NULL);
+}
+
+/**
+@fn findTile
+@brief Finds a tile among those kept, drawing it in place of the least
+recently used one if it isn't there.
+@param snapshot Pointer to the RenderSnapshot being drawn.
+@param index The tile to find.
+@return Pointer to the tile.
+*/
+static TerrainTile *findTile (RenderSnapshot *snapshot, Sint32 index)
+{
+	TerrainCache *cache = snapshot->terrainCache;
+	TerrainTile *oldest = &cache->tiles[0];
+
+	for (int i = 0; i < TERRAIN_CACHE_TILES; i++)
+	{
+		if (cache->tiles[i].index == index)
+		{
+			cache->tiles[i].lastUsed = cache->frame;
+			return &cache->tiles[i];
+		}
+
+		if (cache->tiles[i].lastUsed < oldest->lastUsed)
+		{
+			oldest = &cache->tiles[i];
+		}
+	}
+
+	discardTile(oldest);
+	drawTile(snapshot, oldest, index);
+	oldest->lastUsed = cache->frame;
+
+	return oldest;
+}
+
+/**
+@fn drawCachedTerrain
+@brief Draws the terrain in the window with focus from the cached tiles,
+drawing any tiles that are missing or out of date first.
+@param snapshot Pointer to the RenderSnapshot being drawn. Its terrainCache
+must not be NULL.
+*/
+void drawCachedTerrain (RenderSnapshot *snapshot)
+{
+	TerrainCache *cache = snapshot->terrainCache;
+
+	discardChangedTiles(snapshot);
+	cache->frame++;
+
+	/*** Copy the window's columns out of each tile they cross in turn,
+	     wrapping around the end of the level. ***/
+	Uint32 column = snapshot->focusPointX % snapshot->levelWidth;
+	int screenX = 0;
+
+	while (screenX < WINDOW_WIDTH)
+	{
+		Sint32 index = findTileIndex(snapshot->levelWidth, column);
+		TerrainTile *tile = findTile(snapshot, index);
+		Uint32 first, last;
+
+		getTileColumns(snapshot->levelWidth, index, &first, &last);
+
+		int span = min(WINDOW_WIDTH - screenX, (int)(last - column) + 1);
+
+		if (tile->texture != NULL)
+		{
+			SDL_Rect source = {(int)(column - first), 0, span, tile->height};
+			SDL_Rect destination = {screenX, snapshot->focusPointY - tile->top,
+									span, tile->height};
+
+			SDL_RenderCopy(cache->renderer, tile->texture, &source,
+						   &destination);
+		}
+		else
+		{
+			/* Too tall to keep: draw the lines crossing these columns, moved
+			   to where the columns are on screen. */
+			SDL_SetRenderDrawColor(cache->renderer, 255, 255, 255, 255);
+			drawTerrainColumns(snapshot, (int)(column) - 1, column + span,
+							   (int)(column) - screenX, snapshot->focusPointY);
+		}
+
+		screenX += span;
+		column = (column + span) % snapshot->levelWidth;
+	}
+}
+
+/**
+@fn clearTerrainCache
+@brief Throws away every tile, so they are all drawn again (for instance, after
+the renderer has lost its textures' contents).
+@param cache Pointer to the TerrainCache to clear (may be NULL).
+*/
+void clearTerrainCache (TerrainCache *cache)
+{
+	if (cache == NULL)
+	{
+		return;
+	}
+
+	for (int i = 0; i < TERRAIN_CACHE_TILES; i++)
+	{
+		discardTile(&cache->tiles[i]);
+	}
+}
+
+/**
+@fn freeTerrainCache
+@brief Frees a cache of terrain tiles and its textures. Must be called before
+the renderer is destroyed.
+@param cache Pointer to the TerrainCache to free (may be NULL).
+*/
+void freeTerrainCache (TerrainCache *cache)
+{
+	clearTerrainCache(cache);
+	free(cache);
+}
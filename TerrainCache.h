@@ -0,0 +1,137 @@
+/**
+@file TerrainCache.h
+@author Rob Thomas
+@brief Contains functions for drawing a level's terrain from textures instead
+of line by line.
+@details The level is split into tiles of at least TERRAIN_TILE_WIDTH columns
+(the last tile takes whatever is left over), and each tile's lines are drawn
+into a texture the first time it comes into view. Every frame the visible
+columns are then copied out of at most two tiles, one on either side of a tile
+boundary or of the seam where the level wraps around. Only the tiles holding
+columns the terrain has changed in since they were drawn (see
+markTerrainChanged) are drawn again.
+
+A wide level has far more tiles than are ever in view, so only the
+TERRAIN_CACHE_TILES tiles used most recently are kept.
+*/
+
+#ifndef LUNAR_LANDER_TERRAINCACHE_H
+#define LUNAR_LANDER_TERRAINCACHE_H
+
+#include <SDL2/SDL.h>
+
+#include <stdbool.h>
+
+#include "GameObjects.h"
+
+/**
+@def TERRAIN_TILE_WIDTH
+@brief The fewest columns in a tile. No narrower than the window, so the window
+never shows more than two tiles.
+*/
+#define TERRAIN_TILE_WIDTH 1024
+
+/**
+@def MAX_TERRAIN_TILE_HEIGHT
+@brief The tallest texture a tile is drawn into. The lines of a tile whose
+terrain spans more heights than this are drawn directly instead.
+*/
+#define MAX_TERRAIN_TILE_HEIGHT 2048
+
+/**
+@def TERRAIN_CACHE_TILES
+@brief The number of tiles kept at once.
+*/
+#define TERRAIN_CACHE_TILES 4
+
+/**
+@typedef TerrainTile
+@brief A tile of terrain drawn into a texture.
+*/
+typedef struct TerrainTile
+{
+	/* The tile held, or -1 if none is. */
+	Sint32 index;
+
+	/* The texture the tile's lines are drawn into, or NULL if the tile is too
+	   tall to be kept (its lines are then drawn directly). */
+	SDL_Texture *texture;
+
+	/* The height of terrain drawn along the texture's top row, and the number
+	   of rows. */
+	Uint16 top;
+	int height;
+
+	/* The frame the tile was last drawn in, to find the least recently used
+	   tile. */
+	Uint32 lastUsed;
+} TerrainTile;
+
+/**
+@typedef TerrainCache
+@brief The tiles of terrain kept for a renderer.
+*/
+typedef struct TerrainCache
+{
+	/* The renderer the textures belong to. */
+	SDL_Renderer *renderer;
+
+	/* The width of the level the tiles were drawn from. */
+	Uint32 levelWidth;
+
+	/* The tiles kept, and the number of frames drawn. */
+	TerrainTile tiles[TERRAIN_CACHE_TILES];
+	Uint32 frame;
+} TerrainCache;
+
+/**
+@fn createTerrainCache
+@brief Creates an empty cache of terrain tiles for a GameState's renderer.
+@param state Pointer to the GameState, whose renderer has been created.
+@return Pointer to the new TerrainCache, or NULL if the renderer can't draw
+into textures.
+*/
+TerrainCache *createTerrainCache (GameState *state);
+
+/**
+@fn findCachedColumns
+@brief Finds the columns whose lines drawCachedTerrain may need to draw: those
+of the tiles the window with focus crosses, and one column either side of them.
+@param levelWidth The width of the level (in pixels).
+@param focusPointX The X of the focus point.
+@param first Buffer for the first column.
+@param last Buffer for the last column.
+@param wrappedLast Buffer for the last column from the start of the level, if
+the window wraps around the end of it.
+@return True if the window wraps around the end of the level, so the columns
+from -1 to wrappedLast are needed as well, false otherwise.
+*/
+bool findCachedColumns (Uint32 levelWidth, Sint32 focusPointX, int *first,
+						int *last, int *wrappedLast);
+
+/**
+@fn drawCachedTerrain
+@brief Draws the terrain in the window with focus from the cached tiles,
+drawing any tiles that are missing or out of date first.
+@param snapshot Pointer to the RenderSnapshot being drawn. Its terrainCache
+must not be NULL.
+*/
+void drawCachedTerrain (RenderSnapshot *snapshot);
+
+/**
+@fn clearTerrainCache
+@brief Throws away every tile, so they are all drawn again (for instance, after
+the renderer has lost its textures' contents).
+@param cache Pointer to the TerrainCache to clear (may be NULL).
+*/
+void clearTerrainCache (TerrainCache *cache);
+
+/**
+@fn freeTerrainCache
+@brief Frees a cache of terrain tiles and its textures. Must be called before
+the renderer is destroyed.
+@param cache Pointer to the TerrainCache to free (may be NULL).
+*/
+void freeTerrainCache (TerrainCache *cache);
+
+#endif /* LUNAR_LANDER_TERRAINCACHE_H */
@@ -0,0 +1,357 @@
+/**
+@file TerrainGenerator.c
+@author Rob Thomas
+@brief Contains functions for generating endless levels from a seed.
+@details See TerrainGenerator.h. Like the other terrain builders, none of these
+functions depend on a window or an audio device.
+*/
+
+#include <SDL2/SDL.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "GameObjects.h"
+#include "GameInitialization.h"
+#include "TerrainBuilding.h"
+#include "Simulation.h"
+
+#include "TerrainGenerator.h"
+
+
+/* The number of Vertexes in each chunk (both of its ends are included, so
+   neighbouring chunks repeat the Vertex where they meet). */
+#define CHUNK_VERTICES (CHUNK_SEGMENTS + 1)
+
+/* The width (in pixels) of each line of a chunk's outline. */
+#define SEGMENT_WIDTH (CHUNK_WIDTH / CHUNK_SEGMENTS)
+
+/**
+@fn mixBits
+@brief Scrambles a 64-bit number (the SplitMix64 finalizer).
+@param value The number to scramble.
+@return The scrambled number.
+*/
+static Uint64 mixBits (Uint64 value)
+{
+	value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	value = (value ^ (value >> 27)) * 0x94D049BB133111EBULL;
+
+	return value ^ (value >> 31);
+}
+
+/**
+@fn nextRandom
+@brief Draws the next number from a SplitMix64 generator.
+@param random Pointer to the generator's state.
+@return A random 64-bit number.
+*/
+static Uint64 nextRandom (Uint64 *random)
+{
+	*random += 0x9E3779B97F4A7C15ULL;
+
+	return mixBits(*random);
+}
+
+/**
+@fn randomBetween
+@brief Draws a random number in a range.
+@param random Pointer to the generator's state.
+@param low The least number to draw.
+@param high The greatest number to draw.
+@return A number from low to high.
+*/
+static int randomBetween (Uint64 *random, int low, int high)
+{
+	return low + (int)(nextRandom(random) % (Uint64)(high - low + 1));
+}
+
+/**
+@fn seedChunk
+@brief Finds the state to start a chunk's generator from.
+@param seed The level's seed.
+@param chunk The number of the chunk.
+@param salt Tells apart the generators used for one chunk.
+@return The generator's first state.
+*/
+static Uint64 seedChunk (Uint64 seed, Sint32 chunk, Uint64 salt)
+{
+	return mixBits(seed ^ mixBits(((Uint64)(Uint32)(chunk) << 1) | salt));
+}
+
+/**
+@fn getEdgeHeight
+@brief Finds the height of the terrain where a chunk begins, which is also
+where the chunk before it ends.
+@param seed The level's seed.
+@param chunk The number of the chunk.
+@return The height (in pixels).
+*/
+static int getEdgeHeight (Uint64 seed, Sint32 chunk)
+{
+	Uint64 random = seedChunk(seed, chunk, 0);
+
+	return randomBetween(&random, GENERATED_MIN_HEIGHT + GENERATED_ROUGHNESS,
+						 GENERATED_MAX_HEIGHT - GENERATED_ROUGHNESS);
+}
+
+/**
+@fn getChunkSlot
+@brief Finds the slot of the ring a chunk is held in.
+@param chunk The number of the chunk.
+@return The slot, from 0 to STREAM_CHUNKS - 1.
+*/
+static int getChunkSlot (Sint32 chunk)
+{
+	int slot = chunk % STREAM_CHUNKS;
+
+	return (slot < 0) ? slot + STREAM_CHUNKS : slot;
+}
+
+/**
+@fn generateChunk
+@brief Generates one chunk into its slot of the Vertex array, height map and
+Flat array. The height index and Flat table are left to the caller.
+@param terrain Pointer to the generated level's Terrain.
+@param slot The slot to generate the chunk into.
+@param chunk The number of the chunk.
+*/
+static void generateChunk (Terrain *terrain, int slot, Sint32 chunk)
+{
+	TerrainStream *stream = terrain->stream;
+	Vertex *vertices = terrain->vertices + slot * CHUNK_VERTICES;
+	Flat *flat = &terrain->flats[slot];
+	int left = slot * CHUNK_WIDTH;
+	int heights[CHUNK_VERTICES];
+	Uint64 random = seedChunk(stream->seed, chunk, 1);
+
+	/*** Pin the ends of the chunk to the heights its neighbours share. ***/
+	heights[0] = getEdgeHeight(stream->seed, chunk);
+	heights[CHUNK_SEGMENTS] = getEdgeHeight(stream->seed, chunk + 1);
+
+	/*** Midpoint displacement: set each midpoint to the average of the two
+	     points around it, moved up or down at random by up to spread. Halve
+	     the spread at each finer level. ***/
+	int spread = GENERATED_ROUGHNESS;
+
+	for (int step = CHUNK_SEGMENTS / 2; step > 0; step /= 2)
+	{
+		for (int i = step; i < CHUNK_SEGMENTS; i += 2 * step)
+		{
+			int height = (heights[i - step] + heights[i + step]) / 2 +
+						 randomBetween(&random, -spread, spread);
+
+			heights[i] = max(GENERATED_MIN_HEIGHT,
+							 min(height, GENERATED_MAX_HEIGHT));
+		}
+
+		spread = max(1, spread / 2);
+	}
+
+	/*** Lay the Vertexes out evenly. ***/
+	for (int i = 0; i < CHUNK_VERTICES; i++)
+	{
+		vertices[i].X = left + i * SEGMENT_WIDTH;
+		vertices[i].Y = heights[i];
+	}
+
+	/*** Flatten one line, away from the ends of the chunk, into a landing
+	     strip. Its length is drawn so that every score tier turns up. ***/
+	int first = randomBetween(&random, 1, CHUNK_SEGMENTS - 3);
+	int length = randomBetween(&random, FLAT_LAND_BASE,
+							   FLAT_LAND_BASE + TOP_SCORE_TIER *
+							   FLAT_LAND_INCREMENT - 1);
+
+	vertices[first + 1].X = vertices[first].X + length;
+	vertices[first + 1].Y = vertices[first].Y;
+
+	flat->X = vertices[first].X;
+	flat->Y = vertices[first].Y;
+	flat->length = length;
+	flat->scoreModifier = getScoreModifier(length);
+
+	/*** Fill in the height map under the chunk from its Vertexes alone. ***/
+	rasterizeHeightMap(terrain->heightMap, vertices, CHUNK_VERTICES, left,
+					   left + CHUNK_WIDTH - 1);
+
+	stream->slotChunks[slot] = chunk;
+}
+
+/**
+@fn loadChunks
+@brief Makes sure the chunks around a given chunk are held, generating any that
+aren't in place of the ones furthest away.
+@param terrain Pointer to the generated level's Terrain.
+@param center The chunk to center the ring on.
+*/
+static void loadChunks (Terrain *terrain, Sint32 center)
+{
+	TerrainStream *stream = terrain->stream;
+
+	for (Sint32 chunk = center - CHUNKS_BEHIND; chunk <= center + CHUNKS_AHEAD;
+		 chunk++)
+	{
+		int slot = getChunkSlot(chunk);
+
+		if (stream->slotChunks[slot] != chunk)
+		{
+			generateChunk(terrain, slot, chunk);
+			updateHeightIndex(terrain, slot * CHUNK_WIDTH,
+							  (slot + 1) * CHUNK_WIDTH - 1);
+			updateFlatTable(terrain, slot * CHUNK_WIDTH,
+							(slot + 1) * CHUNK_WIDTH - 1);
+			markTerrainChanged(terrain, slot * CHUNK_WIDTH,
+							   (slot + 1) * CHUNK_WIDTH - 1);
+		}
+	}
+
+	stream->centerChunk = center;
+}
+
+/**
+@fn isGeneratedLevel
+@brief Reports whether a level name asks for a generated level.
+@param fileName The name of the level.
+@return True if the name is GENERATED_LEVEL_PREFIX followed by a seed.
+*/
+bool isGeneratedLevel (char *fileName)
+{
+	size_t prefixLength = strlen(GENERATED_LEVEL_PREFIX);
+	char *end;
+
+	if (strncmp(fileName, GENERATED_LEVEL_PREFIX, prefixLength) != 0 ||
+		fileName[prefixLength] == '\0')
+	{
+		return false;
+	}
+
+	strtoull(fileName + prefixLength, &end, 0);
+
+	return *end == '\0';
+}
+
+/**
+@fn generateTerrain
+@brief Generates the first chunks of a level from the seed in its name.
+@details Allocates the Vertex array, height map, height index, Flat array and
+Flat table for STREAM_CHUNKS chunks, which are all reused as the level is
+streamed. They MUST BE FREED later (by freeTerrain). Exits if they can't be
+allocated.
+@param fileName The name of the level, "seed:" followed by the seed.
+@param state The GameState to generate the level for. Its lander and terrain
+must be set.
+*/
+void generateTerrain (char *fileName, GameState *state)
+{
+	Terrain *terrain = state->terrain;
+	TerrainStream *stream;
+
+	/*** Allocate the stream and every array at the size of the ring. ***/
+	state->levelWidth = STREAM_CHUNKS * CHUNK_WIDTH;
+
+	stream = (TerrainStream*)calloc(1, sizeof(TerrainStream));
+	terrain->vertices = (Vertex*)malloc(STREAM_CHUNKS * CHUNK_VERTICES *
+										sizeof(Vertex));
+	terrain->heightMap = (Uint16*)malloc(state->levelWidth * sizeof(Uint16));
+	terrain->flats = (Flat*)malloc(STREAM_CHUNKS * sizeof(Flat));
+
+	if (stream == NULL || terrain->vertices == NULL ||
+		terrain->heightMap == NULL || terrain->flats == NULL)
+	{
+		fprintf(stderr, "Couldn't allocate the generated level.\n");
+		exit(EXIT_MAP_FAIL);
+	}
+
+	terrain->stream = stream;
+	terrain->numVertices = STREAM_CHUNKS * CHUNK_VERTICES;
+	terrain->numFlats = STREAM_CHUNKS;
+
+	stream->seed = strtoull(fileName + strlen(GENERATED_LEVEL_PREFIX), NULL, 0);
+	stream->owner = state->lander;
+
+	/*** Generate the chunks around the lander's start, then index them. Each
+	     slot holds one Flat, so the Flats stay in order of X. ***/
+	for (Sint32 chunk = -CHUNKS_BEHIND; chunk <= CHUNKS_AHEAD; chunk++)
+	{
+		generateChunk(terrain, getChunkSlot(chunk), chunk);
+	}
+	stream->centerChunk = 0;
+
+	buildHeightIndex(terrain, state->levelWidth);
+	buildFlatTable(terrain, state->levelWidth);
+}
+
+/**
+@fn streamTerrain
+@brief Generates the chunks ahead of the lander and drops those behind it once
+it crosses into another chunk. Does nothing for other levels, or for a lander
+the level doesn't follow.
+@details Every slot always holds a chunk, and the chunk under the lander is
+never replaced, so the lander's chunk is simply the one held in the slot it is
+over (even just after it has been respawned).
+@param state Pointer to the current GameState struct.
+*/
+void streamTerrain (GameState *state)
+{
+	TerrainStream *stream = state->terrain->stream;
+
+	if (stream == NULL || stream->owner != state->lander)
+	{
+		return;
+	}
+
+	Sint32 chunk = stream->slotChunks[(state->lander->X / CHUNK_WIDTH)
+									  % STREAM_CHUNKS];
+
+	if (chunk != stream->centerChunk)
+	{
+		loadChunks(state->terrain, chunk);
+	}
+}
+
+/**
+@fn seekTerrainStream
+@brief Moves a generated level to the chunks around a given chunk, as if the
+lander had flown there. Does nothing for other levels, or for a lander the
+level doesn't follow.
+@param state Pointer to the current GameState struct.
+@param chunk The chunk to move to.
+*/
+void seekTerrainStream (GameState *state, Sint32 chunk)
+{
+	TerrainStream *stream = state->terrain->stream;
+
+	if (stream == NULL || stream->owner != state->lander)
+	{
+		return;
+	}
+
+	loadChunks(state->terrain, chunk);
+}
+
+/**
+@fn getStreamChunk
+@brief Finds the chunk of a generated level the lander is in.
+@param terrain Pointer to the Terrain.
+@return The lander's chunk, or 0 if the level isn't generated.
+*/
+Sint32 getStreamChunk (Terrain *terrain)
+{
+	return (terrain->stream != NULL) ? terrain->stream->centerChunk : 0;
+}
+
+/**
+@fn stopTerrainStream
+@brief Stops a generated level from following its lander, so the chunks it
+holds are kept as they are. Used when several landers share one level.
+@param terrain Pointer to the Terrain.
+*/
+void stopTerrainStream (Terrain *terrain)
+{
+	if (terrain->stream != NULL)
+	{
+		terrain->stream->owner = NULL;
+	}
+}
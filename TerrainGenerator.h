@@ -0,0 +1,156 @@
+/**
+@file TerrainGenerator.h
+@author Rob Thomas
+@brief Contains functions for generating endless levels from a seed.
+@details A generated level is played by passing "seed:" followed by a number in
+place of a terrain file. Its terrain is made in chunks of CHUNK_WIDTH columns by
+midpoint displacement, and every chunk holds one landing strip. A chunk depends
+only on the seed and its own number, so it can be thrown away and later made
+again exactly as it was.
+
+Only STREAM_CHUNKS chunks are held at once, in a ring as wide as the level:
+chunk n is kept in slot n mod STREAM_CHUNKS, so the lander's position wraps
+around the level onto the chunk it is flying over just as it does in any other
+level. As the lander crosses into a new chunk, the chunks furthest behind it are
+replaced by the next ones ahead, so the level never ends and its memory never
+grows.
+*/
+
+#ifndef LUNAR_LANDER_TERRAINGENERATOR_H
+#define LUNAR_LANDER_TERRAINGENERATOR_H
+
+#include <SDL2/SDL.h>
+
+#include <stdbool.h>
+
+#include "GameObjects.h"
+
+/**
+@def GENERATED_LEVEL_PREFIX
+@brief Starts the name of a generated level. The seed follows it.
+*/
+#define GENERATED_LEVEL_PREFIX "seed:"
+
+/**
+@def CHUNK_WIDTH
+@brief The width (in pixels) of each chunk of a generated level.
+*/
+#define CHUNK_WIDTH 1024
+
+/**
+@def CHUNK_SEGMENTS
+@brief The number of lines each chunk's outline is made of. Must be a power
+of 2.
+*/
+#define CHUNK_SEGMENTS 32
+
+/**
+@def STREAM_CHUNKS
+@brief The number of chunks held at once. The level is this many chunks wide.
+*/
+#define STREAM_CHUNKS 8
+
+/**
+@def CHUNKS_BEHIND
+@brief The number of chunks kept behind the lander's chunk. The rest of the
+ring holds the chunks ahead of it, and both must reach past the edge of the
+window.
+*/
+#define CHUNKS_BEHIND 3
+#define CHUNKS_AHEAD (STREAM_CHUNKS - 1 - CHUNKS_BEHIND)
+
+/**
+@def GENERATED_MIN_HEIGHT
+@brief The lowest terrain in a generated level (in pixels).
+*/
+#define GENERATED_MIN_HEIGHT 16
+
+/**
+@def GENERATED_MAX_HEIGHT
+@brief The highest terrain in a generated level (in pixels). Kept well below
+LANDER_Y_START.
+*/
+#define GENERATED_MAX_HEIGHT 300
+
+/**
+@def GENERATED_ROUGHNESS
+@brief The furthest (in pixels) the middle of a chunk may be displaced from
+the line between its ends. Each finer level of detail is displaced half as far.
+*/
+#define GENERATED_ROUGHNESS 96
+
+/**
+@typedef TerrainStream
+@brief Tracks which chunks of a generated level are held in its Terrain.
+*/
+typedef struct TerrainStream
+{
+	/* The seed the level is generated from. */
+	Uint64 seed;
+
+	/* The chunk the lander is in, and the chunk held in each slot. */
+	Sint32 centerChunk;
+	Sint32 slotChunks[STREAM_CHUNKS];
+
+	/* The lander the chunks follow, or NULL to keep the chunks as they are
+	   (when several landers share the level). */
+	Lander *owner;
+} TerrainStream;
+
+/**
+@fn isGeneratedLevel
+@brief Reports whether a level name asks for a generated level.
+@param fileName The name of the level.
+@return True if the name is GENERATED_LEVEL_PREFIX followed by a seed.
+*/
+bool isGeneratedLevel (char *fileName);
+
+/**
+@fn generateTerrain
+@brief Generates the first chunks of a level from the seed in its name.
+@details Allocates the Vertex array, height map, height index, Flat array and
+Flat table for STREAM_CHUNKS chunks, which are all reused as the level is
+streamed. They MUST BE FREED later (by freeTerrain). Exits if they can't be
+allocated.
+@param fileName The name of the level, "seed:" followed by the seed.
+@param state The GameState to generate the level for. Its lander and terrain
+must be set.
+*/
+void generateTerrain (char *fileName, GameState *state);
+
+/**
+@fn streamTerrain
+@brief Generates the chunks ahead of the lander and drops those behind it once
+it crosses into another chunk. Does nothing for other levels, or for a lander
+the level doesn't follow.
+@param state Pointer to the current GameState struct.
+*/
+void streamTerrain (GameState *state);
+
+/**
+@fn seekTerrainStream
+@brief Moves a generated level to the chunks around a given chunk, as if the
+lander had flown there. Does nothing for other levels, or for a lander the
+level doesn't follow.
+@param state Pointer to the current GameState struct.
+@param chunk The chunk to move to.
+*/
+void seekTerrainStream (GameState *state, Sint32 chunk);
+
+/**
+@fn getStreamChunk
+@brief Finds the chunk of a generated level the lander is in.
+@param terrain Pointer to the Terrain.
+@return The lander's chunk, or 0 if the level isn't generated.
+*/
+Sint32 getStreamChunk (Terrain *terrain);
+
+/**
+@fn stopTerrainStream
+@brief Stops a generated level from following its lander, so the chunks it
+holds are kept as they are. Used when several landers share one level.
+@param terrain Pointer to the Terrain.
+*/
+void stopTerrainStream (Terrain *terrain);
+
+#endif /* LUNAR_LANDER_TERRAINGENERATOR_H */
@@ -0,0 +1,443 @@
+/**
+@file TerrainReload.c
+@author Rob Thomas
+@brief Contains functions for reloading a level's terrain while the game runs.
+@details See TerrainReload.h. The file is read on a separate thread, but the
+terrain itself is only ever changed by the game's own thread, between frames.
+*/
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <SDL2/SDL.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
+#include "GameObjects.h"
+#include "GameInitialization.h"
+#include "TerrainBuilding.h"
+#include "LevelFile.h"
+#include "TerrainGenerator.h"
+#include "Simulation.h"
+
+#include "TerrainReload.h"
+
+
+/**
+@fn getBaseName
+@brief Finds the name of a file without its directory.
+@param fileName The name of the file.
+@return Pointer to the part of fileName after its last '/'.
+*/
+static char *getBaseName (char *fileName)
+{
+	char *slash = strrchr(fileName, '/');
+
+	return (slash != NULL) ? slash + 1 : fileName;
+}
+
+/**
+@fn hasFileChanged
+@brief Checks, without waiting, whether a watched file has been saved since it
+was last checked.
+@param watch Pointer to the TerrainWatch.
+@return True if the file has changed, false otherwise.
+*/
+static bool hasFileChanged (TerrainWatch *watch)
+{
+#ifdef __linux__
+	if (watch->descriptor >= 0)
+	{
+		/*** Read every waiting event, looking for one naming the file. ***/
+		char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+		char *baseName = getBaseName(watch->fileName);
+		bool changed = false;
+		ssize_t length;
+
+		while ((length = read(watch->descriptor, buffer, sizeof(buffer))) > 0)
+		{
+			for (char *next = buffer; next < buffer + length; )
+			{
+				struct inotify_event *event = (struct inotify_event*)(next);
+
+				if (event->len > 0 && strcmp(event->name, baseName) == 0)
+				{
+					changed = true;
+				}
+
+				next += sizeof(struct inotify_event) + event->len;
+			}
+		}
+
+		return changed;
+	}
+#endif
+
+	/*** Otherwise compare the file's modification time and size. ***/
+	struct stat info;
+
+	if (stat(watch->fileName, &info) != 0 ||
+		(info.st_mtime == watch->modified && info.st_size == watch->size))
+	{
+		return false;
+	}
+
+	watch->modified = info.st_mtime;
+	watch->size = info.st_size;
+
+	return true;
+}
+
+/**
+@fn parseWatchedFile
+@brief Thread entry point that reads a watched file's Vertexes into the
+watch's pending Terrain.
+@param data Pointer to the TerrainWatch.
+@return NULL.
+*/
+static void *parseWatchedFile (void *data)
+{
+	TerrainWatch *watch = (TerrainWatch*)(data);
+	Uint32 levelWidth = LEVEL_WIDTH;
+	bool succeeded;
+
+	succeeded = parseVertexList(watch->fileName, &watch->pending, &levelWidth,
+								&watch->error);
+
+	pthread_mutex_lock(&watch->lock);
+	watch->pendingWidth = levelWidth;
+	watch->parseSucceeded = succeeded;
+	watch->parsed = true;
+	pthread_mutex_unlock(&watch->lock);
+
+	return NULL;
+}
+
+/**
+@fn watchTerrainFile
+@brief Starts watching the text file a level was built from.
+@param fileName The name of the file.
+@param state Pointer to the GameState the level was built for.
+@return Pointer to the new TerrainWatch, or NULL if the level can't be
+reloaded (it was loaded from a level file or generated) or the file can't be
+watched.
+*/
+TerrainWatch *watchTerrainFile (char *fileName, GameState *state)
+{
+	TerrainWatch *watch;
+	struct stat info;
+
+	if (isLevelFile(fileName) || isGeneratedLevel(fileName) ||
+		stat(fileName, &info) != 0 ||
+		!( watch = (TerrainWatch*)calloc(1, sizeof(TerrainWatch)) ))
+	{
+		return NULL;
+	}
+
+	watch->fileName = fileName;
+	watch->modified = info.st_mtime;
+	watch->size = info.st_size;
+	pthread_mutex_init(&watch->lock, NULL);
+
+	/*** Watch the file's directory, so that a new file renamed over the old
+	     one is noticed too. If inotify isn't available, fall back to checking
+	     the modification time. ***/
+	watch->descriptor = -1;
+
+#ifdef __linux__
+	char *baseName = getBaseName(fileName);
+	char directory[4096] = ".";
+
+	if (baseName != fileName &&
+		(size_t)(baseName - fileName) < sizeof(directory))
+	{
+		memcpy(directory, fileName, baseName - fileName);
+		directory[baseName - fileName] = '\0';
+	}
+
+	watch->descriptor = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (watch->descriptor >= 0 &&
+		inotify_add_watch(watch->descriptor, directory,
+						  IN_CLOSE_WRITE | IN_MOVED_TO) < 0)
+	{
+		close(watch->descriptor);
+		watch->descriptor = -1;
+	}
+#endif
+
+	return watch;
+}
+
+/**
+@fn reloadTerrain
+@brief Checks whether a watched level's file has changed, without waiting, and
+brings the terrain up to date once the changed file has been read. Files that
+can't be parsed are reported and otherwise ignored.
+@param state Pointer to the current GameState struct. Does nothing if its
+terrainWatch is NULL.
+@return True if the terrain was changed, false otherwise.
+*/
+bool reloadTerrain (GameState *state)
+{
+	TerrainWatch *watch = state->terrainWatch;
+	bool changed = false;
+
+	if (watch == NULL)
+	{
+		return false;
+	}
+
+	/*** Note any change to the file. ***/
+	if (hasFileChanged(watch))
+	{
+		watch->dirty = true;
+	}
+
+	/*** Apply the Vertexes read by a finished parse. ***/
+	if (watch->parsing)
+	{
+		pthread_mutex_lock(&watch->lock);
+		bool parsed = watch->parsed;
+		pthread_mutex_unlock(&watch->lock);
+
+		if (parsed)
+		{
+			pthread_join(watch->parser, NULL);
+			watch->parsing = false;
+
+			if (watch->parseSucceeded)
+			{
+				editTerrain(state, watch->pending.vertices,
+							watch->pending.numVertices, watch->pendingWidth);
+				changed = true;
+			}
+			else
+			{
+				printParseError(watch->fileName, &watch->error);
+			}
+		}
+	}
+
+	/*** Start reading the file again if it has changed since the last read
+	     began. ***/
+	if (watch->dirty && !watch->parsing)
+	{
+		watch->dirty = false;
+		watch->parsed = false;
+		watch->pending.vertices = NULL;
+		watch->pending.numVertices = 0;
+
+		if (pthread_create(&watch->parser, NULL, parseWatchedFile, watch) == 0)
+		{
+			watch->parsing = true;
+		}
+	}
+
+	return changed;
+}
+
+/**
+@fn editTerrain
+@brief Replaces a terrain's Vertexes with an edited list, rebuilding only the
+parts of the height map, height index, Flat array and Flat table under the
+Vertexes that changed.
+@details The Vertexes the two lists begin and end with are compared to find
+the edited run in the middle. The columns from the last unchanged Vertex
+before it to the first unchanged Vertex after it are rasterized again. The
+Flats found among those Vertexes (widened to take in any strip crossing the
+ends) replace the Flats there before.
+@param state Pointer to the GameState whose terrain to edit.
+@param vertices The edited Vertex array (allocated by parseVertexList), which
+the terrain takes over.
+@param numVertices The number of Vertexes in the edited array.
+@param levelWidth The width of the level the edited Vertexes describe.
+*/
+void editTerrain (GameState *state, Vertex *vertices, Uint32 numVertices,
+				  Uint32 levelWidth)
+{
+	Terrain *terrain = state->terrain;
+	Vertex *old = terrain->vertices;
+	Uint32 oldCount = terrain->numVertices;
+	Uint32 shorter = (numVertices < oldCount) ? numVertices : oldCount;
+	bool widthChanged = (levelWidth != state->levelWidth);
+
+	/*** Count the unchanged Vertexes at the start and end of the lists. ***/
+	Uint32 prefix = 0, suffix = 0;
+
+	while (prefix < shorter && old[prefix].X == vertices[prefix].X &&
+		   old[prefix].Y == vertices[prefix].Y)
+	{
+		prefix++;
+	}
+
+	while (suffix < shorter - prefix &&
+		   old[oldCount - 1 - suffix].X == vertices[numVertices - 1 - suffix].X &&
+		   old[oldCount - 1 - suffix].Y == vertices[numVertices - 1 - suffix].Y)
+	{
+		suffix++;
+	}
+
+	free(old);
+	terrain->vertices = vertices;
+	terrain->numVertices = numVertices;
+
+	if (prefix == numVertices && prefix == oldCount && !widthChanged)
+	{
+		return;
+	}
+
+	/*** Rasterize the columns between the unchanged Vertexes either side of
+	     the edit (to the end of the level, if it has changed width). ***/
+	Uint32 first = (prefix > 0) ? vertices[prefix - 1].X : 0;
+	Uint32 last = (suffix > 0 && !widthChanged) ?
+				  vertices[numVertices - suffix].X : levelWidth - 1;
+
+	if (widthChanged)
+	{
+		Uint16 *heightMap = (Uint16*)realloc(terrain->heightMap,
+											 levelWidth * sizeof(Uint16));
+
+		if (heightMap == NULL)
+		{
+			fprintf(stderr, "Couldn't allocate the height map.\n");
+			exit(EXIT_MAP_FAIL);
+		}
+		terrain->heightMap = heightMap;
+		state->levelWidth = levelWidth;
+	}
+
+	rasterizeHeightMap(terrain->heightMap, vertices, numVertices, first, last);
+	markTerrainChanged(terrain, first, last);
+
+	if (widthChanged)
+	{
+		/* The index's layout depends on the width, so build it afresh. */
+		freeHeightIndex(terrain);
+		buildHeightIndex(terrain, levelWidth);
+	}
+	else
+	{
+		updateHeightIndex(terrain, first, last);
+	}
+
+	/*** Widen the edited run until no strip, and no column of Vertexes,
+	     crosses its ends. ***/
+	Uint32 start = (prefix > 0) ? prefix - 1 : 0;
+	Uint32 end = (suffix > 0) ? numVertices - suffix : numVertices - 1;
+
+	while (start > 0 && (vertices[start - 1].Y == vertices[start].Y ||
+						 vertices[start - 1].X == vertices[start].X))
+	{
+		start--;
+	}
+
+	while (end + 1 < numVertices && (vertices[end + 1].Y == vertices[end].Y ||
+									 vertices[end + 1].X == vertices[end].X))
+	{
+		end++;
+	}
+
+	/*** Find the strips among the edited Vertexes, and the Flats that
+	     started among them before. ***/
+	Flat *strips = (Flat*)malloc((end - start + 1) * sizeof(Flat));
+
+	if (strips == NULL)
+	{
+		fprintf(stderr, "Couldn't allocate the Flats while reloading terrain.\n");
+		exit(EXIT_MAP_FAIL);
+	}
+
+	Uint32 numStrips = findStripsBetween(vertices, start, end, strips);
+	int left = vertices[start].X;
+	int right = vertices[end].X;
+	Uint32 firstOld = 0, lastOld;
+
+	while (firstOld < terrain->numFlats && terrain->flats[firstOld].X < left)
+	{
+		firstOld++;
+	}
+	for (lastOld = firstOld; lastOld < terrain->numFlats &&
+							 terrain->flats[lastOld].X <= right; lastOld++)
+	{
+	}
+
+	/*** Replace those Flats with the new strips, moving the Flats after them
+	     along if there are more or fewer. ***/
+	Uint32 numOld = lastOld - firstOld;
+	Uint32 numFlats = terrain->numFlats - numOld + numStrips;
+
+	if (numStrips > numOld)
+	{
+		Flat *flats = (Flat*)realloc(terrain->flats, numFlats * sizeof(Flat));
+
+		if (flats == NULL)
+		{
+			fprintf(stderr, "Couldn't allocate the Flats while reloading terrain.\n");
+			exit(EXIT_MAP_FAIL);
+		}
+		terrain->flats = flats;
+	}
+
+	memmove(terrain->flats + firstOld + numStrips, terrain->flats + lastOld,
+			(terrain->numFlats - lastOld) * sizeof(Flat));
+	memcpy(terrain->flats + firstOld, strips, numStrips * sizeof(Flat));
+	terrain->numFlats = numFlats;
+	free(strips);
+
+	/*** The table changes from just after the end of the Flat before them.
+	     If the number of Flats changed, every later column's index moves
+	     too. ***/
+	Uint32 tableFirst = (firstOld > 0) ?
+						terrain->flats[firstOld - 1].X +
+						terrain->flats[firstOld - 1].length + 1 : 0;
+
+	if (widthChanged)
+	{
+		free(terrain->flatTable);
+		buildFlatTable(terrain, levelWidth);
+	}
+	else
+	{
+		updateFlatTable(terrain, min(tableFirst, (Uint32)(left)),
+						(numStrips == numOld) ? (Uint32)(right) : levelWidth - 1);
+	}
+
+	/*** Keep the lander and focus point inside a level that has narrowed. ***/
+	wrapIntoLevel(state);
+}
+
+/**
+@fn freeTerrainWatch
+@brief Stops watching a level's file.
+@param watch Pointer to the TerrainWatch to free (may be NULL).
+*/
+void freeTerrainWatch (TerrainWatch *watch)
+{
+	if (watch == NULL)
+	{
+		return;
+	}
+
+	if (watch->parsing)
+	{
+		pthread_join(watch->parser, NULL);
+		freeVertexArray(&watch->pending);
+	}
+
+	if (watch->descriptor >= 0)
+	{
+		close(watch->descriptor);
+	}
+
+	pthread_mutex_destroy(&watch->lock);
+	free(watch);
+}
@@ -0,0 +1,105 @@
+/**
+@file TerrainReload.h
+@author Rob Thomas
+@brief Contains functions for reloading a level's terrain while the game runs.
+@details The game watches the text file of vertices it was started with. When
+the file is saved, it is parsed again on a separate thread, so the game keeps
+drawing while it is read. The new Vertex array is then compared with the old
+one, and only the columns of the height map, the runs of the height index and
+the Flats (and their table) under the Vertexes that changed are rebuilt.
+
+On Linux the file's directory is watched with inotify, which also catches
+editors that save by writing a new file and renaming it over the old one.
+Elsewhere the file's modification time is checked every frame.
+*/
+
+#ifndef LUNAR_LANDER_TERRAINRELOAD_H
+#define LUNAR_LANDER_TERRAINRELOAD_H
+
+#include <SDL2/SDL.h>
+
+#include <stdbool.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <time.h>
+
+#include "GameObjects.h"
+#include "TerrainBuilding.h"
+
+/**
+@typedef TerrainWatch
+@brief A level file being watched for changes.
+*/
+typedef struct TerrainWatch
+{
+	/* The file being watched. */
+	char *fileName;
+
+	/* The inotify instance watching the file's directory, or -1 if the
+	   modification time is checked instead. */
+	int descriptor;
+
+	/* The file's modification time and size when it was last checked. */
+	time_t modified;
+	off_t size;
+
+	/* True if the file has changed since it was last read. */
+	bool dirty;
+
+	/* The thread reading the file, if parsing is true. Once it is done, it
+	   sets parsed (under lock), and the Vertexes it read are in pending (or
+	   the reason they couldn't be read is in error). */
+	pthread_t parser;
+	bool parsing;
+	pthread_mutex_t lock;
+	bool parsed;
+	bool parseSucceeded;
+	Terrain pending;
+	Uint32 pendingWidth;
+	ParseError error;
+} TerrainWatch;
+
+/**
+@fn watchTerrainFile
+@brief Starts watching the text file a level was built from.
+@param fileName The name of the file.
+@param state Pointer to the GameState the level was built for.
+@return Pointer to the new TerrainWatch, or NULL if the level can't be
+reloaded (it was loaded from a level file or generated) or the file can't be
+watched.
+*/
+TerrainWatch *watchTerrainFile (char *fileName, GameState *state);
+
+/**
+@fn reloadTerrain
+@brief Checks whether a watched level's file has changed, without waiting, and
+brings the terrain up to date once the changed file has been read. Files that
+can't be parsed are reported and otherwise ignored.
+@param state Pointer to the current GameState struct. Does nothing if its
+terrainWatch is NULL.
+@return True if the terrain was changed, false otherwise.
+*/
+bool reloadTerrain (GameState *state);
+
+/**
+@fn editTerrain
+@brief Replaces a terrain's Vertexes with an edited list, rebuilding only the
+parts of the height map, height index, Flat array and Flat table under the
+Vertexes that changed.
+@param state Pointer to the GameState whose terrain to edit.
+@param vertices The edited Vertex array (allocated by parseVertexList), which
+the terrain takes over.
+@param numVertices The number of Vertexes in the edited array.
+@param levelWidth The width of the level the edited Vertexes describe.
+*/
+void editTerrain (GameState *state, Vertex *vertices, Uint32 numVertices,
+				  Uint32 levelWidth);
+
+/**
+@fn freeTerrainWatch
+@brief Stops watching a level's file.
+@param watch Pointer to the TerrainWatch to free (may be NULL).
+*/
+void freeTerrainWatch (TerrainWatch *watch);
+
+#endif /* LUNAR_LANDER_TERRAINRELOAD_H */
@@ -0,0 +1,313 @@
+/**
+@file TextCache.c
+@author Rob Thomas
+@brief Contains functions for drawing text from textures instead of pixel by
+pixel.
+@details See TextCache.h. The atlas and the fields are drawn in white into
+textures that are transparent everywhere else, and colored as they are copied
+into the window.
+*/
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL2_gfxPrimitives.h>
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "GameObjects.h"
+
+#include "TextCache.h"
+
+
+/**
+@fn createTextCache
+@brief Creates an empty text cache for a GameState's renderer. The glyph atlas
+and the fields' textures are drawn the first time they are used.
+@param state Pointer to the GameState, whose renderer has been created.
+@return Pointer to the new TextCache, or NULL if the renderer can't draw into
+textures.
+*/
+TextCache *createTextCache (GameState *state)
+{
+	TextCache *cache;
+
+	if (state->renderer == NULL || !SDL_RenderTargetSupported(state->renderer) ||
+		!( cache = (TextCache*)malloc(sizeof(TextCache)) ))
+	{
+		return NULL;
+	}
+
+	cache->renderer = state->renderer;
+	cache->atlas = NULL;
+
+	for (int i = 0; i < MAX_HUD_FIELDS; i++)
+	{
+		cache->fields[i].drawn = false;
+		cache->fields[i].texture = NULL;
+	}
+
+	return cache;
+}
+
+/**
+@fn createTextTexture
+@brief Makes a transparent texture to draw white text into, and makes it the
+renderer's target.
+@param renderer The renderer to make the texture for.
+@param width The width of the texture.
+@param height The height of the texture.
+@return Pointer to the new texture, or NULL if it can't be made or drawn into.
+*/
+static SDL_Texture *createTextTexture (SDL_Renderer *renderer, int width,
+									   int height)
+{
+	SDL_Texture *texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888,
+											 SDL_TEXTUREACCESS_TARGET, width,
+											 height);
+
+	if (texture == NULL)
+	{
+		return NULL;
+	}
+
+	if (SDL_SetRenderTarget(renderer, texture) != 0)
+	{
+		SDL_DestroyTexture(texture);
+		return NULL;
+	}
+
+	SDL_SetTextureBlendMode(texture, SDL_BLENDMODE_BLEND);
+	SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+	SDL_RenderClear(renderer);
+
+	return texture;
+}
+
+/**
+@fn drawAtlas
+@brief Draws every character of the font into the glyph atlas, if it hasn't
+been drawn yet.
+@param cache Pointer to the TextCache.
+@return True if the atlas has been drawn, false if it can't be.
+*/
+static bool drawAtlas (TextCache *cache)
+{
+	if (cache->atlas != NULL)
+	{
+		return true;
+	}
+
+	cache->atlas = createTextTexture(cache->renderer,
+									 ATLAS_COLUMNS * GLYPH_SIZE,
+									 (256 / ATLAS_COLUMNS) * GLYPH_SIZE);
+
+	if (cache->atlas == NULL)
+	{
+		return false;
+	}
+
+	/* Character 0 ends a string, and so is never drawn. */
+	for (int c = 1; c < 256; c++)
+	{
+		characterRGBA(cache->renderer, (c % ATLAS_COLUMNS) * GLYPH_SIZE,
+					  (c / ATLAS_COLUMNS) * GLYPH_SIZE, (char)(c), 255, 255,
+					  255, 255);
+	}
+
+	SDL_SetRenderTarget(cache->renderer, NULL);
+
+	return true;
+}
+
+/**
+@fn copyGlyphs
+@brief Copies the characters of a line of text out of the glyph atlas, which
+must have been drawn, onto the renderer's target.
+@param cache Pointer to the TextCache.
+@param X The X coordinate of the text's top-left corner on the target.
+@param Y The Y coordinate of the text's top-left corner on the target.
+@param text The text to copy.
+*/
+static void copyGlyphs (TextCache *cache, int X, int Y, const char *text)
+{
+	SDL_Rect source = {0, 0, GLYPH_SIZE, GLYPH_SIZE};
+	SDL_Rect destination = {X, Y, GLYPH_SIZE, GLYPH_SIZE};
+
+	for (const unsigned char *c = (const unsigned char*)(text); *c != '\0'; c++)
+	{
+		/* Spaces are blank, so skip copying them. */
+		if (*c != ' ')
+		{
+			source.x = (*c % ATLAS_COLUMNS) * GLYPH_SIZE;
+			source.y = (*c / ATLAS_COLUMNS) * GLYPH_SIZE;
+			SDL_RenderCopy(cache->renderer, cache->atlas, &source, &destination);
+		}
+
+		destination.x += GLYPH_SIZE;
+	}
+}
+
+/**
+@fn drawText
+@brief Writes a line of text in the window, copying its characters out of the
+glyph atlas. Draws the text with SDL2_gfx instead if there is no atlas.
+@param snapshot Pointer to the RenderSnapshot being drawn.
+@param X The X coordinate of the text's top-left corner in the window.
+@param Y The Y coordinate of the text's top-left corner in the window.
+@param text The text to write.
+@param r The red component of the text's color.
+@param g The green component of the text's color.
+@param b The blue component of the text's color.
+*/
+void drawText (RenderSnapshot *snapshot, int X, int Y, const char *text,
+			   Uint8 r, Uint8 g, Uint8 b)
+{
+	TextCache *cache = snapshot->textCache;
+
+	if (cache == NULL || !drawAtlas(cache))
+	{
+		stringRGBA(snapshot->renderer, X, Y, text, r, g, b, 255);
+		return;
+	}
+
+	SDL_SetTextureColorMod(cache->atlas, r, g, b);
+	copyGlyphs(cache, X, Y, text);
+}
+
+/**
+@fn drawField
+@brief Draws a line of text into a HUD field's texture (making the texture
+first, if it hasn't been made).
+@param cache Pointer to the TextCache.
+@param field Pointer to the HudField.
+@param text The text to draw.
+@return True if the text has been drawn, false if it can't be.
+*/
+static bool drawField (TextCache *cache, HudField *field, const char *text)
+{
+	field->drawn = false;
+
+	if (!drawAtlas(cache))
+	{
+		return false;
+	}
+
+	if (field->texture == NULL)
+	{
+		field->texture = createTextTexture(cache->renderer,
+										   (HUD_FIELD_LENGTH - 1) * GLYPH_SIZE,
+										   GLYPH_SIZE);
+	}
+	else if (SDL_SetRenderTarget(cache->renderer, field->texture) == 0)
+	{
+		SDL_SetRenderDrawColor(cache->renderer, 0, 0, 0, 0);
+		SDL_RenderClear(cache->renderer);
+	}
+	else
+	{
+		SDL_DestroyTexture(field->texture);
+		field->texture = NULL;
+	}
+
+	if (field->texture == NULL)
+	{
+		return false;
+	}
+
+	SDL_SetTextureColorMod(cache->atlas, 255, 255, 255);
+	copyGlyphs(cache, 0, 0, text);
+	SDL_SetRenderTarget(cache->renderer, NULL);
+
+	strcpy(field->text, text);
+	field->drawn = true;
+
+	return true;
+}
+
+/**
+@fn drawHudField
+@brief Writes a line of text in the window through a HUD field, drawing the
+text into the field's texture first only if it isn't the text already there.
+Draws the text with SDL2_gfx instead if the field has no texture.
+@param snapshot Pointer to the RenderSnapshot being drawn.
+@param field The HUD field to use (less than MAX_HUD_FIELDS).
+@param X The X coordinate of the text's top-left corner in the window.
+@param Y The Y coordinate of the text's top-left corner in the window.
+@param text The text to write (shorter than HUD_FIELD_LENGTH).
+@param r The red component of the text's color.
+@param g The green component of the text's color.
+@param b The blue component of the text's color.
+*/
+void drawHudField (RenderSnapshot *snapshot, int field, int X, int Y,
+				   const char *text, Uint8 r, Uint8 g, Uint8 b)
+{
+	TextCache *cache = snapshot->textCache;
+	HudField *current;
+
+	if (cache == NULL)
+	{
+		stringRGBA(snapshot->renderer, X, Y, text, r, g, b, 255);
+		return;
+	}
+
+	current = &cache->fields[field];
+
+	if (!(current->drawn && strcmp(current->text, text) == 0) &&
+		!drawField(cache, current, text))
+	{
+		stringRGBA(snapshot->renderer, X, Y, text, r, g, b, 255);
+		return;
+	}
+
+	/*** Copy as much of the texture as the text covers. ***/
+	int width = (int)(strlen(text)) * GLYPH_SIZE;
+	SDL_Rect source = {0, 0, width, GLYPH_SIZE};
+	SDL_Rect destination = {X, Y, width, GLYPH_SIZE};
+
+	SDL_SetTextureColorMod(current->texture, r, g, b);
+	SDL_RenderCopy(cache->renderer, current->texture, &source, &destination);
+}
+
+/**
+@fn clearTextCache
+@brief Throws away the glyph atlas and every field's texture, so they are all
+drawn again (for instance, after the renderer has lost its textures).
+@param cache Pointer to the TextCache to clear (may be NULL).
+*/
+void clearTextCache (TextCache *cache)
+{
+	if (cache == NULL)
+	{
+		return;
+	}
+
+	if (cache->atlas != NULL)
+	{
+		SDL_DestroyTexture(cache->atlas);
+		cache->atlas = NULL;
+	}
+
+	for (int i = 0; i < MAX_HUD_FIELDS; i++)
+	{
+		if (cache->fields[i].texture != NULL)
+		{
+			SDL_DestroyTexture(cache->fields[i].texture);
+			cache->fields[i].texture = NULL;
+		}
+
+		cache->fields[i].drawn = false;
+	}
+}
+
+/**
+@fn freeTextCache
+@brief Frees a text cache and its textures. Must be called before the renderer
+is destroyed.
+@param cache Pointer to the TextCache to free (may be NULL).
+*/
+void freeTextCache (TextCache *cache)
+{
+	clearTextCache(cache);
+	free(cache);
+}
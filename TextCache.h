@@ -0,0 +1,142 @@
+/**
+@file TextCache.h
+@author Rob Thomas
+@brief Contains functions for drawing text from textures instead of pixel by
+pixel.
+@details Every character of SDL2_gfx's 8x8 font is drawn once into a texture
+(the glyph atlas), so a line of text is drawn by copying its characters out of
+the atlas rather than by drawing each of their pixels.
+
+Text that is drawn every frame in the same place, like the score and the
+lander's speeds, is kept in HUD fields. Each field holds the last text written
+into it, already drawn into a texture of its own, so a field only costs a
+single copy per frame, and its characters are only copied out of the atlas
+again when its text changes.
+*/
+
+#ifndef LUNAR_LANDER_TEXTCACHE_H
+#define LUNAR_LANDER_TEXTCACHE_H
+
+#include <SDL2/SDL.h>
+
+#include <stdbool.h>
+
+#include "GameObjects.h"
+
+/**
+@def GLYPH_SIZE
+@brief The width and height of a character of the font (in pixels).
+*/
+#define GLYPH_SIZE 8
+
+/**
+@def ATLAS_COLUMNS
+@brief The number of characters in each row of the glyph atlas. The atlas
+holds all 256 characters of the font, so it has as many rows.
+*/
+#define ATLAS_COLUMNS 16
+
+/**
+@def HUD_FIELD_LENGTH
+@brief The longest text a HUD field can hold, including its terminating 0 byte.
+*/
+#define HUD_FIELD_LENGTH 64
+
+/**
+@def MAX_HUD_FIELDS
+@brief The number of HUD fields kept.
+*/
+#define MAX_HUD_FIELDS 12
+
+/**
+@typedef HudField
+@brief A line of text kept drawn in a texture.
+*/
+typedef struct HudField
+{
+	/* The text drawn in the texture, and whether it has been drawn since the
+	   texture was made. */
+	char text[HUD_FIELD_LENGTH];
+	bool drawn;
+
+	/* The texture the text is drawn into in white (as wide as the longest
+	   text), or NULL if it hasn't been made. */
+	SDL_Texture *texture;
+} HudField;
+
+/**
+@typedef TextCache
+@brief The glyph atlas and HUD fields kept for a renderer.
+*/
+typedef struct TextCache
+{
+	/* The renderer the textures belong to. */
+	SDL_Renderer *renderer;
+
+	/* Every character of the font, drawn in white, or NULL if the atlas
+	   hasn't been drawn yet. */
+	SDL_Texture *atlas;
+
+	/* The HUD fields. */
+	HudField fields[MAX_HUD_FIELDS];
+} TextCache;
+
+/**
+@fn createTextCache
+@brief Creates an empty text cache for a GameState's renderer. The glyph atlas
+and the fields' textures are drawn the first time they are used.
+@param state Pointer to the GameState, whose renderer has been created.
+@return Pointer to the new TextCache, or NULL if the renderer can't draw into
+textures.
+*/
+TextCache *createTextCache (GameState *state);
+
+/**
+@fn drawText
+@brief Writes a line of text in the window, copying its characters out of the
+glyph atlas. Draws the text with SDL2_gfx instead if there is no atlas.
+@param snapshot Pointer to the RenderSnapshot being drawn.
+@param X The X coordinate of the text's top-left corner in the window.
+@param Y The Y coordinate of the text's top-left corner in the window.
+@param text The text to write.
+@param r The red component of the text's color.
+@param g The green component of the text's color.
+@param b The blue component of the text's color.
+*/
+void drawText (RenderSnapshot *snapshot, int X, int Y, const char *text,
+			   Uint8 r, Uint8 g, Uint8 b);
+
+/**
+@fn drawHudField
+@brief Writes a line of text in the window through a HUD field, drawing the
+text into the field's texture first only if it isn't the text already there.
+Draws the text with SDL2_gfx instead if the field has no texture.
+@param snapshot Pointer to the RenderSnapshot being drawn.
+@param field The HUD field to use (less than MAX_HUD_FIELDS).
+@param X The X coordinate of the text's top-left corner in the window.
+@param Y The Y coordinate of the text's top-left corner in the window.
+@param text The text to write (shorter than HUD_FIELD_LENGTH).
+@param r The red component of the text's color.
+@param g The green component of the text's color.
+@param b The blue component of the text's color.
+*/
+void drawHudField (RenderSnapshot *snapshot, int field, int X, int Y,
+				   const char *text, Uint8 r, Uint8 g, Uint8 b);
+
+/**
+@fn clearTextCache
+@brief Throws away the glyph atlas and every field's texture, so they are all
+drawn again (for instance, after the renderer has lost its textures).
+@param cache Pointer to the TextCache to clear (may be NULL).
+*/
+void clearTextCache (TextCache *cache);
+
+/**
+@fn freeTextCache
+@brief Frees a text cache and its textures. Must be called before the renderer
+is destroyed.
+@param cache Pointer to the TextCache to free (may be NULL).
+*/
+void freeTextCache (TextCache *cache);
+
+#endif /* LUNAR_LANDER_TEXTCACHE_H */